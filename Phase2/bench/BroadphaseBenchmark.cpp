@@ -0,0 +1,111 @@
+#include "CollisionWorld.h"
+#include "TestRandom.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// times every broadphase on the same movers' swept bounds and checks they find the same boxes,
+// then times resolving every mover against every box one box at a time and with the simd kernel and checks they agree,
+// takes the number of boxes and movers, 10000 of each by default
+namespace {
+	using namespace testRandom;
+
+	double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// crates and slabs on a half unit grid, spread so each one has a few neighbours, the way level geometry clusters
+	void addLevel(collisionDetection::CollisionWorld& world, int boxCount) {
+		float side = 3.0f * std::cbrt(static_cast<float>(boxCount));
+		for (int i = 0; i < boxCount; i++) {
+			CollisionBox box;
+			box.position = glm::vec3(std::floor(uniform(0.0f, side) * 2.0f), std::floor(uniform(0.0f, side) * 2.0f), std::floor(uniform(0.0f, side) * 2.0f)) * 0.5f;
+			box.dimensions = glm::vec3(std::floor(uniform(1.0f, 8.0f)), std::floor(uniform(1.0f, 4.0f)), std::floor(uniform(1.0f, 8.0f))) * 0.5f;
+			box.velocity = glm::vec3(0.0f);
+			world.addBox(box);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	int boxCount = argc > 1 ? std::atoi(argv[1]) : 10000;
+	int moverCount = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+	collisionDetection::CollisionWorld world;
+	addLevel(world, boxCount);
+
+	// camera sized moves scattered around the boxes
+	const collisionDetection::CollisionBoxArray& boxes = world.getBoxes();
+	glm::vec3 low(0.0f);
+	glm::vec3 high(0.0f);
+	for (size_t i = 0; i < boxes.size(); i++) {
+		low = glm::min(low, boxes.get(i).position);
+		high = glm::max(high, boxes.get(i).position + boxes.get(i).dimensions);
+	}
+	std::vector<CollisionBox> movers(moverCount);
+	for (CollisionBox& mover : movers) {
+		mover.position = glm::vec3(uniform(low.x, high.x), uniform(low.y, high.y), uniform(low.z, high.z));
+		mover.dimensions = glm::vec3(0.01f);
+		mover.velocity = glm::vec3(uniform(-0.1f, 0.1f), uniform(-0.1f, 0.1f), uniform(-0.1f, 0.1f));
+	}
+
+	std::vector<collisionDetection::AABB> queries;
+	queries.reserve(movers.size());
+	for (const CollisionBox& mover : movers) {
+		queries.push_back(collisionDetection::getSweptBounds(mover));
+	}
+
+	const collisionDetection::Broadphase modes[] = { collisionDetection::Broadphase::BruteForce, collisionDetection::Broadphase::Tree, collisionDetection::Broadphase::SpatialHash };
+	std::vector<int> expected;
+	std::vector<int> found;
+	bool resultsMatch = true;
+	std::printf("%zu queries over %zu boxes\n", queries.size(), boxes.size());
+	for (int m = 0; m < 3; m++) {
+		found.clear();
+		auto start = std::chrono::high_resolution_clock::now();
+		for (const collisionDetection::AABB& query : queries) {
+			world.queryCandidates(query, found, modes[m]);
+		}
+		double milliseconds = millisecondsSince(start);
+		std::printf("%s: %.3fms, %zu hits\n", collisionDetection::getBroadphaseName(modes[m]), milliseconds, found.size());
+
+		if (m == 0) {
+			expected = found;
+		}
+		else if (found != expected) {
+			resultsMatch = false;
+		}
+	}
+	if (!resultsMatch) {
+		std::printf("broadphase results differ from brute force\n");
+	}
+
+	std::vector<CollisionBox> scalarMovers = movers;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (CollisionBox& mover : scalarMovers) {
+		for (size_t i = 0; i < boxes.size(); i++) {
+			CollisionBox box = boxes.get(i);
+			collisionDetection::correctCollisionBoxes(&mover, &box);
+		}
+	}
+	double scalarMilliseconds = millisecondsSince(start);
+
+	std::vector<CollisionBox> batchedMovers = movers;
+	start = std::chrono::high_resolution_clock::now();
+	for (CollisionBox& mover : batchedMovers) {
+		collisionDetection::correctCollisionBoxes(&mover, boxes);
+	}
+	double batchedMilliseconds = millisecondsSince(start);
+	std::printf("resolve scalar: %.3fms simd: %.3fms\n", scalarMilliseconds, batchedMilliseconds);
+
+	// every mover has to end with bit identical position and velocity
+	bool resolveResultsMatch = std::memcmp(scalarMovers.data(), batchedMovers.data(), movers.size() * sizeof(CollisionBox)) == 0;
+	if (!resolveResultsMatch) {
+		std::printf("simd resolve differs from scalar\n");
+	}
+	return resultsMatch && resolveResultsMatch ? 0 : 1;
+}
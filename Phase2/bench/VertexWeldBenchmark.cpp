@@ -0,0 +1,267 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "VertexPacking.h"
+#include "VertexWelder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// times welding the corners of obj models the way the renderer did before packing and VertexWelder, with std::unordered_map
+// over the full float vertex, then std::unordered_map and VertexWelder over the packed vertex, the last two have to agree,
+// pass obj paths, or run it from Phase2 to weld the repo's models
+namespace {
+	// the renderer's Vertex before it was packed, 76 bytes with the material copied into every vertex
+	struct LegacyVertex {
+		glm::vec3 pos;
+		glm::vec3 normal;
+		glm::vec2 texCoord;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		glm::vec3 ambient;
+		float shininess;
+		float opacity;
+
+		bool operator==(const LegacyVertex& other) const {
+			return pos == other.pos && normal == other.normal && texCoord == other.texCoord &&
+				diffuse == other.diffuse && specular == other.specular && ambient == other.ambient &&
+				shininess == other.shininess && opacity == other.opacity;
+		}
+	};
+	static_assert(sizeof(LegacyVertex) == 76, "LegacyVertex must be laid out like the renderer's old Vertex");
+
+	// the std::hash<Vertex> specialisation the renderer had then, the material doesn't go into it
+	struct LegacyVertexHash {
+		size_t operator()(LegacyVertex const& vertex) const {
+			return ((std::hash<glm::vec3>()(vertex.pos) ^ (std::hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^ (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+		}
+	};
+
+	// laid out like the renderer's Vertex, which can't be included without vulkan
+	struct Vertex {
+		glm::vec3 pos;
+		int16_t normal[2];
+		uint16_t texCoord[2];
+		uint16_t material;
+		uint16_t padding;
+
+		bool operator==(const Vertex& other) const {
+			return pos == other.pos && normal[0] == other.normal[0] && normal[1] == other.normal[1] &&
+				texCoord[0] == other.texCoord[0] && texCoord[1] == other.texCoord[1] && material == other.material;
+		}
+	};
+	static_assert(sizeof(Vertex) == 24, "Vertex must be laid out like the renderer's");
+
+	// the legacy hash's pattern over the packed fields, so std::unordered_map and VertexWelder are timed on the same keys
+	struct VertexHash {
+		size_t operator()(Vertex const& vertex) const {
+			uint32_t normal = static_cast<uint32_t>(static_cast<uint16_t>(vertex.normal[0])) << 16 | static_cast<uint16_t>(vertex.normal[1]);
+			uint32_t texCoord = static_cast<uint32_t>(vertex.texCoord[0]) << 16 | vertex.texCoord[1];
+			return (((std::hash<glm::vec3>()(vertex.pos) ^ (std::hash<uint32_t>()(normal) << 1)) >> 1) ^ (std::hash<uint32_t>()(texCoord) << 1)) ^ vertex.material;
+		}
+	};
+
+	// one 1 based obj index counted from 0, negative ones count back from the end, -1 when it's missing
+	int parseIndex(const std::string& text, size_t count) {
+		if (text.empty()) {
+			return -1;
+		}
+		int index = std::stoi(text);
+		return index < 0 ? static_cast<int>(count) + index : index - 1;
+	}
+
+	// every corner of the obj's faces, fanned into triangles and packed the way importObj packs them, without materials,
+	// along with the same corners as the old loader built them for a model without materials
+	bool readCorners(const std::string& path, std::vector<Vertex>& corners, std::vector<LegacyVertex>& legacyCorners) {
+		std::ifstream file(path);
+		if (!file) {
+			return false;
+		}
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<Vertex> face;
+		std::vector<LegacyVertex> legacyFace;
+		std::string line;
+		while (std::getline(file, line)) {
+			std::istringstream stream(line);
+			std::string type;
+			stream >> type;
+			if (type == "v") {
+				glm::vec3 position;
+				stream >> position.x >> position.y >> position.z;
+				positions.push_back(position);
+			}
+			else if (type == "vn") {
+				glm::vec3 normal;
+				stream >> normal.x >> normal.y >> normal.z;
+				normals.push_back(normal);
+			}
+			else if (type == "vt") {
+				glm::vec2 texCoord;
+				stream >> texCoord.x >> texCoord.y;
+				texCoords.push_back(texCoord);
+			}
+			else if (type == "f") {
+				face.clear();
+				legacyFace.clear();
+				std::string corner;
+				while (stream >> corner) {
+					size_t first = corner.find('/');
+					size_t second = first == std::string::npos ? std::string::npos : corner.find('/', first + 1);
+					int position = parseIndex(corner.substr(0, first), positions.size());
+					int texCoord = first == std::string::npos ? -1 : parseIndex(corner.substr(first + 1, second - first - 1), texCoords.size());
+					int normal = second == std::string::npos ? -1 : parseIndex(corner.substr(second + 1), normals.size());
+					if (position < 0 || position >= static_cast<int>(positions.size())) {
+						continue;
+					}
+
+					Vertex vertex = {};
+					LegacyVertex legacy = {};
+					legacy.pos = positions[position];
+					// adding zero turns -0 into 0, which operator== already treats as equal and the welder wouldn't
+					vertex.pos = positions[position] + glm::vec3(0.0f);
+					if (normal >= 0 && normal < static_cast<int>(normals.size())) {
+						legacy.normal = normals[normal];
+						vertexPacking::packOctahedral(normals[normal], vertex.normal);
+					}
+					if (texCoord >= 0 && texCoord < static_cast<int>(texCoords.size())) {
+						legacy.texCoord = glm::vec2(texCoords[texCoord].x, 1.0f - texCoords[texCoord].y);
+						vertex.texCoord[0] = vertexPacking::packHalf(texCoords[texCoord].x);
+						vertex.texCoord[1] = vertexPacking::packHalf(1.0f - texCoords[texCoord].y);
+					}
+					// what the old loader gave a model without materials, with a grey default colour
+					legacy.diffuse = glm::vec3(0.8f);
+					legacy.specular = glm::vec3(0.5f);
+					legacy.ambient = glm::vec3(0.1f);
+					legacy.shininess = 32.0f;
+					legacy.opacity = 1.0f;
+					face.push_back(vertex);
+					legacyFace.push_back(legacy);
+				}
+				for (size_t i = 2; i < face.size(); i++) {
+					corners.push_back(face[0]);
+					corners.push_back(face[i - 1]);
+					corners.push_back(face[i]);
+					legacyCorners.push_back(legacyFace[0]);
+					legacyCorners.push_back(legacyFace[i - 1]);
+					legacyCorners.push_back(legacyFace[i]);
+				}
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> paths(argv + 1, argv + argc);
+	if (paths.empty()) {
+		paths = { "resources/models/nextUC.obj", "resources/models/bep.obj", "resources/models/small_sphere.obj", "resources/models/texcube.obj",
+			"resources/models/AndGate.obj", "resources/models/OrGate.obj", "resources/models/XorGate.obj", "resources/models/wire.obj" };
+	}
+
+	std::vector<std::vector<Vertex>> corners;
+	std::vector<std::vector<LegacyVertex>> legacyCorners;
+	size_t cornerCount = 0;
+	for (const std::string& path : paths) {
+		std::vector<Vertex> model;
+		std::vector<LegacyVertex> legacyModel;
+		if (!readCorners(path, model, legacyModel)) {
+			std::printf("couldn't open %s\n", path.c_str());
+			continue;
+		}
+		cornerCount += model.size();
+		corners.push_back(std::move(model));
+		legacyCorners.push_back(std::move(legacyModel));
+	}
+	if (cornerCount == 0) {
+		std::printf("no corners to weld\n");
+		return 1;
+	}
+	// the models are welded again and again until a million corners have gone through, so the timings aren't all noise
+	size_t passes = (1000000 + cornerCount - 1) / cornerCount;
+	size_t vertexCount = passes * cornerCount;
+
+	std::vector<LegacyVertex> legacyUnique;
+	std::vector<uint32_t> legacyIndices;
+	size_t legacyUniqueCount = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t pass = 0; pass < passes; pass++) {
+		for (const std::vector<LegacyVertex>& model : legacyCorners) {
+			std::unordered_map<LegacyVertex, uint32_t, LegacyVertexHash> uniqueVertices = {};
+			legacyUnique.clear();
+			legacyIndices.clear();
+			for (const LegacyVertex& vertex : model) {
+				if (uniqueVertices.count(vertex) == 0) {
+					uniqueVertices[vertex] = static_cast<uint32_t>(legacyUnique.size());
+					legacyUnique.push_back(vertex);
+				}
+				legacyIndices.push_back(uniqueVertices[vertex]);
+			}
+			if (pass == 0) {
+				legacyUniqueCount += legacyUnique.size();
+			}
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double legacyMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	std::vector<Vertex> unique;
+	std::vector<uint32_t> hashMapIndices;
+	size_t hashMapUniqueCount = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t pass = 0; pass < passes; pass++) {
+		for (const std::vector<Vertex>& model : corners) {
+			std::unordered_map<Vertex, uint32_t, VertexHash> uniqueVertices = {};
+			unique.clear();
+			hashMapIndices.clear();
+			for (const Vertex& vertex : model) {
+				if (uniqueVertices.count(vertex) == 0) {
+					uniqueVertices[vertex] = static_cast<uint32_t>(unique.size());
+					unique.push_back(vertex);
+				}
+				hashMapIndices.push_back(uniqueVertices[vertex]);
+			}
+			if (pass == 0) {
+				hashMapUniqueCount += unique.size();
+			}
+		}
+	}
+	end = std::chrono::high_resolution_clock::now();
+	double hashMapMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	std::vector<uint32_t> welderIndices;
+	size_t welderUniqueCount = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t pass = 0; pass < passes; pass++) {
+		for (const std::vector<Vertex>& model : corners) {
+			unique.clear();
+			welderIndices.clear();
+			VertexWelder<Vertex> welder(unique, model.size() / 3);
+			for (const Vertex& vertex : model) {
+				welderIndices.push_back(welder.weld(vertex));
+			}
+			if (pass == 0) {
+				welderUniqueCount += unique.size();
+			}
+		}
+	}
+	end = std::chrono::high_resolution_clock::now();
+	double welderMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	double millions = vertexCount / 1000000.0;
+	std::printf("welding %zu vertices, per million: old unordered_map %.3fms (%zu unique), packed unordered_map %.3fms welder %.3fms (%zu unique)\n",
+		vertexCount, legacyMilliseconds / millions, legacyUniqueCount, hashMapMilliseconds / millions, welderMilliseconds / millions, welderUniqueCount);
+	// the last model of the last pass of each, both should find the same vertices
+	if (hashMapUniqueCount != welderUniqueCount || hashMapIndices != welderIndices) {
+		std::printf("welders differ, %zu unique against %zu\n", hashMapUniqueCount, welderUniqueCount);
+		return 1;
+	}
+	return 0;
+}
@@ -11,14 +11,20 @@ layout(binding=2) readonly buffer TRANSFORM_DATA {
     mat4 transform[500];
 } objects;
 
+struct MaterialData {
+    vec4 diffuse;  // a = opacity
+    vec4 specular; // a = shininess
+    vec4 ambient;
+};
+
+layout(std430, binding=6) readonly buffer MATERIAL_TABLE {
+    MaterialData materials[];
+} materialTable;
+
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
+layout(location = 1) in vec2 inNormal; // octahedral
 layout(location = 2) in vec2 inTexCoord;
-layout(location = 3) in vec3 inDiffuse;
-layout(location = 4) in vec3 inSpecular;
-layout(location = 5) in vec3 inAmbient;
-layout(location = 6) in float inShininess;
-layout(location = 7) in float inOpacity;
+layout(location = 3) in uint inMaterial;
 
 layout(location = 0) out vec3 fragDiffuse;
 layout(location = 1) out vec2 fragTexCoord;
@@ -48,18 +54,28 @@ out gl_PerVertex {
     vec4 gl_Position;
 };
 
+// the inverse of vertexPacking::packOctahedral
+vec3 decodeOctahedral(vec2 folded) {
+    vec3 normal = vec3(folded, 1.0 - abs(folded.x) - abs(folded.y));
+    float under = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -under : under;
+    normal.y += normal.y >= 0.0 ? -under : under;
+    return normalize(normal);
+}
+
 
 void main() {
+    MaterialData material = materialTable.materials[inMaterial];
     gl_Position = ubo.proj * ubo.view * objects.transform[object.index+gl_InstanceIndex] * vec4(inPosition, 1.0);
-    fragDiffuse = inDiffuse;
+    fragDiffuse = material.diffuse.rgb;
     FragPos = vec3(objects.transform[object.index+gl_InstanceIndex] * vec4(inPosition, 1.0));
-    Normal = mat3(transpose(inverse(objects.transform[object.index+gl_InstanceIndex]))) * inNormal;
+    Normal = mat3(transpose(inverse(objects.transform[object.index+gl_InstanceIndex]))) * decodeOctahedral(inNormal);
     cameraPos = ubo.cameraPos;
     fragTexCoord = inTexCoord*vec2(object.textureWidth, object.textureHeight) + vec2(object.textureOffsetX, object.textureOffsetY);
     fragNormalTexCoord = inTexCoord*vec2(object.normalTextureWidth, object.normalTextureHeight) + vec2(object.normalTextureOffsetX, object.normalTextureOffsetY);
-    fragSpecular = inSpecular;
-    fragAmbient = inAmbient;
-    fragShininess = inShininess;
-    fragOpacity = inOpacity;
+    fragSpecular = material.specular.rgb;
+    fragAmbient = material.ambient.rgb;
+    fragShininess = material.specular.a;
+    fragOpacity = material.diffuse.a;
     hasNormalMap = object.hasNormalMap;
 }
\ No newline at end of file
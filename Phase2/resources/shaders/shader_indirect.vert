@@ -0,0 +1,99 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shader_draw_parameters : enable
+
+// vertex shader for the indirect path, every model is one command of a single vkCmdDrawIndexedIndirect
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPos;
+} ubo;
+
+layout(binding=2) readonly buffer TRANSFORM_DATA {
+    mat4 transform[];
+} objects;
+
+struct DrawData {
+    vec4 textureOffsetSize;       // xy = offset, zw = size
+    vec4 normalTextureOffsetSize; // xy = offset, zw = size
+    vec4 boundingSphere;
+    int hasNormalMap;
+    uint firstInstance;
+    uint instanceCount;
+    uint firstCommand;
+    uint meshletCount;
+    uint meshlet;
+    uint lodCount;
+    float lodError;
+};
+
+layout(std430, binding=4) readonly buffer DRAW_DATA {
+    DrawData draws[];
+} drawData;
+
+// written by the cull pass, or an identity mapping when nothing is culled
+layout(std430, binding=5) readonly buffer VISIBLE_INSTANCES {
+    uint indices[];
+} visible;
+
+struct MaterialData {
+    vec4 diffuse;  // a = opacity
+    vec4 specular; // a = shininess
+    vec4 ambient;
+};
+
+layout(std430, binding=6) readonly buffer MATERIAL_TABLE {
+    MaterialData materials[];
+} materialTable;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal; // octahedral
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in uint inMaterial;
+
+layout(location = 0) out vec3 fragDiffuse;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 FragPos;  
+layout(location = 3) out vec3 Normal;
+layout(location = 4) out vec3 cameraPos;
+layout(location = 5) out vec3 fragSpecular;
+layout(location = 6) out vec3 fragAmbient;
+layout(location = 7) out float fragShininess;
+layout(location = 8) out float fragOpacity;
+layout(location = 9) out vec2 fragNormalTexCoord;
+layout(location = 10) out int hasNormalMap;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+// the inverse of vertexPacking::packOctahedral
+vec3 decodeOctahedral(vec2 folded) {
+    vec3 normal = vec3(folded, 1.0 - abs(folded.x) - abs(folded.y));
+    float under = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -under : under;
+    normal.y += normal.y >= 0.0 ? -under : under;
+    return normalize(normal);
+}
+
+
+void main() {
+    MaterialData material = materialTable.materials[inMaterial];
+    // gl_InstanceIndex already includes the command's firstInstance, which is where the model's visible instances start
+    mat4 transform = objects.transform[visible.indices[gl_InstanceIndex]];
+    DrawData draw = drawData.draws[gl_DrawIDARB];
+
+    gl_Position = ubo.proj * ubo.view * transform * vec4(inPosition, 1.0);
+    fragDiffuse = material.diffuse.rgb;
+    FragPos = vec3(transform * vec4(inPosition, 1.0));
+    Normal = mat3(transpose(inverse(transform))) * decodeOctahedral(inNormal);
+    cameraPos = ubo.cameraPos;
+    fragTexCoord = inTexCoord*draw.textureOffsetSize.zw + draw.textureOffsetSize.xy;
+    fragNormalTexCoord = inTexCoord*draw.normalTextureOffsetSize.zw + draw.normalTextureOffsetSize.xy;
+    fragSpecular = material.specular.rgb;
+    fragAmbient = material.ambient.rgb;
+    fragShininess = material.specular.a;
+    fragOpacity = material.diffuse.a;
+    hasNormalMap = draw.hasNormalMap;
+}
\ No newline at end of file
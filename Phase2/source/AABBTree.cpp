@@ -0,0 +1,376 @@
+#include "AABBTree.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace collisionDetection {
+	AABB getBounds(const CollisionBox& box) {
+		return { box.position, box.position + box.dimensions };
+	}
+
+	AABB getSweptBounds(const CollisionBox& box) {
+		AABB bounds = getBounds(box);
+		AABB moved = { bounds.min + box.velocity, bounds.max + box.velocity };
+		return combine(bounds, moved);
+	}
+
+	AABB combine(const AABB& a, const AABB& b) {
+		return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+
+	bool overlaps(const AABB& a, const AABB& b) {
+		return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+			a.min.y <= b.max.y && a.max.y >= b.min.y &&
+			a.min.z <= b.max.z && a.max.z >= b.min.z;
+	}
+
+	bool contains(const AABB& outer, const AABB& inner) {
+		return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+			inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+	}
+
+	float surfaceArea(const AABB& bounds) {
+		glm::vec3 size = bounds.max - bounds.min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool intersectRay(const AABB& bounds, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, int& axis) {
+		float entry = 0.0f;
+		float exit = maxDistance;
+		axis = -1;
+		for (int i = 0; i < 3; i++) {
+			if (direction[i] == 0.0f) {
+				// parallel to this slab, it never enters or leaves it
+				if (origin[i] < bounds.min[i] || origin[i] > bounds.max[i]) {
+					return false;
+				}
+				continue;
+			}
+
+			float inverse = 1.0f / direction[i];
+			float near = (bounds.min[i] - origin[i]) * inverse;
+			float far = (bounds.max[i] - origin[i]) * inverse;
+			if (near > far) {
+				std::swap(near, far);
+			}
+			if (near > entry) {
+				entry = near;
+				axis = i;
+			}
+			exit = std::min(exit, far);
+			if (entry > exit) {
+				return false;
+			}
+		}
+		distance = entry;
+		return true;
+	}
+
+	AABBTree::AABBTree(float margin) : margin(margin) {
+	}
+
+	int AABBTree::insert(const AABB& bounds, int userData) {
+		int leaf = allocateNode();
+		nodes[leaf].bounds = { bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin) };
+		nodes[leaf].userData = userData;
+		nodes[leaf].height = 0;
+		insertLeaf(leaf);
+		proxyCount++;
+		return leaf;
+	}
+
+	void AABBTree::remove(int proxy) {
+		if (proxy < 0 || proxy >= static_cast<int>(nodes.size()) || !nodes[proxy].isLeaf() || nodes[proxy].height < 0) {
+			throw std::runtime_error("invalid aabb tree proxy");
+		}
+		removeLeaf(proxy);
+		freeNode(proxy);
+		proxyCount--;
+	}
+
+	bool AABBTree::refit(int proxy, const AABB& bounds) {
+		if (contains(nodes[proxy].bounds, bounds)) {
+			return false;
+		}
+
+		removeLeaf(proxy);
+		nodes[proxy].bounds = { bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin) };
+		insertLeaf(proxy);
+		return true;
+	}
+
+	void AABBTree::query(const AABB& bounds, std::vector<int>& results) const {
+		if (root == NULL_NODE) {
+			return;
+		}
+
+		int stack[64];
+		std::vector<int> overflow; // only used by trees far deeper than balancing allows
+		int stackSize = 0;
+		stack[stackSize++] = root;
+
+		while (stackSize > 0 || !overflow.empty()) {
+			int index;
+			if (!overflow.empty()) {
+				index = overflow.back();
+				overflow.pop_back();
+			}
+			else {
+				index = stack[--stackSize];
+			}
+
+			const Node& node = nodes[index];
+			if (!overlaps(node.bounds, bounds)) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				results.push_back(node.userData);
+				continue;
+			}
+
+			for (int child : { node.left, node.right }) {
+				if (stackSize < 64) {
+					stack[stackSize++] = child;
+				}
+				else {
+					overflow.push_back(child);
+				}
+			}
+		}
+	}
+
+	int AABBTree::getUserData(int proxy) const {
+		return nodes[proxy].userData;
+	}
+
+	const AABB& AABBTree::getFatBounds(int proxy) const {
+		return nodes[proxy].bounds;
+	}
+
+	int AABBTree::getHeight() const {
+		return root == NULL_NODE ? 0 : nodes[root].height;
+	}
+
+	size_t AABBTree::getProxyCount() const {
+		return proxyCount;
+	}
+
+	void AABBTree::clear() {
+		nodes.clear();
+		root = NULL_NODE;
+		freeList = NULL_NODE;
+		proxyCount = 0;
+	}
+
+	int AABBTree::allocateNode() {
+		int node;
+		if (freeList != NULL_NODE) {
+			node = freeList;
+			freeList = nodes[node].parent;
+		}
+		else {
+			node = static_cast<int>(nodes.size());
+			nodes.emplace_back();
+		}
+
+		nodes[node].parent = NULL_NODE;
+		nodes[node].left = NULL_NODE;
+		nodes[node].right = NULL_NODE;
+		nodes[node].height = 0;
+		nodes[node].userData = -1;
+		return node;
+	}
+
+	void AABBTree::freeNode(int node) {
+		nodes[node].parent = freeList;
+		nodes[node].height = -1;
+		freeList = node;
+	}
+
+	void AABBTree::insertLeaf(int leaf) {
+		if (root == NULL_NODE) {
+			root = leaf;
+			nodes[root].parent = NULL_NODE;
+			return;
+		}
+
+		// descend towards the sibling that grows the total surface area the least
+		AABB leafBounds = nodes[leaf].bounds;
+		int index = root;
+		while (!nodes[index].isLeaf()) {
+			int left = nodes[index].left;
+			int right = nodes[index].right;
+
+			float area = surfaceArea(nodes[index].bounds);
+			float combinedArea = surfaceArea(combine(nodes[index].bounds, leafBounds));
+
+			// cost of making a new parent for this node and the leaf
+			float cost = 2.0f * combinedArea;
+			// every ancestor below here grows by this much whichever child the leaf goes into
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			float costLeft = surfaceArea(combine(leafBounds, nodes[left].bounds)) + inheritanceCost;
+			if (!nodes[left].isLeaf()) {
+				costLeft -= surfaceArea(nodes[left].bounds);
+			}
+			float costRight = surfaceArea(combine(leafBounds, nodes[right].bounds)) + inheritanceCost;
+			if (!nodes[right].isLeaf()) {
+				costRight -= surfaceArea(nodes[right].bounds);
+			}
+
+			if (cost < costLeft && cost < costRight) {
+				break;
+			}
+			index = costLeft < costRight ? left : right;
+		}
+
+		int sibling = index;
+		int oldParent = nodes[sibling].parent;
+		int newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].bounds = combine(leafBounds, nodes[sibling].bounds);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].left = sibling;
+		nodes[newParent].right = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent != NULL_NODE) {
+			if (nodes[oldParent].left == sibling) {
+				nodes[oldParent].left = newParent;
+			}
+			else {
+				nodes[oldParent].right = newParent;
+			}
+		}
+		else {
+			root = newParent;
+		}
+
+		fixUpwards(newParent);
+	}
+
+	void AABBTree::removeLeaf(int leaf) {
+		if (leaf == root) {
+			root = NULL_NODE;
+			return;
+		}
+
+		// the leaf's parent goes away and the sibling takes its place
+		int parent = nodes[leaf].parent;
+		int grandParent = nodes[parent].parent;
+		int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+		if (grandParent != NULL_NODE) {
+			if (nodes[grandParent].left == parent) {
+				nodes[grandParent].left = sibling;
+			}
+			else {
+				nodes[grandParent].right = sibling;
+			}
+			nodes[sibling].parent = grandParent;
+			freeNode(parent);
+			fixUpwards(grandParent);
+		}
+		else {
+			root = sibling;
+			nodes[sibling].parent = NULL_NODE;
+			freeNode(parent);
+		}
+	}
+
+	void AABBTree::fixUpwards(int node) {
+		int index = node;
+		while (index != NULL_NODE) {
+			index = balance(index);
+
+			int left = nodes[index].left;
+			int right = nodes[index].right;
+			nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+			nodes[index].bounds = combine(nodes[left].bounds, nodes[right].bounds);
+
+			index = nodes[index].parent;
+		}
+	}
+
+	int AABBTree::balance(int a) {
+		if (nodes[a].isLeaf() || nodes[a].height < 2) {
+			return a;
+		}
+
+		int b = nodes[a].left;
+		int c = nodes[a].right;
+		int heightDifference = nodes[c].height - nodes[b].height;
+
+		if (heightDifference > 1) {
+			// rotate c up, its taller child stays under it and the shorter one moves across to a
+			int f = nodes[c].left;
+			int g = nodes[c].right;
+
+			nodes[c].left = a;
+			nodes[c].parent = nodes[a].parent;
+			nodes[a].parent = c;
+
+			if (nodes[c].parent != NULL_NODE) {
+				if (nodes[nodes[c].parent].left == a) {
+					nodes[nodes[c].parent].left = c;
+				}
+				else {
+					nodes[nodes[c].parent].right = c;
+				}
+			}
+			else {
+				root = c;
+			}
+
+			int taller = nodes[f].height > nodes[g].height ? f : g;
+			int shorter = taller == f ? g : f;
+			nodes[c].right = taller;
+			nodes[a].right = shorter;
+			nodes[shorter].parent = a;
+
+			nodes[a].bounds = combine(nodes[b].bounds, nodes[shorter].bounds);
+			nodes[c].bounds = combine(nodes[a].bounds, nodes[taller].bounds);
+			nodes[a].height = 1 + std::max(nodes[b].height, nodes[shorter].height);
+			nodes[c].height = 1 + std::max(nodes[a].height, nodes[taller].height);
+			return c;
+		}
+
+		if (heightDifference < -1) {
+			// mirror of the case above with b rotated up
+			int d = nodes[b].left;
+			int e = nodes[b].right;
+
+			nodes[b].left = a;
+			nodes[b].parent = nodes[a].parent;
+			nodes[a].parent = b;
+
+			if (nodes[b].parent != NULL_NODE) {
+				if (nodes[nodes[b].parent].left == a) {
+					nodes[nodes[b].parent].left = b;
+				}
+				else {
+					nodes[nodes[b].parent].right = b;
+				}
+			}
+			else {
+				root = b;
+			}
+
+			int taller = nodes[d].height > nodes[e].height ? d : e;
+			int shorter = taller == d ? e : d;
+			nodes[b].right = taller;
+			nodes[a].left = shorter;
+			nodes[shorter].parent = a;
+
+			nodes[a].bounds = combine(nodes[c].bounds, nodes[shorter].bounds);
+			nodes[b].bounds = combine(nodes[a].bounds, nodes[taller].bounds);
+			nodes[a].height = 1 + std::max(nodes[c].height, nodes[shorter].height);
+			nodes[b].height = 1 + std::max(nodes[a].height, nodes[taller].height);
+			return b;
+		}
+
+		return a;
+	}
+}
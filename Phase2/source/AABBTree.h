@@ -0,0 +1,159 @@
+#pragma once
+#include "CollisionBox.h"
+
+#include <utility>
+#include <vector>
+
+namespace collisionDetection {
+	struct AABB {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	AABB getBounds(const CollisionBox& box);
+
+	// covers the box where it is now and where its velocity would take it
+	AABB getSweptBounds(const CollisionBox& box);
+
+	AABB combine(const AABB& a, const AABB& b);
+
+	// touching boxes count as overlapping
+	bool overlaps(const AABB& a, const AABB& b);
+
+	bool contains(const AABB& outer, const AABB& inner);
+
+	float surfaceArea(const AABB& bounds);
+
+	// distance along direction where the ray enters bounds and the axis of the face it enters through,
+	// a ray starting inside enters at 0 with axis -1, false when it misses or enters beyond maxDistance
+	bool intersectRay(const AABB& bounds, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, int& axis);
+
+	// dynamic bounding volume hierarchy, leaves hold a user index and bounds grown by a margin so small moves don't touch the tree
+	// kept height balanced with rotations, so queries stay logarithmic however the boxes were inserted
+	class AABBTree {
+	public:
+		static const int NULL_NODE = -1;
+
+		explicit AABBTree(float margin = 0.1f);
+
+		// returns a proxy id that stays valid until it is removed
+		int insert(const AABB& bounds, int userData);
+
+		void remove(int proxy);
+
+		// moves a proxy to new bounds, the tree is only changed when they leave the margin, returns true if it was
+		bool refit(int proxy, const AABB& bounds);
+
+		// appends the user data of every leaf overlapping bounds
+		void query(const AABB& bounds, std::vector<int>& results) const;
+
+		// calls hitLeaf(userData, maxDistance) for each leaf the ray reaches within maxDistance, nearest subtrees first,
+		// hitLeaf returns maxDistance or the distance of a closer hit, which stops farther nodes being visited
+		// leaves are grown by extent below their minimum corner, so a ray from a box's minimum corner finds what the box would hit
+		template<typename Function>
+		void rayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const glm::vec3& extent, Function hitLeaf) const;
+
+		int getUserData(int proxy) const;
+
+		const AABB& getFatBounds(int proxy) const;
+
+		int getHeight() const;
+
+		size_t getProxyCount() const;
+
+		void clear();
+
+	private:
+		struct Node {
+			AABB bounds;
+			int parent;    // next free node while on the free list
+			int left;
+			int right;
+			int height;    // leaves are 0, free nodes -1
+			int userData;
+
+			bool isLeaf() const {
+				return left == NULL_NODE;
+			}
+		};
+
+		int allocateNode();
+
+		void freeNode(int node);
+
+		void insertLeaf(int leaf);
+
+		void removeLeaf(int leaf);
+
+		// rotates the taller child of node up when the children's heights differ by more than one, returns the new subtree root
+		int balance(int node);
+
+		// walks from node to the root fixing heights and bounds, rebalancing on the way
+		void fixUpwards(int node);
+
+		std::vector<Node> nodes;
+		int root = NULL_NODE;
+		int freeList = NULL_NODE;
+		size_t proxyCount = 0;
+		float margin;
+	};
+
+	template<typename Function>
+	void AABBTree::rayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const glm::vec3& extent, Function hitLeaf) const {
+		struct Entry {
+			int node;
+			float distance; // where the ray enters the node, it is skipped if a hit closer than this was found since it was pushed
+		};
+
+		float distance;
+		int axis;
+		if (root == NULL_NODE || !intersectRay({ nodes[root].bounds.min - extent, nodes[root].bounds.max }, origin, direction, maxDistance, distance, axis)) {
+			return;
+		}
+
+		Entry stack[64];
+		std::vector<Entry> overflow; // only used by trees far deeper than balancing allows
+		int stackSize = 0;
+		stack[stackSize++] = { root, distance };
+
+		while (stackSize > 0 || !overflow.empty()) {
+			Entry entry;
+			if (!overflow.empty()) {
+				entry = overflow.back();
+				overflow.pop_back();
+			}
+			else {
+				entry = stack[--stackSize];
+			}
+			if (entry.distance > maxDistance) {
+				continue;
+			}
+
+			const Node& node = nodes[entry.node];
+			if (node.isLeaf()) {
+				maxDistance = hitLeaf(node.userData, maxDistance);
+				continue;
+			}
+
+			Entry children[2];
+			int childCount = 0;
+			for (int child : { node.left, node.right }) {
+				if (intersectRay({ nodes[child].bounds.min - extent, nodes[child].bounds.max }, origin, direction, maxDistance, distance, axis)) {
+					children[childCount++] = { child, distance };
+				}
+			}
+			// the nearer child goes on top so its hits can cut the farther one off
+			if (childCount == 2 && children[1].distance > children[0].distance) {
+				std::swap(children[0], children[1]);
+			}
+			for (int i = 0; i < childCount; i++) {
+				if (stackSize < 64) {
+					stack[stackSize++] = children[i];
+				}
+				else {
+					overflow.push_back(children[i]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,160 @@
+#include "CollisionBoxArray.h"
+#include "CollisionDetection.h"
+#include "SimdLanes.h"
+
+#include <cmath>
+#include <limits>
+
+namespace collisionDetection {
+	using namespace simd;
+
+	namespace {
+		// correctCollisionBoxes compares the mover's top minus 0.01 against a box's bottom in double,
+		// for a given bottom that holds exactly for float tops up to this limit, so the simd test can stay in float
+		float getBottomLimit(float bottom) {
+			const float infinity = std::numeric_limits<float>::infinity();
+			float limit = static_cast<float>(static_cast<double>(bottom) + 0.01);
+			while (static_cast<double>(limit) - 0.01 > bottom) {
+				limit = std::nextafter(limit, -infinity);
+			}
+			while (static_cast<double>(std::nextafter(limit, infinity)) - 0.01 <= bottom) {
+				limit = std::nextafter(limit, infinity);
+			}
+			return limit;
+		}
+
+		// the mover's values as correctCollisionBoxes computes them, in every lane
+		struct MoverLanes {
+			Lanes minX, minY, minZ;
+			Lanes maxX, maxY, maxZ;
+			Lanes movedMinX, movedMinY, movedMinZ;
+			Lanes movedMaxX, movedMaxY, movedMaxZ;
+
+			explicit MoverLanes(const CollisionBox& mover) {
+				glm::vec3 max = mover.position + mover.dimensions;
+				minX = broadcast(mover.position.x);
+				minY = broadcast(mover.position.y);
+				minZ = broadcast(mover.position.z);
+				maxX = broadcast(max.x);
+				maxY = broadcast(max.y);
+				maxZ = broadcast(max.z);
+				movedMinX = broadcast(mover.position.x + mover.velocity.x);
+				movedMinY = broadcast(mover.position.y + mover.velocity.y);
+				movedMinZ = broadcast(mover.position.z + mover.velocity.z);
+				movedMaxX = broadcast(max.x + mover.velocity.x);
+				movedMaxY = broadcast(max.y + mover.velocity.y);
+				movedMaxZ = broadcast(max.z + mover.velocity.z);
+			}
+		};
+	}
+
+	void CollisionBoxArray::add(const CollisionBox& box) {
+		// overwrite the first padding slot, then pad again
+		size_t index = boxes.size();
+		boxes.push_back(box);
+		pad();
+		write(index, box);
+	}
+
+	void CollisionBoxArray::set(size_t index, const CollisionBox& box) {
+		boxes[index] = box;
+		write(index, box);
+	}
+
+	void CollisionBoxArray::write(size_t index, const CollisionBox& box) {
+		glm::vec3 max = box.position + box.dimensions;
+		minX[index] = box.position.x;
+		minY[index] = box.position.y;
+		minZ[index] = box.position.z;
+		maxX[index] = max.x;
+		maxY[index] = max.y;
+		maxZ[index] = max.z;
+		bottomLimit[index] = getBottomLimit(box.position.y);
+	}
+
+	const CollisionBox& CollisionBoxArray::get(size_t index) const {
+		return boxes[index];
+	}
+
+	size_t CollisionBoxArray::size() const {
+		return boxes.size();
+	}
+
+	void CollisionBoxArray::clear() {
+		boxes.clear();
+		paddedCount = 0;
+		for (std::vector<float>* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ, &bottomLimit }) {
+			values->clear();
+		}
+	}
+
+	void CollisionBoxArray::pad() {
+		size_t count = (boxes.size() + LANES - 1) / LANES * LANES;
+		if (count == paddedCount) {
+			return;
+		}
+
+		// a box starting at infinity never overlaps the mover, and every correction needs an overlap
+		const float infinity = std::numeric_limits<float>::infinity();
+		for (std::vector<float>* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) {
+			values->resize(count, infinity);
+		}
+		bottomLimit.resize(count, -infinity);
+		paddedCount = count;
+	}
+
+	void correctCollisionBoxes(CollisionBox* mover, const CollisionBoxArray& boxes) {
+		// correcting against one box changes the mover for every box after it, so lanes only look for the first box
+		// that would change the mover, that box is corrected with the scalar routine and the search restarts after it
+		size_t count = boxes.size();
+		size_t next = 0;
+		while (next < count) {
+			MoverLanes m(*mover);
+			size_t base = next - next % LANES;
+			uint32_t skipped = static_cast<uint32_t>(next - base);
+			size_t hit = count;
+
+			for (; base < count; base += LANES) {
+				Lanes boxMinX = loadUnaligned(&boxes.minX[base]);
+				Lanes boxMinY = loadUnaligned(&boxes.minY[base]);
+				Lanes boxMinZ = loadUnaligned(&boxes.minZ[base]);
+				Lanes boxMaxX = loadUnaligned(&boxes.maxX[base]);
+				Lanes boxMaxY = loadUnaligned(&boxes.maxY[base]);
+				Lanes boxMaxZ = loadUnaligned(&boxes.maxZ[base]);
+
+				Lanes overlapX = both(less(boxMinX, m.maxX), less(m.minX, boxMaxX));
+				Lanes overlapY = both(less(boxMinY, m.maxY), less(m.minY, boxMaxY));
+				Lanes overlapZ = both(less(boxMinZ, m.maxZ), less(m.minZ, boxMaxZ));
+
+				// each axis is clamped when the box overlaps on the other two and the move crosses a face
+				Lanes crossZ = either(both(lessEqual(boxMaxZ, m.minZ), less(m.movedMinZ, boxMaxZ)),
+					both(lessEqual(m.maxZ, boxMinZ), less(boxMinZ, m.movedMaxZ)));
+				Lanes crossY = either(both(lessEqual(boxMaxY, m.minY), less(m.movedMinY, boxMaxY)),
+					both(lessEqual(m.maxY, loadUnaligned(&boxes.bottomLimit[base])), less(boxMinY, m.movedMaxY)));
+				Lanes crossX = either(both(lessEqual(boxMaxX, m.minX), less(m.movedMinX, boxMaxX)),
+					both(lessEqual(m.maxX, boxMinX), less(boxMinX, m.movedMaxX)));
+
+				Lanes touched = either(either(both(both(overlapX, overlapY), crossZ), both(both(overlapX, overlapZ), crossY)),
+					both(both(overlapZ, overlapY), crossX));
+
+				uint32_t mask = laneMask(touched) >> skipped << skipped;
+				skipped = 0;
+				if (mask != 0) {
+					uint32_t lane = 0;
+					while ((mask & (1u << lane)) == 0) {
+						lane++;
+					}
+					hit = base + lane;
+					break;
+				}
+			}
+
+			if (hit >= count) {
+				return;
+			}
+			CollisionBox box = boxes.get(hit);
+			correctCollisionBoxes(mover, &box);
+			next = hit + 1;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "CollisionBox.h"
+
+#include <vector>
+
+namespace collisionDetection {
+	// boxes laid out as one array per coordinate so a mover can be checked against several boxes per instruction
+	// the arrays are padded to whole simd blocks with boxes nothing can touch
+	class CollisionBoxArray {
+	public:
+		void add(const CollisionBox& box);
+
+		// replaces a box already in the array
+		void set(size_t index, const CollisionBox& box);
+
+		const CollisionBox& get(size_t index) const;
+
+		size_t size() const;
+
+		void clear();
+
+	private:
+		friend void correctCollisionBoxes(CollisionBox* mover, const CollisionBoxArray& boxes);
+
+		void pad();
+
+		void write(size_t index, const CollisionBox& box);
+
+		std::vector<CollisionBox> boxes; // kept as given, the exact scalar routine runs on these
+		size_t paddedCount = 0;
+		std::vector<float> minX;
+		std::vector<float> minY;
+		std::vector<float> minZ;
+		std::vector<float> maxX; // position + dimensions, rounded the same way correctCollisionBoxes rounds it
+		std::vector<float> maxY;
+		std::vector<float> maxZ;
+		std::vector<float> bottomLimit; // highest mover top that still counts as starting below the box, see the .cpp
+	};
+
+	// same result as calling correctCollisionBoxes(mover, &box) for every box in the array in order
+	void correctCollisionBoxes(CollisionBox* mover, const CollisionBoxArray& boxes);
+}
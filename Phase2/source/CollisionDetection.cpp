@@ -1,6 +1,12 @@
 #include "CollisionDetection.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace collisionDetection {
+	const float CONTACT_SKIN = 0.0001f;
+
 	bool detectRectangleCollision(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2) {
 		if (x1 + w1 > x2 && x1 < x2 + w2 && y1 + h1 > y2 && y1 < y2 + h2) {
 			return true;
@@ -48,4 +54,49 @@ namespace collisionDetection {
 			}
 		}
 	}
+
+	SweepHit sweepCollisionBoxes(const CollisionBox& mover, const CollisionBox& box) {
+		const float infinity = std::numeric_limits<float>::infinity();
+		glm::vec3 moverMax = mover.position + mover.dimensions;
+		glm::vec3 boxMax = box.position + box.dimensions;
+
+		// the mover is inside the box's slab on each axis between its entry and exit times, it touches the box while inside all three
+		float entry = -infinity;
+		float exit = infinity;
+		int entryAxis = -1;
+		float entryDepth = 0.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			float velocity = mover.velocity[axis];
+			if (velocity == 0.0f) {
+				if (moverMax[axis] <= box.position[axis] + CONTACT_SKIN || mover.position[axis] >= boxMax[axis] - CONTACT_SKIN) {
+					return SweepHit();
+				}
+				continue;
+			}
+
+			// gap to close before the faces meet, negative when already overlapping on this axis
+			float gap = velocity > 0.0f ? box.position[axis] - moverMax[axis] : mover.position[axis] - boxMax[axis];
+			float through = velocity > 0.0f ? boxMax[axis] - mover.position[axis] : moverMax[axis] - box.position[axis];
+			float axisEntry = gap / std::abs(velocity);
+			float axisExit = through / std::abs(velocity);
+			if (axisEntry > entry) {
+				entry = axisEntry;
+				entryAxis = axis;
+				entryDepth = -gap;
+			}
+			exit = std::min(exit, axisExit);
+		}
+
+		// starting inside the box lets the mover leave it, and a hit after the whole move is no hit
+		if (entryAxis < 0 || entryDepth > CONTACT_SKIN || entry >= exit || entry > 1.0f) {
+			return SweepHit();
+		}
+
+		SweepHit hit;
+		hit.hit = true;
+		hit.time = std::max(entry, 0.0f);
+		hit.axis = entryAxis;
+		hit.normal[entryAxis] = mover.velocity[entryAxis] > 0.0f ? -1.0f : 1.0f;
+		return hit;
+	}
 }
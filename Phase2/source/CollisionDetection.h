@@ -2,5 +2,18 @@
 #include "CollisionBox.h"
 
 namespace collisionDetection {
+	// boxes this far into each other still count as touching, so rounding when a mover stops against a face can't let it through
+	extern const float CONTACT_SKIN;
+
+	struct SweepHit {
+		bool hit = false;
+		float time = 1.0f;  // fraction of the velocity travelled before touching
+		int axis = -1;      // axis of the face that was hit
+		glm::vec3 normal = glm::vec3(0.0f);
+	};
+
 	void correctCollisionBoxes(CollisionBox* b1, CollisionBox* b2);
-}
\ No newline at end of file
+
+	// first time the mover moving by its whole velocity touches the box, boxes the mover starts inside don't stop it
+	SweepHit sweepCollisionBoxes(const CollisionBox& mover, const CollisionBox& box);
+}
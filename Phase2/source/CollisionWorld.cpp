@@ -0,0 +1,351 @@
+#include "CollisionWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace collisionDetection {
+	const char* getBroadphaseName(Broadphase broadphase) {
+		switch (broadphase) {
+		case Broadphase::BruteForce:
+			return "brute force";
+		case Broadphase::Tree:
+			return "aabb tree";
+		case Broadphase::SpatialHash:
+			return "spatial hash";
+		}
+		return "unknown";
+	}
+
+	// most boxes never move and the ones that do are put back exactly, so the tree needs no margin
+	CollisionWorld::CollisionWorld(float cellSize) : tree(0.0f), grid(cellSize), meshTree(0.0f) {
+	}
+
+	int CollisionWorld::addBox(const CollisionBox& box) {
+		int index = static_cast<int>(boxes.size());
+		boxes.add(box);
+		AABB bounds = getBounds(box);
+		proxies.push_back(tree.insert(bounds, index));
+		grid.insert(bounds, index);
+		return index;
+	}
+
+	void CollisionWorld::setBox(int index, const CollisionBox& box) {
+		boxes.set(index, box);
+		// refit would keep the old bounds while they still contain the new ones, queries have to stay exact
+		AABB bounds = getBounds(box);
+		tree.remove(proxies[index]);
+		proxies[index] = tree.insert(bounds, index);
+		grid.remove(index);
+		grid.insert(bounds, index);
+	}
+
+	const CollisionBoxArray& CollisionWorld::getBoxes() const {
+		return boxes;
+	}
+
+	namespace {
+		// world bounds around the corners of the mesh's model space box
+		AABB getMeshBounds(const TriangleMesh& mesh, const glm::mat4& transform) {
+			const AABB& local = mesh.getBounds();
+			AABB bounds;
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec3 point((corner & 1) ? local.max.x : local.min.x, (corner & 2) ? local.max.y : local.min.y, (corner & 4) ? local.max.z : local.min.z);
+				glm::vec3 world = glm::vec3(transform * glm::vec4(point, 1.0f));
+				bounds = corner == 0 ? AABB{ world, world } : combine(bounds, { world, world });
+			}
+			return bounds;
+		}
+	}
+
+	int CollisionWorld::addMesh(const TriangleMesh& mesh, const glm::mat4& transform) {
+		MeshInstance instance;
+		instance.mesh = &mesh;
+		instance.toWorld = transform;
+		instance.toModel = glm::inverse(transform);
+		instance.bounds = getMeshBounds(mesh, transform);
+
+		int index = static_cast<int>(meshes.size());
+		meshes.push_back(instance);
+		meshProxies.push_back(meshTree.insert(instance.bounds, index));
+		return index;
+	}
+
+	void CollisionWorld::setMesh(int index, const TriangleMesh& mesh) {
+		MeshInstance& instance = meshes[index];
+		instance.mesh = &mesh;
+		instance.bounds = getMeshBounds(mesh, instance.toWorld);
+		meshTree.remove(meshProxies[index]);
+		meshProxies[index] = meshTree.insert(instance.bounds, index);
+	}
+
+	const std::vector<MeshInstance>& CollisionWorld::getMeshes() const {
+		return meshes;
+	}
+
+	void CollisionWorld::queryMeshes(const AABB& bounds, std::vector<int>& results) const {
+		size_t first = results.size();
+		meshTree.query(bounds, results);
+		std::sort(results.begin() + first, results.end());
+	}
+
+	bool CollisionWorld::overlapsMeshes(const CollisionBox& box) const {
+		std::vector<int> instances;
+		queryMeshes(getBounds(box), instances);
+		return overlapsMeshes(box, instances);
+	}
+
+	bool CollisionWorld::overlapsMeshes(const CollisionBox& box, const std::vector<int>& instances) const {
+		glm::vec3 centre = box.position + box.dimensions * 0.5f;
+		for (int index : instances) {
+			// the box's edges become a parallelepiped in model space, rotated and scaled by the inverse transform
+			const MeshInstance& instance = meshes[index];
+			glm::vec3 halfEdges[3];
+			for (int axis = 0; axis < 3; axis++) {
+				halfEdges[axis] = glm::vec3(instance.toModel[axis]) * (box.dimensions[axis] * 0.5f);
+			}
+			if (instance.mesh->overlaps(glm::vec3(instance.toModel * glm::vec4(centre, 1.0f)), halfEdges)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool CollisionWorld::sweepMeshes(const CollisionBox& box, const glm::vec3& displacement, const std::vector<int>& instances, float& time) const {
+		// fractions of the move are the same in model space, the transform is affine
+		glm::vec3 centre = box.position + box.dimensions * 0.5f;
+		bool hit = false;
+		time = 1.0f;
+		for (int index : instances) {
+			const MeshInstance& instance = meshes[index];
+			glm::vec3 halfEdges[3];
+			for (int axis = 0; axis < 3; axis++) {
+				halfEdges[axis] = glm::vec3(instance.toModel[axis]) * (box.dimensions[axis] * 0.5f);
+			}
+			float instanceTime;
+			if (instance.mesh->sweep(glm::vec3(instance.toModel * glm::vec4(centre, 1.0f)), halfEdges, glm::vec3(instance.toModel * glm::vec4(displacement, 0.0f)), instanceTime)
+				&& instanceTime <= time) {
+				time = instanceTime;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+
+	void CollisionWorld::setBroadphase(Broadphase _broadphase) {
+		broadphase = _broadphase;
+	}
+
+	Broadphase CollisionWorld::getBroadphase() const {
+		return broadphase;
+	}
+
+	void CollisionWorld::queryCandidates(const AABB& bounds, std::vector<int>& results) const {
+		queryCandidates(bounds, results, broadphase);
+	}
+
+	void CollisionWorld::queryCandidates(const AABB& bounds, std::vector<int>& results, Broadphase mode) const {
+		size_t first = results.size();
+		switch (mode) {
+		case Broadphase::BruteForce:
+			for (size_t i = 0; i < boxes.size(); i++) {
+				if (overlaps(getBounds(boxes.get(i)), bounds)) {
+					results.push_back(static_cast<int>(i));
+				}
+			}
+			break;
+		case Broadphase::Tree:
+			tree.query(bounds, results);
+			break;
+		case Broadphase::SpatialHash:
+			grid.query(bounds, results);
+			break;
+		}
+		std::sort(results.begin() + first, results.end());
+	}
+
+	void CollisionWorld::resolve(CollisionBox& mover) {
+		if (broadphase == Broadphase::BruteForce) {
+			correctCollisionBoxes(&mover, boxes);
+			return;
+		}
+
+		// correctCollisionBoxes only moves the mover within its swept bounds, so these are all the boxes it could reach
+		candidates.clear();
+		queryCandidates(getSweptBounds(mover), candidates);
+		for (int i : candidates) {
+			CollisionBox box = boxes.get(i);
+			correctCollisionBoxes(&mover, &box);
+		}
+	}
+
+	bool CollisionWorld::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+		CollisionBox point;
+		point.position = origin;
+		point.dimensions = glm::vec3(0.0f);
+		point.velocity = glm::vec3(0.0f);
+		boxCast(point, direction, maxDistance, hit);
+		if (meshes.empty()) {
+			return hit.box >= 0;
+		}
+
+		float length = glm::length(direction);
+		if (length == 0.0f) {
+			return false;
+		}
+		glm::vec3 unitDirection = direction / length;
+
+		// the ray is moved into each mesh's space without normalising it again, so distances along it stay world distances
+		float closest = hit.box >= 0 ? hit.distance : maxDistance;
+		meshTree.rayCast(origin, unitDirection, closest, glm::vec3(0.0f), [&](int index, float limit) {
+			const MeshInstance& instance = meshes[index];
+			glm::vec3 modelOrigin = glm::vec3(instance.toModel * glm::vec4(origin, 1.0f));
+			glm::vec3 modelDirection = glm::vec3(instance.toModel * glm::vec4(unitDirection, 0.0f));
+			float distance;
+			int triangle;
+			// a box at the same distance keeps the hit, a mesh at the same distance only gives it to a lower mesh index,
+			// so the answer doesn't depend on the order the tree visits them in
+			if (!instance.mesh->raycast(modelOrigin, modelDirection, limit, distance, triangle) || (distance == limit && (hit.mesh < 0 || index > hit.mesh))) {
+				return limit;
+			}
+			hit.box = -1;
+			hit.mesh = index;
+			hit.triangle = triangle;
+			hit.distance = distance;
+			return distance;
+		});
+
+		if (hit.mesh < 0) {
+			return hit.box >= 0;
+		}
+		const MeshInstance& instance = meshes[hit.mesh];
+		hit.point = origin + unitDirection * hit.distance;
+		// normals go to world space by the transpose of the inverse transform
+		glm::vec3 normal = instance.mesh->getTriangleNormal(hit.triangle);
+		normal = glm::vec3(glm::dot(glm::vec3(instance.toModel[0]), normal), glm::dot(glm::vec3(instance.toModel[1]), normal), glm::dot(glm::vec3(instance.toModel[2]), normal));
+		if (glm::length(normal) > 0.0f) {
+			normal = glm::normalize(normal);
+		}
+		// both faces of a triangle are solid, report the one the ray came in through
+		hit.normal = glm::dot(normal, unitDirection) > 0.0f ? -normal : normal;
+		return true;
+	}
+
+	bool CollisionWorld::boxCast(const CollisionBox& box, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+		hit = RaycastHit();
+		float length = glm::length(direction);
+		if (length == 0.0f) {
+			return false;
+		}
+		glm::vec3 unitDirection = direction / length;
+
+		// the box hits whatever its minimum corner would if every box were grown by its dimensions
+		int hitAxis = -1;
+		tree.rayCast(box.position, unitDirection, maxDistance, box.dimensions, [&](int index, float limit) {
+			const CollisionBox& target = boxes.get(index);
+			float distance;
+			int axis;
+			if (!intersectRay({ target.position - box.dimensions, target.position + target.dimensions }, box.position, unitDirection, limit, distance, axis)) {
+				return limit;
+			}
+			// equal distances go to the lower index so the result doesn't depend on the tree's shape
+			if (hit.box >= 0 && distance == hit.distance && index > hit.box) {
+				return limit;
+			}
+			hit.box = index;
+			hit.distance = distance;
+			hitAxis = axis;
+			return distance;
+		});
+
+		if (hit.box < 0) {
+			return false;
+		}
+		hit.point = box.position + unitDirection * hit.distance;
+		if (hitAxis >= 0) {
+			hit.normal[hitAxis] = unitDirection[hitAxis] > 0.0f ? -1.0f : 1.0f;
+		}
+		return true;
+	}
+
+	void CollisionWorld::raycast(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits, JobSystem& jobSystem) const {
+		const uint32_t RAYS_PER_JOB = 256;
+		hits.resize(rays.size());
+		uint32_t jobCount = static_cast<uint32_t>((rays.size() + RAYS_PER_JOB - 1) / RAYS_PER_JOB);
+		jobSystem.parallelFor(jobCount, [&](uint32_t job, uint32_t) {
+			size_t end = std::min(rays.size(), static_cast<size_t>(job + 1) * RAYS_PER_JOB);
+			for (size_t i = static_cast<size_t>(job) * RAYS_PER_JOB; i < end; i++) {
+				raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i]);
+			}
+		});
+	}
+
+	void CollisionWorld::moveAndSlide(CollisionBox& mover) {
+		// sliding only ever shortens the move on each axis, so the first move's swept bounds cover every box the slides can reach
+		AABB bounds = getSweptBounds(mover);
+		bounds.min -= glm::vec3(CONTACT_SKIN);
+		bounds.max += glm::vec3(CONTACT_SKIN);
+		candidates.clear();
+		queryCandidates(bounds, candidates);
+
+		glm::vec3 start = mover.position;
+		glm::vec3 remaining = mover.velocity;
+		// each hit removes one axis of the move, so three are enough to come to rest in a corner
+		for (int i = 0; i < 3 && remaining != glm::vec3(0.0f); i++) {
+			mover.velocity = remaining;
+			SweepHit first;
+			for (int candidate : candidates) {
+				SweepHit hit = sweepCollisionBoxes(mover, boxes.get(candidate));
+				if (hit.hit && hit.time < first.time) {
+					first = hit;
+				}
+			}
+
+			if (!first.hit) {
+				mover.position += remaining;
+				break;
+			}
+
+			mover.position += remaining * first.time;
+			remaining *= 1.0f - first.time;
+			remaining[first.axis] = 0.0f;
+		}
+
+		if (!meshes.empty()) {
+			meshCandidates.clear();
+			queryMeshes(bounds, meshCandidates);
+			if (!meshCandidates.empty()) {
+				clipAgainstMeshes(mover, start);
+			}
+		}
+
+		mover.velocity = mover.position - start;
+		mover.position = start;
+	}
+
+	void CollisionWorld::clipAgainstMeshes(CollisionBox& mover, const glm::vec3& start) const {
+		// triangles have no faces to slide along like boxes do, so each axis of the move is taken in turn
+		// and stopped CONTACT_SKIN short of where the box would first touch a mesh, so it doesn't start the next axis touching one
+		glm::vec3 end = mover.position;
+		mover.position = start;
+		for (int axis = 0; axis < 3; axis++) {
+			float move = end[axis] - start[axis];
+			if (move == 0.0f) {
+				continue;
+			}
+			// a mover already inside a mesh is let out rather than stuck
+			if (overlapsMeshes(mover, meshCandidates)) {
+				mover.position[axis] += move;
+				continue;
+			}
+
+			glm::vec3 displacement(0.0f);
+			displacement[axis] = move;
+			float time;
+			if (!sweepMeshes(mover, displacement, meshCandidates, time)) {
+				mover.position[axis] += move;
+				continue;
+			}
+			mover.position[axis] += move * std::max(time - CONTACT_SKIN / std::abs(move), 0.0f);
+		}
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "CollisionDetection.h"
+#include "CollisionBoxArray.h"
+#include "AABBTree.h"
+#include "SpatialHashGrid.h"
+#include "TriangleMesh.h"
+#include "JobSystem.h"
+
+#include <vector>
+
+namespace collisionDetection {
+	enum class Broadphase {
+		BruteForce,
+		Tree,
+		SpatialHash,
+	};
+
+	const char* getBroadphaseName(Broadphase broadphase);
+
+	struct Ray {
+		glm::vec3 origin;
+		glm::vec3 direction; // doesn't need to be normalised
+		float maxDistance;
+	};
+
+	struct RaycastHit {
+		int box = -1;        // index in the world, -1 when nothing was hit
+		int mesh = -1;       // index of the mesh instance hit instead of a box
+		int triangle = -1;   // of the mesh hit
+		float distance = 0.0f;
+		glm::vec3 point = glm::vec3(0.0f); // where the ray hit, or where a cast box's minimum corner stops
+		glm::vec3 normal = glm::vec3(0.0f); // of the face hit, zero when the ray or box started inside
+	};
+
+	// a triangle mesh placed in the world, the mesh is shared and queries are moved into its space
+	struct MeshInstance {
+		const TriangleMesh* mesh;
+		glm::mat4 toWorld;
+		glm::mat4 toModel;
+		AABB bounds; // world space
+	};
+
+	// the boxes of the level, kept in both acceleration structures so the broadphase can be switched at any time,
+	// boxes moved by something else, such as a RigidBodyWorld's bodies, are kept up to date with setBox
+	class CollisionWorld {
+	public:
+		explicit CollisionWorld(float cellSize = 1.0f);
+
+		// returns the box's index
+		int addBox(const CollisionBox& box);
+
+		// moves or resizes a box already in the world
+		void setBox(int index, const CollisionBox& box);
+
+		const CollisionBoxArray& getBoxes() const;
+
+		// places a mesh with the given model to world transform and returns the instance's index,
+		// the mesh is not copied and has to outlive the world
+		int addMesh(const TriangleMesh& mesh, const glm::mat4& transform);
+
+		// swaps the mesh an instance uses, keeping its transform, such as when the model it came from is reloaded
+		void setMesh(int index, const TriangleMesh& mesh);
+
+		const std::vector<MeshInstance>& getMeshes() const;
+
+		// whether any mesh instance touches the box, tested against the triangles in each mesh's space
+		bool overlapsMeshes(const CollisionBox& box) const;
+
+		void setBroadphase(Broadphase broadphase);
+
+		Broadphase getBroadphase() const;
+
+		// indices of the boxes overlapping bounds, in ascending order
+		void queryCandidates(const AABB& bounds, std::vector<int>& results) const;
+
+		void queryCandidates(const AABB& bounds, std::vector<int>& results, Broadphase broadphase) const;
+
+		// runs correctCollisionBoxes against every box the mover's move could touch, in the order the boxes were added,
+		// brute force skips the query and checks every box with the simd kernel
+		void resolve(CollisionBox& mover);
+
+		// nearest box or mesh triangle along the ray within maxDistance, always answered by the aabb trees whichever broadphase is selected
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+
+		// nearest box a box of the given position and dimensions would hit moving maxDistance along direction, meshes are not cast against
+		bool boxCast(const CollisionBox& box, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+
+		// hits[i] answers rays[i], rays are split over the job system's workers
+		void raycast(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits, JobSystem& jobSystem) const;
+
+		// replaces the mover's velocity with how far it can actually move, it stops at the first box in its way
+		// and slides along it with what is left, so nothing is skipped however fast it goes,
+		// then each axis of what is left is shortened until it stops short of every mesh it would move into
+		void moveAndSlide(CollisionBox& mover);
+
+	private:
+		CollisionBoxArray boxes;
+		AABBTree tree;
+		std::vector<int> proxies; // each box's leaf in the tree
+		SpatialHashGrid grid;
+		Broadphase broadphase = Broadphase::Tree;
+		std::vector<int> candidates;
+		std::vector<MeshInstance> meshes;
+		AABBTree meshTree;
+		std::vector<int> meshProxies; // each mesh instance's leaf in meshTree
+		std::vector<int> meshCandidates;
+
+		// mesh instances overlapping bounds
+		void queryMeshes(const AABB& bounds, std::vector<int>& results) const;
+
+		bool overlapsMeshes(const CollisionBox& box, const std::vector<int>& instances) const;
+
+		// earliest fraction of displacement the box can move before it touches one of the instances, false when it touches none
+		bool sweepMeshes(const CollisionBox& box, const glm::vec3& displacement, const std::vector<int>& instances, float& time) const;
+
+		// moves the mover from start towards its position an axis at a time, stopping each axis before it touches a candidate mesh
+		void clipAgainstMeshes(CollisionBox& mover, const glm::vec3& start) const;
+	};
+}
@@ -0,0 +1,153 @@
+#include "FileWatcher.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(double settleSeconds)
+	: settleTime(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(settleSeconds))) {
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef _WIN32
+	for (Directory& directory : directories) {
+		CancelIo(directory.handle);
+		// the cancelled read still owns the buffer until it completes
+		DWORD transferred;
+		GetOverlappedResult(directory.handle, static_cast<OVERLAPPED*>(directory.overlapped), &transferred, TRUE);
+		CloseHandle(directory.event);
+		CloseHandle(directory.handle);
+		delete static_cast<OVERLAPPED*>(directory.overlapped);
+	}
+#else
+	if (descriptor >= 0) {
+		close(descriptor);
+	}
+#endif
+}
+
+bool FileWatcher::watch(const std::string& path) {
+	Directory directory;
+	directory.path = path;
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	HANDLE event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	if (event == nullptr) {
+		CloseHandle(handle);
+		return false;
+	}
+	OVERLAPPED* overlapped = new OVERLAPPED();
+	overlapped->hEvent = event;
+	directory.handle = handle;
+	directory.event = event;
+	directory.overlapped = overlapped;
+	directory.buffer.resize(16384);
+	directories.push_back(directory);
+	if (!queueRead(directories.back())) {
+		CloseHandle(event);
+		CloseHandle(handle);
+		delete overlapped;
+		directories.pop_back();
+		return false;
+	}
+#else
+	if (descriptor < 0) {
+		descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (descriptor < 0) {
+			return false;
+		}
+	}
+	// close after writing covers editors saving in place, moved to covers those saving to a temporary file and renaming it
+	directory.descriptor = inotify_add_watch(descriptor, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (directory.descriptor < 0) {
+		return false;
+	}
+	directories.push_back(directory);
+#endif
+	return true;
+}
+
+#ifdef _WIN32
+bool FileWatcher::queueRead(Directory& directory) {
+	ResetEvent(directory.event);
+	return ReadDirectoryChangesW(directory.handle, directory.buffer.data(), static_cast<DWORD>(directory.buffer.size() * sizeof(uint32_t)), FALSE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, static_cast<OVERLAPPED*>(directory.overlapped), nullptr) != 0;
+}
+#endif
+
+void FileWatcher::readEvents() {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+#ifdef _WIN32
+	for (Directory& directory : directories) {
+		DWORD transferred = 0;
+		if (!GetOverlappedResult(directory.handle, static_cast<OVERLAPPED*>(directory.overlapped), &transferred, FALSE)) {
+			continue;
+		}
+		// nothing transferred means the buffer overflowed and the changes were lost, there is nothing to report for them
+		const char* entry = reinterpret_cast<const char*>(directory.buffer.data());
+		while (transferred > 0) {
+			const FILE_NOTIFY_INFORMATION* information = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+			if (information->Action == FILE_ACTION_MODIFIED || information->Action == FILE_ACTION_ADDED || information->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+				int wideLength = static_cast<int>(information->FileNameLength / sizeof(WCHAR));
+				int length = WideCharToMultiByte(CP_UTF8, 0, information->FileName, wideLength, nullptr, 0, nullptr, nullptr);
+				std::string name(length, '\0');
+				WideCharToMultiByte(CP_UTF8, 0, information->FileName, wideLength, &name[0], length, nullptr, nullptr);
+				changed[directory.path + "/" + name] = now;
+			}
+			if (information->NextEntryOffset == 0) {
+				break;
+			}
+			entry += information->NextEntryOffset;
+		}
+		queueRead(directory);
+	}
+#else
+	if (descriptor < 0) {
+		return;
+	}
+	alignas(inotify_event) char buffer[16384];
+	while (true) {
+		ssize_t length = read(descriptor, buffer, sizeof(buffer));
+		if (length <= 0) {
+			break;
+		}
+		for (char* entry = buffer; entry < buffer + length; entry += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(entry)->len) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(entry);
+			if (event->len == 0 || (event->mask & IN_ISDIR)) {
+				continue;
+			}
+			for (const Directory& directory : directories) {
+				if (directory.descriptor == event->wd) {
+					changed[directory.path + "/" + event->name] = now;
+				}
+			}
+		}
+	}
+#endif
+}
+
+std::vector<std::string> FileWatcher::poll() {
+	readEvents();
+
+	std::vector<std::string> settled;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (auto it = changed.begin(); it != changed.end();) {
+		if (now - it->second >= settleTime) {
+			settled.push_back(it->first);
+			it = changed.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	return settled;
+}
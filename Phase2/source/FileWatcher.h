@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// reports files written or moved into the watched directories, polled once a frame so it never blocks
+// inotify on linux, ReadDirectoryChangesW on windows, subdirectories are not watched
+class FileWatcher {
+public:
+	// a file is only reported once nothing has touched it for settleSeconds, editors save in several writes
+	explicit FileWatcher(double settleSeconds = 0.2);
+
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// false if the directory can't be watched, directories are given and reported with / separators
+	bool watch(const std::string& directory);
+
+	// paths of the files that have settled since the last call, as directory + "/" + name, each once
+	std::vector<std::string> poll();
+
+private:
+	struct Directory {
+		std::string path;
+#ifdef _WIN32
+		void* handle = nullptr;
+		void* event = nullptr;
+		void* overlapped = nullptr;
+		std::vector<uint32_t> buffer; // FILE_NOTIFY_INFORMATION has to be dword aligned
+#else
+		int descriptor = -1;
+#endif
+	};
+
+	void readEvents();
+
+#ifdef _WIN32
+	bool queueRead(Directory& directory);
+#else
+	int descriptor = -1;
+#endif
+
+	std::vector<Directory> directories;
+	std::unordered_map<std::string, std::chrono::steady_clock::time_point> changed; // last touched, not yet reported
+	std::chrono::steady_clock::duration settleTime;
+};
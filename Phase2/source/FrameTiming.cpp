@@ -0,0 +1,61 @@
+#include "FrameTiming.h"
+
+#include <thread>
+
+FixedTimestep::FixedTimestep(double stepSeconds, uint32_t maxStepsPerFrame) : stepSeconds(stepSeconds), maxStepsPerFrame(maxStepsPerFrame) {
+}
+
+uint32_t FixedTimestep::advance(double currentTime) {
+	if (!started) {
+		lastTime = currentTime;
+		started = true;
+		return 0;
+	}
+
+	accumulator += currentTime - lastTime;
+	lastTime = currentTime;
+
+	uint32_t steps = 0;
+	while (accumulator >= stepSeconds && steps < maxStepsPerFrame) {
+		accumulator -= stepSeconds;
+		steps++;
+	}
+	// still behind after the most steps a frame may run, drop the backlog instead of falling further behind every frame
+	if (accumulator >= stepSeconds) {
+		accumulator = 0.0;
+	}
+	return steps;
+}
+
+float FixedTimestep::getAlpha() const {
+	return static_cast<float>(accumulator / stepSeconds);
+}
+
+double FixedTimestep::getStepSeconds() const {
+	return stepSeconds;
+}
+
+void FrameLimiter::setMaxFramesPerSecond(double framesPerSecond) {
+	maxFramesPerSecond = framesPerSecond;
+	nextFrame = std::chrono::steady_clock::now();
+}
+
+double FrameLimiter::getMaxFramesPerSecond() const {
+	return maxFramesPerSecond;
+}
+
+void FrameLimiter::wait() {
+	if (maxFramesPerSecond <= 0.0) {
+		return;
+	}
+
+	std::chrono::steady_clock::duration frameTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / maxFramesPerSecond));
+	nextFrame += frameTime;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (nextFrame < now) {
+		// a slow frame doesn't earn the next ones a burst to catch up
+		nextFrame = now;
+		return;
+	}
+	std::this_thread::sleep_until(nextFrame);
+}
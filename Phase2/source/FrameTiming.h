@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// turns however long the last frame took into a whole number of fixed simulation steps,
+// the time left over says how far between the last two steps the frame should be drawn
+class FixedTimestep {
+public:
+	// at most maxStepsPerFrame steps are run after a long stall, the rest of the time is dropped so the simulation can catch up
+	explicit FixedTimestep(double stepSeconds = 1.0 / 120.0, uint32_t maxStepsPerFrame = 8);
+
+	// adds the time since the last call and returns how many steps to simulate, the first call returns 0
+	uint32_t advance(double currentTime);
+
+	// 0 draws the previous step, 1 the latest one
+	float getAlpha() const;
+
+	double getStepSeconds() const;
+
+private:
+	double stepSeconds;
+	uint32_t maxStepsPerFrame;
+	double accumulator = 0.0;
+	double lastTime = 0.0;
+	bool started = false;
+};
+
+// sleeps until the next frame is due, frames are not limited until a rate is set
+class FrameLimiter {
+public:
+	// 0 removes the cap
+	void setMaxFramesPerSecond(double framesPerSecond);
+
+	double getMaxFramesPerSecond() const;
+
+	void wait();
+
+private:
+	double maxFramesPerSecond = 0.0;
+	std::chrono::steady_clock::time_point nextFrame;
+};
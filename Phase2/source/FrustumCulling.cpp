@@ -0,0 +1,179 @@
+#include "FrustumCulling.h"
+#include "SimdLanes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace frustumCulling {
+	using namespace simd;
+
+	namespace {
+		// a plane with its normal made positive, used for how far a box reaches along the normal
+		struct PlaneLanes {
+			Lanes normal[3];
+			Lanes absNormal[3];
+			Lanes distance;
+		};
+	}
+
+	const uint32_t LANE_COUNT = LANES;
+
+	Frustum extractFrustum(const glm::mat4& viewProjection) {
+		// planes come from the rows of the combined matrix, the near plane is row 2 on its own since depth starts at 0
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0]; // left
+		frustum.planes[1] = rows[3] - rows[0]; // right
+		frustum.planes[2] = rows[3] + rows[1]; // bottom
+		frustum.planes[3] = rows[3] - rows[1]; // top
+		frustum.planes[4] = rows[2];           // near
+		frustum.planes[5] = rows[3] - rows[2]; // far
+
+		for (int i = 0; i < 6; i++) {
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		}
+		return frustum;
+	}
+
+	BoundingVolume computeBoundingVolume(const glm::vec3* positions, size_t count, size_t stride) {
+		BoundingVolume bounds;
+		bounds.aabbMin = glm::vec3(0.0f);
+		bounds.aabbMax = glm::vec3(0.0f);
+		bounds.sphere = glm::vec4(0.0f);
+		if (count == 0) {
+			return bounds;
+		}
+
+		const char* data = reinterpret_cast<const char*>(positions);
+		bounds.aabbMin = glm::vec3(std::numeric_limits<float>::max());
+		bounds.aabbMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (size_t i = 0; i < count; i++) {
+			const glm::vec3& position = *reinterpret_cast<const glm::vec3*>(data + i * stride);
+			bounds.aabbMin = glm::min(bounds.aabbMin, position);
+			bounds.aabbMax = glm::max(bounds.aabbMax, position);
+		}
+
+		glm::vec3 centre = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+		float radius = 0.0f;
+		for (size_t i = 0; i < count; i++) {
+			const glm::vec3& position = *reinterpret_cast<const glm::vec3*>(data + i * stride);
+			radius = std::max(radius, glm::distance(centre, position));
+		}
+		bounds.sphere = glm::vec4(centre, radius);
+		return bounds;
+	}
+
+	uint32_t cullInstances(const Frustum& frustum, const BoundingVolume& bounds, const glm::mat4* transforms, uint32_t count, uint32_t firstIndex, uint32_t* visible) {
+		glm::vec3 centre = glm::vec3(bounds.sphere);
+		glm::vec3 halfExtent = (bounds.aabbMax - bounds.aabbMin) * 0.5f;
+
+		PlaneLanes planes[6];
+		for (int i = 0; i < 6; i++) {
+			for (int axis = 0; axis < 3; axis++) {
+				planes[i].normal[axis] = broadcast(frustum.planes[i][axis]);
+				planes[i].absNormal[axis] = broadcast(std::fabs(frustum.planes[i][axis]));
+			}
+			planes[i].distance = broadcast(frustum.planes[i].w);
+		}
+
+		Lanes centreX = broadcast(centre.x);
+		Lanes centreY = broadcast(centre.y);
+		Lanes centreZ = broadcast(centre.z);
+		Lanes extentX = broadcast(halfExtent.x);
+		Lanes extentY = broadcast(halfExtent.y);
+		Lanes extentZ = broadcast(halfExtent.z);
+		Lanes sphereRadius = broadcast(bounds.sphere.w);
+
+		uint32_t visibleCount = 0;
+		for (uint32_t base = 0; base < count; base += LANES) {
+			uint32_t laneCount = std::min(LANES, count - base);
+
+			// transpose the upper three rows of each transform so every matrix element sits in its own register,
+			// the last instance is repeated into unused lanes and their results are ignored
+			alignas(32) float elements[12][LANES];
+			for (uint32_t lane = 0; lane < LANES; lane++) {
+				const glm::mat4& transform = transforms[base + std::min(lane, laneCount - 1)];
+				for (int column = 0; column < 4; column++) {
+					for (int row = 0; row < 3; row++) {
+						elements[column * 3 + row][lane] = transform[column][row];
+					}
+				}
+			}
+
+			Lanes m[12];
+			for (int i = 0; i < 12; i++) {
+				m[i] = load(elements[i]);
+			}
+
+			// box centre in world space, then how far the box reaches along each world axis
+			Lanes worldX = add(add(add(mul(m[0], centreX), mul(m[3], centreY)), mul(m[6], centreZ)), m[9]);
+			Lanes worldY = add(add(add(mul(m[1], centreX), mul(m[4], centreY)), mul(m[7], centreZ)), m[10]);
+			Lanes worldZ = add(add(add(mul(m[2], centreX), mul(m[5], centreY)), mul(m[8], centreZ)), m[11]);
+			Lanes reachX = add(add(mul(absolute(m[0]), extentX), mul(absolute(m[3]), extentY)), mul(absolute(m[6]), extentZ));
+			Lanes reachY = add(add(mul(absolute(m[1]), extentX), mul(absolute(m[4]), extentY)), mul(absolute(m[7]), extentZ));
+			Lanes reachZ = add(add(mul(absolute(m[2]), extentX), mul(absolute(m[5]), extentY)), mul(absolute(m[8]), extentZ));
+
+			// the sphere grows with the largest axis scale
+			Lanes scale0 = add(add(mul(m[0], m[0]), mul(m[1], m[1])), mul(m[2], m[2]));
+			Lanes scale1 = add(add(mul(m[3], m[3]), mul(m[4], m[4])), mul(m[5], m[5]));
+			Lanes scale2 = add(add(mul(m[6], m[6]), mul(m[7], m[7])), mul(m[8], m[8]));
+			Lanes radius = mul(sphereRadius, squareRoot(maximum(maximum(scale0, scale1), scale2)));
+
+			Lanes outside = none();
+			for (int i = 0; i < 6; i++) {
+				Lanes distance = add(add(add(mul(planes[i].normal[0], worldX), mul(planes[i].normal[1], worldY)), mul(planes[i].normal[2], worldZ)), planes[i].distance);
+				Lanes boxReach = add(add(mul(planes[i].absNormal[0], reachX), mul(planes[i].absNormal[1], reachY)), mul(planes[i].absNormal[2], reachZ));
+				// whichever volume is tighter against this plane decides
+				outside = either(outside, less(distance, negate(minimum(radius, boxReach))));
+			}
+
+			uint32_t mask = laneMask(outside);
+			for (uint32_t lane = 0; lane < laneCount; lane++) {
+				if ((mask & (1u << lane)) == 0) {
+					visible[visibleCount++] = firstIndex + base + lane;
+				}
+			}
+		}
+
+		return visibleCount;
+	}
+
+	uint32_t cullInstancesScalar(const Frustum& frustum, const BoundingVolume& bounds, const glm::mat4* transforms, uint32_t count, uint32_t firstIndex, uint32_t* visible) {
+		glm::vec3 centre = glm::vec3(bounds.sphere);
+		glm::vec3 halfExtent = (bounds.aabbMax - bounds.aabbMin) * 0.5f;
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			const glm::mat4& m = transforms[i];
+
+			glm::vec3 world;
+			glm::vec3 reach;
+			for (int row = 0; row < 3; row++) {
+				world[row] = m[0][row] * centre.x + m[1][row] * centre.y + m[2][row] * centre.z + m[3][row];
+				reach[row] = std::fabs(m[0][row]) * halfExtent.x + std::fabs(m[1][row]) * halfExtent.y + std::fabs(m[2][row]) * halfExtent.z;
+			}
+
+			float scale = std::max(std::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])), glm::dot(glm::vec3(m[1]), glm::vec3(m[1]))), glm::dot(glm::vec3(m[2]), glm::vec3(m[2])));
+			float radius = bounds.sphere.w * std::sqrt(scale);
+
+			bool outside = false;
+			for (int p = 0; p < 6; p++) {
+				const glm::vec4& plane = frustum.planes[p];
+				float distance = plane.x * world.x + plane.y * world.y + plane.z * world.z + plane.w;
+				float boxReach = std::fabs(plane.x) * reach.x + std::fabs(plane.y) * reach.y + std::fabs(plane.z) * reach.z;
+				outside = outside || distance < -std::min(radius, boxReach);
+			}
+
+			if (!outside) {
+				visible[visibleCount++] = firstIndex + i;
+			}
+		}
+
+		return visibleCount;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// cpu side frustum culling of instance transforms, has no vulkan dependency so it can run and be checked without a gpu
+// instances are tested several at a time with sse, or avx when the compiler targets it
+namespace frustumCulling {
+	// number of instances tested per instruction
+	extern const uint32_t LANE_COUNT;
+
+	// world space planes, xyz = normal pointing inwards, w = distance
+	struct Frustum {
+		glm::vec4 planes[6];
+	};
+
+	// model space bounds of a mesh, the sphere is centred on the box
+	struct BoundingVolume {
+		glm::vec3 aabbMin;
+		glm::vec3 aabbMax;
+		glm::vec4 sphere; // xyz = centre, w = radius
+	};
+
+	struct CullStats {
+		uint32_t tested = 0;
+		uint32_t drawn = 0;
+		uint32_t culled = 0;
+	};
+
+	// vulkan clip space, depth runs from 0 to 1
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+
+	BoundingVolume computeBoundingVolume(const glm::vec3* positions, size_t count, size_t stride = sizeof(glm::vec3));
+
+	// writes firstIndex + i for every visible transforms[i] to visible, in order, and returns how many were written
+	// visible must have room for count entries, an instance is culled when its sphere or its box is outside a plane
+	uint32_t cullInstances(const Frustum& frustum, const BoundingVolume& bounds, const glm::mat4* transforms, uint32_t count, uint32_t firstIndex, uint32_t* visible);
+
+	// reference version testing one instance at a time, cullInstances gives the same visible list
+	uint32_t cullInstancesScalar(const Frustum& frustum, const BoundingVolume& bounds, const glm::mat4* transforms, uint32_t count, uint32_t firstIndex, uint32_t* visible);
+}
@@ -12,10 +12,12 @@
 #define NOMINMAX
 #include <windows.h>
 
+#include <cctype>
 #include <unordered_set>
 
 	void Graphics::init() {
 		initWindow();
+		jobSystem.init();
 		initVulkan();
 	}
 
@@ -48,12 +50,24 @@
 		descriptorSetObjects.emplace_back("Texture", VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(Texture), 1);
 		descriptorSetObjects.emplace_back("Storage Buffer", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4) * MAX_RENDER_INSTANCES, 1);
 		descriptorSetObjects.emplace_back("Light Buffer", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(LightData) * MAX_RENDER_INSTANCES, 1);
+		descriptorSetObjects.emplace_back("Draw Data", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawData) * MAX_INDIRECT_DRAWS, 1);
+		descriptorSetObjects.emplace_back("Visible Instances", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, sizeof(uint32_t) * MAX_VISIBLE_SLOTS, 1);
+		descriptorSetObjects.emplace_back("Material Table", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, sizeof(MaterialData) * MAX_MATERIALS, 1);
+
+		//the cull compute pass has its own set, the names match the graphics set so the same resources get bound
+		cullDescriptorSetObjects.emplace_back("Uniform Buffer", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(UniformBufferObject), 1);
+		cullDescriptorSetObjects.emplace_back("Storage Buffer", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(glm::mat4) * MAX_RENDER_INSTANCES, 1);
+		cullDescriptorSetObjects.emplace_back("Draw Data", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(DrawData) * MAX_INDIRECT_DRAWS, 1);
+		cullDescriptorSetObjects.emplace_back("Indirect Commands", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(VkDrawIndexedIndirectCommand) * MAX_INDIRECT_DRAWS, 1);
+		cullDescriptorSetObjects.emplace_back("Visible Instances", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(uint32_t) * MAX_VISIBLE_SLOTS, 1);
+		cullDescriptorSetObjects.emplace_back("Meshlet Table", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(meshletCulling::Meshlet) * MAX_MESHLETS, 1);
 
 		//fill push constant info vector
 		pushConstantInfos.emplace_back(sizeof(PushConstants), VK_SHADER_STAGE_VERTEX_BIT);
 		pushConstantInfos.emplace_back(sizeof(int), VK_SHADER_STAGE_FRAGMENT_BIT);
 		//pushConstantInfos.emplace_back(sizeof(float), VK_SHADER_STAGE_FRAGMENT_BIT);
-		pipelineBundles.push_back(createCurrentPipelineBundle(descriptorSetObjects, swapChainExtent, renderPass, swapChainImages.size(), pushConstantInfos));
+		pipelineBundles.push_back(createCurrentPipelineBundle(descriptorSetObjects, swapChainExtent, renderPass, swapChainImages.size(), pushConstantInfos,
+			indirectDrawEnabled ? INDIRECT_VERTEX_SHADER_PATH : VERTEX_SHADER_PATH));
 
 		createTextureAtlasArray({});
 		createCommandPool();
@@ -70,34 +84,37 @@
 		loadObjects();
 		createVertexBuffer();
 		createIndexBuffer();
+		materialBuffer = createStorageBuffer("material buffer", sizeof(MaterialData) * MAX_MATERIALS, 0, materialTable.data(), sizeof(MaterialData) * materialTable.size());
+		meshletBuffer = createStorageBuffer("meshlet buffer", sizeof(meshletCulling::Meshlet) * MAX_MESHLETS, 0, meshletTable.data(), sizeof(meshletCulling::Meshlet) * meshletTable.size(), true);
 		
 		transformBuffer = createStorageBuffer("transform buffer",sizeof(glm::mat4) * MAX_RENDER_INSTANCES);
-		std::vector<glm::mat4> storageBufferData;
-		for (int i = 0; i < renderInstances.size(); i++) {
-			for (int j = 0; j < renderInstanceIndexes[i]; j++) {
-				storageBufferData.push_back(renderInstances[i][j].transformData);
-			}
-		}
-
-		updateStorageBuffer(transformBuffer, storageBufferData);
 
 		addLight(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f), 0.0f);
 		lightBuffer = createStorageBuffer("light buffer", sizeof(LightData) * MAX_RENDER_INSTANCES);
-		updateStorageBuffer(lightBuffer, lights);
-		
+
+		drawDataBuffer = createStorageBuffer("draw data buffer", sizeof(DrawData) * MAX_INDIRECT_DRAWS);
+		indirectBuffer = createStorageBuffer("indirect buffer", sizeof(VkDrawIndexedIndirectCommand) * MAX_INDIRECT_DRAWS, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+		indirectTemplateBuffer = createStorageBuffer("indirect template buffer", sizeof(VkDrawIndexedIndirectCommand) * MAX_INDIRECT_DRAWS, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		visibleInstanceBuffer = createStorageBuffer("visible instance buffer", sizeof(uint32_t) * MAX_VISIBLE_SLOTS);
+
+		// transforms and lights are written into this every frame and copied to the device local buffers on the gpu timeline
+		createUploadRing(transformBuffer.size + lightBuffer.size + drawDataBuffer.size + indirectBuffer.size + indirectTemplateBuffer.size + visibleInstanceBuffer.size + materialBuffer.size);
+		createUploadCommandBuffers();
+
 		createUniformBuffers();
 
-		updateDescriptorResource(pipelineBundles[0], "Uniform Buffer", descriptorResource(uniformBuffers));
-		updateDescriptorResource(pipelineBundles[0], "Texture", descriptorResource(textureSampler, textureImageView));
-		updateDescriptorResource(pipelineBundles[0], "Storage Buffer", descriptorResource(transformBuffer.buffer));
-		updateDescriptorResource(pipelineBundles[0], "Light Buffer", descriptorResource(lightBuffer.buffer));
-		for (int i = 0; i < swapChainImages.size(); i++) {
-			updateDescriptorSet(pipelineBundles[0], i);
+		bindDescriptorResources(pipelineBundles[0]);
+
+		if (gpuCullingEnabled) {
+			cullPushConstantInfos.emplace_back(sizeof(CullPushConstants), VK_SHADER_STAGE_COMPUTE_BIT);
+			cullPipelineBundles.push_back(createCullPipelineBundle(cullDescriptorSetObjects, swapChainImages.size(), cullPushConstantInfos));
+			bindDescriptorResources(cullPipelineBundles[0]);
 		}
 		
 		createCommandBuffers();
 		createSyncObjects();
 		setUpCamera();
+		startStreaming();
 
 		printSampleCount();
 	}
@@ -105,12 +122,11 @@
 	void Graphics::run() {
 		if (!glfwWindowShouldClose(window)) {
 			glfwPollEvents();
+			pollResourceChanges();
 			drawFrame();
 		} else {
 			shouldClose = true;
 		}
-
-		vkDeviceWaitIdle(device);
 	}
 
 	void Graphics::cleanupSwapChain() { 
@@ -126,7 +142,13 @@
 			vkDestroyFramebuffer(device, framebuffer, nullptr);
 		}
 
-		vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		vkFreeCommandBuffers(device, drawCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		for (auto& imagePools : workerCommandPools) {
+			for (auto& workerPool : imagePools) {
+				vkDestroyCommandPool(device, workerPool.pool, nullptr);
+			}
+		}
+		workerCommandPools.clear();
 
 		vkDestroyPipeline(device, graphicsPipeline, nullptr);
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
@@ -140,6 +162,28 @@
 	}
 
 	void Graphics::cleanup() {
+		// loaders may be submitting, they are stopped before anything they use goes
+		stopStreamingThreads();
+		vkDeviceWaitIdle(device);
+
+		for (StreamedModel& streamed : streamedModels) {
+			vkDestroySemaphore(device, streamed.copied, nullptr);
+		}
+		for (VkSemaphore semaphore : streamWaitSemaphores) {
+			vkDestroySemaphore(device, semaphore, nullptr);
+		}
+		streamedTextures.insert(streamedTextures.end(), textureCopies.begin(), textureCopies.end());
+		for (StreamedTexture& texture : streamedTextures) {
+			vkDestroyBuffer(device, texture.stagingBuffer, nullptr);
+			vkFreeMemory(device, texture.stagingBufferMemory, nullptr);
+		}
+		for (FrameRetirements& retirements : frameRetirements) {
+			destroyFrameRetirements(retirements);
+		}
+		for (VkCommandPool pool : streamingCommandPools) {
+			vkDestroyCommandPool(device, pool, nullptr);
+		}
+
 		cleanupSwapChain();
 
 		vkDestroySampler(device, textureSampler, nullptr);
@@ -157,6 +201,20 @@
 			vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
 		}
 
+		for (auto& bundle : cullPipelineBundles) {
+			destroyPipelineBundle(bundle);
+		}
+
+		destroyUploadRing();
+		clearStorageBuffer(transformBuffer);
+		clearStorageBuffer(lightBuffer);
+		clearStorageBuffer(drawDataBuffer);
+		clearStorageBuffer(indirectBuffer);
+		clearStorageBuffer(indirectTemplateBuffer);
+		clearStorageBuffer(visibleInstanceBuffer);
+		clearStorageBuffer(materialBuffer);
+		clearStorageBuffer(meshletBuffer);
+
 		vkDestroyBuffer(device, indexBuffer, nullptr);
 		vkFreeMemory(device, indexBufferMemory, nullptr);
 
@@ -169,6 +227,7 @@
 			vkDestroyFence(device, inFlightFences[i], nullptr);
 		}
 
+		vkDestroyCommandPool(device, drawCommandPool, nullptr);
 		vkDestroyCommandPool(device, commandPool, nullptr);
 
 		vkDestroyDevice(device, nullptr);
@@ -183,6 +242,8 @@
 		glfwDestroyWindow(window);
 
 		glfwTerminate();
+
+		jobSystem.shutdown();
 	}
 
 	void Graphics::recreateSwapChain() {
@@ -192,7 +253,10 @@
 			glfwWaitEvents();
 		}
 
-		vkDeviceWaitIdle(device);
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			vkDeviceWaitIdle(device);
+		}
 
 		cleanupSwapChain(); //NEED TO FIX THIS
 
@@ -200,24 +264,26 @@
 		createImageViews();
 		createRenderPass();
 		pipelineBundles.clear();
-		std::vector<descriptorSetObject> descriptorSetObjects;
-		descriptorSetObjects.emplace_back("Uniform Buffer", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, sizeof(UniformBufferObject), 1);
-		descriptorSetObjects.emplace_back("Texture", VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(Texture), 1);
-		descriptorSetObjects.emplace_back("Storage Buffer", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4) * MAX_RENDER_INSTANCES, 1);
-		pipelineBundles.push_back(createCurrentPipelineBundle(descriptorSetObjects, swapChainExtent, renderPass, swapChainImages.size(), pushConstantInfos));
+		// same layout as at startup, so the shaders keep seeing every binding
+		pipelineBundles.push_back(createCurrentPipelineBundle(descriptorSetObjects, swapChainExtent, renderPass, swapChainImages.size(), pushConstantInfos,
+			indirectDrawEnabled ? INDIRECT_VERTEX_SHADER_PATH : VERTEX_SHADER_PATH));
 		createColorResources();
 		createDepthResources();
 		createFramebuffers();
 
-		updateDescriptorResource(pipelineBundles[0], "Uniform Buffer", descriptorResource(uniformBuffers));
-		updateDescriptorResource(pipelineBundles[0], "Texture", descriptorResource(textureSampler, textureImageView));
-		updateDescriptorResource(pipelineBundles[0], "Storage Buffer", descriptorResource(transformBuffer.buffer));
-		for (int i = 0; i < swapChainImages.size(); i++) {
-			updateDescriptorSet(pipelineBundles[0], i);
+		bindDescriptorResources(pipelineBundles[0]);
+
+		// the cull pass has a descriptor set per swap chain image as well, the image count can change with the swap chain
+		if (gpuCullingEnabled) {
+			destroyPipelineBundle(cullPipelineBundles[0]);
+			cullPipelineBundles.clear();
+			cullPipelineBundles.push_back(createCullPipelineBundle(cullDescriptorSetObjects, swapChainImages.size(), cullPushConstantInfos));
+			bindDescriptorResources(cullPipelineBundles[0]);
 		}
 
 		createCommandBuffers();
-		
+		commandBuffersDirty = true;
+		imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
 	}
 
 	void Graphics::printSampleCount() {
@@ -332,24 +398,68 @@
 	void Graphics::createLogicalDevice() {
 		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		// without a transfer only family, a second queue of the graphics family still lets loader copies run beside the frame's work
+		bool dedicatedTransfer = indices.transferFamily != indices.graphicsFamily;
+		bool secondGraphicsQueue = !dedicatedTransfer && queueFamilies[indices.graphicsFamily].queueCount > 1;
+
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-		std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+		std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
 
-		float queuePriority = 1.0f;
+		float queuePriorities[] = { 1.0f, 0.5f };
 		for (int queueFamily : uniqueQueueFamilies) {
 			VkDeviceQueueCreateInfo queueCreateInfo = {};
 			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 			queueCreateInfo.queueFamilyIndex = queueFamily;
-			queueCreateInfo.queueCount = 1;
-			queueCreateInfo.pQueuePriorities = &queuePriority;
+			queueCreateInfo.queueCount = (queueFamily == indices.graphicsFamily && secondGraphicsQueue) ? 2 : 1;
+			queueCreateInfo.pQueuePriorities = queuePriorities;
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		// indirect drawing needs every draw of a frame in one call and gl_DrawID to find each draw's material data
+		VkPhysicalDeviceShaderDrawParametersFeatures supportedDrawParameters = {};
+		supportedDrawParameters.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
+		VkPhysicalDeviceFeatures2 supportedFeatures = {};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &supportedDrawParameters;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+		indirectDrawEnabled = supportedFeatures.features.multiDrawIndirect && supportedFeatures.features.drawIndirectFirstInstance &&
+			supportedDrawParameters.shaderDrawParameters;
+		if (indirectDrawEnabled && !fileExists(INDIRECT_VERTEX_SHADER_PATH)) {
+			std::cerr << "error: " << INDIRECT_VERTEX_SHADER_PATH << " is missing, run compile.bat in the shaders directory" << std::endl;
+			indirectDrawEnabled = false;
+		}
+		if (!indirectDrawEnabled) {
+			std::cout << "indirect drawing unavailable, recording one draw per model" << std::endl;
+		}
+
+		// the cull pass is recorded into the draw command buffers, so the graphics queue has to take compute work too
+		gpuCullingEnabled = indirectDrawEnabled && (queueFamilies[indices.graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT);
+		if (gpuCullingEnabled && !fileExists(CULL_SHADER_PATH)) {
+			std::cerr << "error: " << CULL_SHADER_PATH << " is missing, run compile.bat in the shaders directory" << std::endl;
+			gpuCullingEnabled = false;
+		}
+		if (indirectDrawEnabled && !gpuCullingEnabled) {
+			std::cout << "gpu culling unavailable, culling instances on the cpu" << std::endl;
+		}
+
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.multiDrawIndirect = indirectDrawEnabled;
+		deviceFeatures.drawIndirectFirstInstance = indirectDrawEnabled;
+
+		VkPhysicalDeviceShaderDrawParametersFeatures drawParameters = {};
+		drawParameters.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
+		drawParameters.shaderDrawParameters = indirectDrawEnabled;
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &drawParameters;
 
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -373,6 +483,17 @@
 
 		vkGetDeviceQueue(device, indices.graphicsFamily, 0, &graphicsQueue);
 		vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
+		if (dedicatedTransfer) {
+			vkGetDeviceQueue(device, indices.transferFamily, 0, &transferQueue);
+			sharedQueueFamilies = { static_cast<uint32_t>(indices.graphicsFamily), static_cast<uint32_t>(indices.transferFamily) };
+		}
+		else if (secondGraphicsQueue) {
+			vkGetDeviceQueue(device, indices.graphicsFamily, 1, &transferQueue);
+		}
+		else {
+			transferQueue = graphicsQueue;
+		}
+		std::cout << "streaming uploads on " << (dedicatedTransfer ? "a transfer only queue family" : secondGraphicsQueue ? "a second graphics queue" : "the graphics queue") << std::endl;
 	}
 
 	void Graphics::createColorResources() {
@@ -547,10 +668,16 @@
 		VkCommandPoolCreateInfo poolInfo = {};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // upload command buffers are re-recorded every frame
 
 		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create graphics command pool!");
 		}
+
+		// the push constant path records one image's draw command buffer again every frame
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &drawCommandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create draw command pool!");
+		}
 	}
 
 	void Graphics::createDepthResources() {
@@ -933,7 +1060,128 @@
 		return glm::vec2(0, 0);
 	}
 
-	void Graphics::loadModel(std::string path, glm::vec4 defaultColor, float scale) {
+	void Graphics::loadModel(std::string path, glm::vec4 defaultColor, float scale, bool buildCollider, bool generateLods) {
+		loadModels({ { path, defaultColor, scale, buildCollider, generateLods } });
+	}
+
+	void Graphics::loadModels(const std::vector<ModelSource>& sources) {
+		std::vector<ImportedModel> imported(sources.size());
+		jobSystem.parallelFor(static_cast<uint32_t>(sources.size()), [&](uint32_t index, uint32_t) {
+			importModel(sources[index], imported[index]);
+		});
+
+		for (size_t i = 0; i < sources.size(); i++) {
+			ImportedModel& model = imported[i];
+			if (!model.cacheWritten) {
+				std::cout << "couldn't write " << sources[i].path << ".mesh" << std::endl;
+			}
+			if (model.optimized) {
+				std::cout << sources[i].path << " acmr " << model.before.acmr << " -> " << model.after.acmr
+					<< ", atvr " << model.before.atvr << " -> " << model.after.atvr << ", " << model.meshlets.size() << " meshlets" << std::endl;
+			}
+			if (model.cooked) {
+				addModel(static_cast<const Vertex*>(model.cooked->getVertices()), model.cooked->getVertexCount(), model.cooked->getIndices(), model.cooked->getIndexCount(),
+					model.cooked->getLods(), model.cooked->getLodCount(), static_cast<const meshletCulling::Meshlet*>(model.cooked->getMeshlets()), model.cooked->getMeshletCount(),
+					static_cast<const MaterialData*>(model.cooked->getMaterials()), model.cooked->getMaterialCount(), model.textureName, model.normalMapName, sources[i].buildCollider);
+			}
+			else {
+				addModel(model.vertices.data(), static_cast<uint32_t>(model.vertices.size()), model.indices.data(), static_cast<uint32_t>(model.indices.size()),
+					model.lods.data(), static_cast<uint32_t>(model.lods.size()), model.meshlets.data(), static_cast<uint32_t>(model.meshlets.size()),
+					model.materials.data(), static_cast<uint32_t>(model.materials.size()), model.textureName, model.normalMapName, sources[i].buildCollider);
+			}
+			modelSources.push_back(sources[i]);
+			const Model& added = models.back();
+			if (added.lods.size() > 1) {
+				std::cout << sources[i].path << " lods";
+				for (const ModelLod& lod : added.lods) {
+					std::cout << " " << lod.size / 3 << " (" << lod.error << ")";
+				}
+				std::cout << std::endl;
+			}
+			// the mapping and the parsed copy are done with once the model is in the shared arrays
+			model = ImportedModel();
+		}
+	}
+
+	namespace {
+		// orders each meshlet's triangles for the vertex cache on their own, as that is how the gpu sees them once culling splits them up,
+		// the indices are numbered within the meshlet first so the pass only costs the meshlet's vertices, not the model's
+		void optimizeMeshletVertexCache(uint32_t* indices, const std::vector<meshletCulling::Meshlet>& meshlets) {
+			std::vector<uint32_t> vertices;
+			std::vector<uint32_t> local;
+			for (const meshletCulling::Meshlet& meshlet : meshlets) {
+				uint32_t* first = indices + meshlet.firstIndex;
+				vertices.assign(first, first + meshlet.indexCount);
+				std::sort(vertices.begin(), vertices.end());
+				vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+				local.resize(meshlet.indexCount);
+				for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+					local[i] = static_cast<uint32_t>(std::lower_bound(vertices.begin(), vertices.end(), first[i]) - vertices.begin());
+				}
+				meshOptimizer::optimizeVertexCache(local.data(), local.size(), vertices.size());
+				for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+					first[i] = vertices[local[i]];
+				}
+			}
+		}
+	}
+
+	void Graphics::importModel(const ModelSource& source, ImportedModel& imported) {
+		// the cooked copy depends on the parameters the obj is imported with as well as on the files
+		uint64_t sourceHash;
+		if (!meshCache::hashSource(source.path, sourceHash)) {
+			throw std::runtime_error("failed to open model " + source.path);
+		}
+		sourceHash = meshCache::hashBytes(&source.colour, sizeof(source.colour), sourceHash);
+		sourceHash = meshCache::hashBytes(&source.scale, sizeof(source.scale), sourceHash);
+		uint32_t lodCount = source.generateLods ? GENERATED_LODS : 0;
+		sourceHash = meshCache::hashBytes(&lodCount, sizeof(lodCount), sourceHash);
+
+		std::string cookedPath = source.path + ".mesh";
+		std::unique_ptr<meshCache::CookedMesh> cooked(new meshCache::CookedMesh());
+		if (cooked->open(cookedPath, sourceHash, sizeof(Vertex), sizeof(MaterialData), sizeof(meshletCulling::Meshlet))) {
+			imported.textureName = cooked->getTextureName();
+			imported.normalMapName = cooked->getNormalMapName();
+			imported.cooked = std::move(cooked);
+			return;
+		}
+
+		importObj(source.path, source.colour, source.scale, imported.vertices, imported.indices, imported.materials, imported.textureName, imported.normalMapName);
+
+		// triangles reordered for the vertex cache and overdraw, then grouped into meshlets, each reordered for the vertex cache again,
+		// then vertices for fetching in the order they're used
+		imported.before = meshOptimizer::analyzeVertexCache(imported.indices.data(), imported.indices.size(), imported.vertices.size());
+		if (!imported.vertices.empty()) {
+			meshOptimizer::optimizeOverdraw(imported.indices.data(), imported.indices.size(), &imported.vertices[0].pos, sizeof(Vertex), imported.vertices.size());
+			imported.meshlets = meshletCulling::buildMeshlets(imported.indices.data(), imported.indices.size(), &imported.vertices[0].pos, sizeof(Vertex), imported.vertices.size());
+			optimizeMeshletVertexCache(imported.indices.data(), imported.meshlets);
+			imported.vertices.resize(meshOptimizer::optimizeVertexFetch(imported.vertices.data(), imported.vertices.size(), sizeof(Vertex), imported.indices.data(), imported.indices.size()));
+		}
+		imported.after = meshOptimizer::analyzeVertexCache(imported.indices.data(), imported.indices.size(), imported.vertices.size());
+		imported.optimized = true;
+
+		// coarser copies of the triangles go after the full ones, each ordered for the vertex cache on its own
+		imported.lods.push_back({ 0, static_cast<uint32_t>(imported.indices.size()), 0.0f, 0 });
+		if (lodCount > 0 && !imported.vertices.empty()) {
+			std::vector<meshSimplifier::Lod> chain = meshSimplifier::buildLodChain(imported.indices.data(), imported.indices.size(),
+				&imported.vertices[0].pos, sizeof(Vertex), imported.vertices.size(), lodCount);
+			for (meshSimplifier::Lod& lod : chain) {
+				meshOptimizer::optimizeVertexCache(lod.indices.data(), lod.indices.size(), imported.vertices.size());
+				imported.lods.push_back({ static_cast<uint32_t>(imported.indices.size()), static_cast<uint32_t>(lod.indices.size()), lod.error, 0 });
+				imported.indices.insert(imported.indices.end(), lod.indices.begin(), lod.indices.end());
+			}
+		}
+
+		// a read only install just imports every time
+		imported.cacheWritten = meshCache::write(cookedPath, sourceHash, imported.vertices.data(), sizeof(Vertex), static_cast<uint32_t>(imported.vertices.size()),
+			imported.indices.data(), static_cast<uint32_t>(imported.indices.size()), imported.materials.data(), sizeof(MaterialData), static_cast<uint32_t>(imported.materials.size()),
+			imported.lods.data(), static_cast<uint32_t>(imported.lods.size()), imported.meshlets.data(), sizeof(meshletCulling::Meshlet), static_cast<uint32_t>(imported.meshlets.size()),
+			imported.textureName, imported.normalMapName);
+	}
+
+	void Graphics::importObj(const std::string& path, glm::vec4 defaultColor, float scale, std::vector<Vertex>& modelVertices, std::vector<uint32_t>& modelIndices,
+		std::vector<MaterialData>& modelMaterials, std::string& textureName, std::string& normalMapName) {
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -944,16 +1192,16 @@
 			throw std::runtime_error(warn + err);
 		}
 
-		uint32_t vertexOffset = static_cast<uint32_t>(vertices.size());
-		uint32_t indexOffset = static_cast<uint32_t>(indices.size());
-		std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
-
-		VkImageView modelTextureView = VK_NULL_HANDLE;
-		VkImageView normalMapView = VK_NULL_HANDLE;
-
-		std::string textureName;
-		std::string normalMapName;
-		bool hasNormalMap = false;
+		// the outputs are this model's alone, indices count from its first vertex
+		modelVertices.clear();
+		modelIndices.clear();
+		modelMaterials.clear();
+		textureName.clear();
+		normalMapName.clear();
+		// most vertices of a closed mesh are shared by several faces, so there are about as many unique ones as positions
+		VertexWelder<Vertex> welder(modelVertices, attrib.vertices.size() / 3);
+		// the model's material id for each obj material, the last entry is for faces without one, added when first used
+		std::vector<int> materialIds(materials.size() + 1, -1);
 
 		// Load textures if available
 		if (!materials.empty()) {
@@ -967,7 +1215,6 @@
 			}
 			if (!material.bump_texname.empty()) {
 				normalMapName = material.bump_texname;
-				hasNormalMap = true;
 			}
 		}
 
@@ -983,53 +1230,87 @@
 				};
 
 				if (index.normal_index >= 0) {
-					vertex.normal = {
+					glm::vec3 normal = {
 						attrib.normals[3 * index.normal_index + 0],
 						attrib.normals[3 * index.normal_index + 1],
 						attrib.normals[3 * index.normal_index + 2]
 					};
+					vertexPacking::packOctahedral(normal, vertex.normal);
 				}
 
 				if (index.texcoord_index >= 0) {
-					vertex.texCoord = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-					};
+					vertex.texCoord[0] = vertexPacking::packHalf(attrib.texcoords[2 * index.texcoord_index + 0]);
+					vertex.texCoord[1] = vertexPacking::packHalf(1.0f - attrib.texcoords[2 * index.texcoord_index + 1]);
 				}
 
 				// Get material for this face
 				int materialId = shape.mesh.material_ids[index.vertex_index / 3];
-				if (materialId >= 0 && materialId < materials.size()) {
-					const auto& material = materials[materialId];
-					vertex.diffuse = glm::vec3(0.5f);// glm::vec3(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
-					vertex.specular = glm::vec3(0.1f); //glm::vec3(material.specular[0], material.specular[1], material.specular[2]);
-					vertex.ambient = glm::vec3(0.1f); //glm::vec3(material.ambient[0], material.ambient[1], material.ambient[2]);
-					vertex.shininess = 1.0f; //material.shininess;
-					vertex.opacity = 1.0f; //material.dissolve;
-				}
-				else {
-					// Use default color if no material is specified
-					vertex.diffuse = glm::vec3(defaultColor);
-					vertex.specular = glm::vec3(0.5f);
-					vertex.ambient = glm::vec3(0.1f);
-					vertex.shininess = 32.0f;
-					vertex.opacity = defaultColor.a;
+				bool hasMaterial = materialId >= 0 && materialId < materials.size();
+				int& modelMaterial = materialIds[hasMaterial ? materialId : materials.size()];
+				if (modelMaterial < 0) {
+					MaterialData data;
+					if (hasMaterial) {
+						const auto& material = materials[materialId];
+						data.diffuse = glm::vec4(glm::vec3(0.5f), 1.0f);// glm::vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], material.dissolve);
+						data.specular = glm::vec4(glm::vec3(0.1f), 1.0f); //glm::vec4(material.specular[0], material.specular[1], material.specular[2], material.shininess);
+						data.ambient = glm::vec4(glm::vec3(0.1f), 0.0f); //glm::vec4(material.ambient[0], material.ambient[1], material.ambient[2], 0.0f);
+					}
+					else {
+						// Use default color if no material is specified
+						data.diffuse = glm::vec4(glm::vec3(defaultColor), defaultColor.a);
+						data.specular = glm::vec4(glm::vec3(0.5f), 32.0f);
+						data.ambient = glm::vec4(glm::vec3(0.1f), 0.0f);
+					}
+					modelMaterial = static_cast<int>(modelMaterials.size());
+					modelMaterials.push_back(data);
 				}
+				vertex.material = static_cast<uint16_t>(modelMaterial);
 
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-				indices.push_back(uniqueVertices[vertex]);
+				modelIndices.push_back(welder.weld(vertex));
 			}
 		}
+	}
 
-		uint32_t vertexCount = static_cast<uint32_t>(vertices.size()) - vertexOffset;
-		uint32_t indexCount = static_cast<uint32_t>(indices.size()) - indexOffset;
+	std::vector<uint16_t> Graphics::addMaterials(const MaterialData* modelMaterials, uint32_t materialCount) {
+		// models loaded with the same colour share their materials, so the table stays small
+		std::vector<uint16_t> materialIds(materialCount);
+		for (uint32_t i = 0; i < materialCount; i++) {
+			size_t found = 0;
+			while (found < materialTable.size() && memcmp(&materialTable[found], &modelMaterials[i], sizeof(MaterialData)) != 0) {
+				found++;
+			}
+			if (found == materialTable.size()) {
+				if (materialTable.size() >= static_cast<size_t>(MAX_MATERIALS)) {
+					throw std::runtime_error("too many materials!");
+				}
+				materialTable.push_back(modelMaterials[i]);
+			}
+			materialIds[i] = static_cast<uint16_t>(found);
+		}
+		return materialIds;
+	}
 
+	Model Graphics::createModel(const Vertex* modelVertices, uint32_t vertexCount, const uint32_t* modelIndices, uint32_t vertexOffset, uint32_t indexOffset,
+		const meshCache::LodRange* lods, uint32_t lodCount, uint32_t indexCount, uint32_t firstMeshlet, uint32_t meshletCount,
+		const std::string& textureName, const std::string& normalMapName, bool buildCollider) {
 		Model newModel;
-		newModel.offset = indexOffset;
-		newModel.size = indexCount;
+		bool hasNormalMap = !normalMapName.empty();
+		if (lodCount > static_cast<uint32_t>(MAX_MODEL_LODS)) {
+			throw std::runtime_error("too many lods!");
+		}
+		for (uint32_t i = 0; i < lodCount; i++) {
+			newModel.lods.push_back({ indexOffset + lods[i].first, lods[i].count, lods[i].error });
+		}
+		if (newModel.lods.empty()) {
+			newModel.lods.push_back({ indexOffset, indexCount, 0.0f });
+		}
+		newModel.offset = newModel.lods[0].offset;
+		newModel.size = newModel.lods[0].size;
+		newModel.firstMeshlet = firstMeshlet;
+		newModel.meshletCount = meshletCount;
+		newModel.vertexOffset = vertexOffset;
+		newModel.vertexCount = vertexCount;
+		newModel.indexCount = indexCount;
 		newModel.textureOffset = getAtlasOffset(textureName);
 		newModel.textureSize = getAtlasSize(textureName);
 		if (hasNormalMap) {
@@ -1038,140 +1319,1093 @@
 			std::cout << "normal map is " << normalMapName << std::endl;
 		}
 		newModel.hasNormalMap = hasNormalMap;
-		models.push_back(newModel);
+		// box and sphere around the model's vertices, instances are culled with them
+		newModel.bounds = frustumCulling::computeBoundingVolume(vertexCount > 0 ? &modelVertices[0].pos : nullptr, vertexCount, sizeof(Vertex));
+		if (buildCollider && vertexCount > 0) {
+			newModel.collider = std::make_shared<collisionDetection::TriangleMesh>(&modelVertices[0].pos, sizeof(Vertex), &modelIndices[newModel.offset - indexOffset], newModel.size, vertexOffset);
+		}
+		return newModel;
 	}
 
+	void Graphics::addModel(const Vertex* modelVertices, uint32_t vertexCount, const uint32_t* modelIndices, uint32_t indexCount,
+		const meshCache::LodRange* lods, uint32_t lodCount, const meshletCulling::Meshlet* modelMeshlets, uint32_t meshletCount, const MaterialData* modelMaterials, uint32_t materialCount,
+		const std::string& textureName, const std::string& normalMapName, bool buildCollider) {
+		std::vector<uint16_t> materialIds;
+		{
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			materialIds = addMaterials(modelMaterials, materialCount);
+		}
 
-	void Graphics::createVertexBuffer() {
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		uint32_t vertexOffset = static_cast<uint32_t>(vertices.size());
+		uint32_t indexOffset = static_cast<uint32_t>(indices.size());
+		// every model shares one vertex buffer and is drawn with a vertex offset of 0, so its indices are made absolute here
+		vertices.insert(vertices.end(), modelVertices, modelVertices + vertexCount);
+		for (uint32_t i = vertexOffset; i < vertices.size(); i++) {
+			vertices[i].material = materialIds[vertices[i].material];
+		}
+		indices.reserve(indices.size() + indexCount);
+		for (uint32_t i = 0; i < indexCount; i++) {
+			indices.push_back(modelIndices[i] + vertexOffset);
+		}
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
+		if (meshletTable.size() + meshletCount > static_cast<size_t>(MAX_MESHLETS)) {
+			throw std::runtime_error("too many meshlets!");
+		}
+		uint32_t firstMeshlet = static_cast<uint32_t>(meshletTable.size());
+		for (uint32_t i = 0; i < meshletCount; i++) {
+			meshletTable.push_back(modelMeshlets[i]);
+			meshletTable.back().firstIndex += indexOffset;
+		}
+		models.push_back(createModel(vertices.data() + vertexOffset, vertexCount, indices.data() + indexOffset, vertexOffset, indexOffset,
+			lods, lodCount, indexCount, firstMeshlet, meshletCount, textureName, normalMapName, buildCollider));
+	}
 
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
 
-		copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+	int Graphics::streamModel(const ModelSource& source) {
+		// the slot draws nothing until the model arrives, its single empty lod keeps the draw building code as it is
+		Model placeholder = Model();
+		placeholder.lods.push_back({ 0, 0, 0.0f });
+		const Model* previous = models.data();
+		models.push_back(placeholder);
+		int modelIndex = static_cast<int>(models.size() - 1);
+		if (models.data() != previous) {
+			// instances point at their model, which has just moved
+			for (size_t i = 0; i < renderInstances.size(); i++) {
+				for (RenderInstance& instance : renderInstances[i]) {
+					instance.model = &models[i];
+				}
+			}
+		}
+		renderInstances.resize(models.size());
+		renderInstanceIndexes.resize(models.size(), 0);
+		modelInstanceOffsets.resize(models.size(), static_cast<uint32_t>(instanceTransforms.size()));
+		modelInstanceCapacities.resize(models.size(), 0);
+		modelSources.push_back(source);
+
+		StreamRequest request;
+		request.source = source;
+		request.modelIndex = modelIndex;
+		{
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			streamRequests.push_back(request);
+			pendingStreamCount++;
+		}
+		streamingCondition.notify_one();
+		return modelIndex;
+	}
 
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	void Graphics::streamTexture(const std::string& textureName) {
+		StreamRequest request;
+		request.textureName = textureName;
+		{
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			streamRequests.push_back(request);
+			pendingStreamCount++;
+		}
+		streamingCondition.notify_one();
 	}
 
-	void Graphics::createIndexBuffer() {
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+	uint32_t Graphics::getPendingStreamCount() {
+		std::lock_guard<std::mutex> lock(streamingMutex);
+		return pendingStreamCount;
+	}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	void Graphics::startStreaming() {
+		// everything loaded at start is in the buffers, streamed models go after it
+		vertexRanges.init(MAX_VERTICES, static_cast<uint32_t>(vertices.size()));
+		indexRanges.init(MAX_INDICES, static_cast<uint32_t>(indices.size()));
+		meshletRanges.init(static_cast<uint32_t>(MAX_MESHLETS), static_cast<uint32_t>(meshletTable.size()));
+		uploadedMaterialCount = static_cast<uint32_t>(materialTable.size());
+		frameRetirements.resize(MAX_FRAMES_IN_FLIGHT);
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+		streamingCommandPools.resize(STREAMING_THREAD_COUNT);
+		for (uint32_t i = 0; i < STREAMING_THREAD_COUNT; i++) {
+			if (vkCreateCommandPool(device, &poolInfo, nullptr, &streamingCommandPools[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create streaming command pool!");
+			}
+		}
+		for (uint32_t i = 0; i < STREAMING_THREAD_COUNT; i++) {
+			streamingThreads.emplace_back(&Graphics::streamingLoop, this, i);
+		}
 
-		copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-		
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		const char* watchedDirectories[] = { "resources/models", "resources/textures", "resources/shaders" };
+		for (const char* directory : watchedDirectories) {
+			if (!resourceWatcher.watch(directory)) {
+				std::cout << "can't watch " << directory << " for changes" << std::endl;
+			}
+		}
 	}
 
-	StorageBufferObject Graphics::createStorageBuffer(std::string name, VkDeviceSize size) {
-		StorageBufferObject storageBuffer;
-		storageBuffer.name = name;
-		storageBuffer.size = size;
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-		VkDeviceMemory bufferMemory;
-		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, storageBuffer.buffer, bufferMemory);
+	void Graphics::stopStreamingThreads() {
+		{
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			stopStreaming = true;
+			streamRequests.clear();
+		}
+		streamingCondition.notify_all();
+		for (std::thread& thread : streamingThreads) {
+			thread.join();
+		}
+		streamingThreads.clear();
+	}
 
-		copyBuffer(stagingBuffer, storageBuffer.buffer, size);
+	void Graphics::streamingLoop(uint32_t loaderIndex) {
+		while (true) {
+			StreamRequest request;
+			{
+				std::unique_lock<std::mutex> lock(streamingMutex);
+				streamingCondition.wait(lock, [this] { return stopStreaming || !streamRequests.empty(); });
+				if (stopStreaming) {
+					return;
+				}
+				request = std::move(streamRequests.front());
+				streamRequests.pop_front();
+			}
 
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+			try {
+				if (request.modelIndex >= 0) {
+					streamModelOnLoader(request, loaderIndex);
+				}
+				else {
+					streamTextureOnLoader(request);
+				}
+			}
+			catch (const std::exception& error) {
+				// the model slot stays empty or the atlas region keeps its old pixels, the frame goes on either way
+				std::lock_guard<std::mutex> lock(streamingMutex);
+				streamErrors.push_back((request.modelIndex >= 0 ? request.source.path : request.textureName) + ": " + error.what());
+				pendingStreamCount--;
+			}
+		}
+	}
 
-		return storageBuffer;
+	namespace {
+		// whether an obj names the material library in one of its mtllib lines
+		bool usesMaterialLibrary(const std::string& objPath, const std::string& library) {
+			std::ifstream file(objPath);
+			std::string line;
+			while (std::getline(file, line)) {
+				if (line.compare(0, 7, "mtllib ") != 0) {
+					continue;
+				}
+				std::string name = line.substr(7);
+				name.erase(name.find_last_not_of(" \t\r") + 1);
+				if (name == library) {
+					return true;
+				}
+			}
+			return false;
+		}
 	}
 
-	template<typename T>
-	void Graphics::updateStorageBuffer(StorageBufferObject storageBuffer, const std::vector<T>& data) {
-		VkDeviceSize bufferSize = sizeof(T) * data.size();
-		if (bufferSize > storageBuffer.size) {
-			throw std::runtime_error("Data size exceeds maximum buffer size");
+	void Graphics::streamModelOnLoader(const StreamRequest& request, uint32_t loaderIndex) {
+		if (!request.materialLibrary.empty() && !usesMaterialLibrary(request.source.path, request.materialLibrary)) {
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			pendingStreamCount--;
+			return;
 		}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-					stagingBuffer, stagingBufferMemory);
+		ImportedModel imported;
+		importModel(request.source, imported);
+		if (!imported.cacheWritten) {
+			std::cout << "couldn't write " << request.source.path << ".mesh" << std::endl;
+		}
 
-		void* mappedMemory;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &mappedMemory);
-		memcpy(mappedMemory, data.data(), bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
+		const Vertex* modelVertices = imported.vertices.data();
+		uint32_t vertexCount = static_cast<uint32_t>(imported.vertices.size());
+		const uint32_t* modelIndices = imported.indices.data();
+		uint32_t indexCount = static_cast<uint32_t>(imported.indices.size());
+		const meshCache::LodRange* lods = imported.lods.data();
+		uint32_t lodCount = static_cast<uint32_t>(imported.lods.size());
+		const meshletCulling::Meshlet* modelMeshlets = imported.meshlets.data();
+		uint32_t meshletCount = static_cast<uint32_t>(imported.meshlets.size());
+		const MaterialData* modelMaterials = imported.materials.data();
+		uint32_t materialCount = static_cast<uint32_t>(imported.materials.size());
+		if (imported.cooked) {
+			modelVertices = static_cast<const Vertex*>(imported.cooked->getVertices());
+			vertexCount = imported.cooked->getVertexCount();
+			modelIndices = imported.cooked->getIndices();
+			indexCount = imported.cooked->getIndexCount();
+			lods = imported.cooked->getLods();
+			lodCount = imported.cooked->getLodCount();
+			modelMeshlets = static_cast<const meshletCulling::Meshlet*>(imported.cooked->getMeshlets());
+			meshletCount = imported.cooked->getMeshletCount();
+			modelMaterials = static_cast<const MaterialData*>(imported.cooked->getMaterials());
+			materialCount = imported.cooked->getMaterialCount();
+		}
 
-		copyBuffer(stagingBuffer, storageBuffer.buffer, bufferSize);
+		StreamedModel streamed;
+		streamed.modelIndex = request.modelIndex;
+		streamed.reload = request.reload;
+		streamed.copied = VK_NULL_HANDLE;
+		uint32_t firstMeshlet;
+		std::vector<uint16_t> materialIds;
+		{
+			// each loader then copies into its own ranges without holding the lock, a reloaded model's old ones are
+			// only given back once no frame in flight can draw from them
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			if (!vertexRanges.allocate(vertexCount, streamed.vertexOffset)) {
+				throw std::runtime_error("no room left in the vertex buffer");
+			}
+			if (!indexRanges.allocate(indexCount, streamed.indexOffset)) {
+				vertexRanges.free(streamed.vertexOffset, vertexCount);
+				throw std::runtime_error("no room left in the index buffer");
+			}
+			if (!meshletRanges.allocate(meshletCount, firstMeshlet)) {
+				vertexRanges.free(streamed.vertexOffset, vertexCount);
+				indexRanges.free(streamed.indexOffset, indexCount);
+				throw std::runtime_error("too many meshlets!");
+			}
+			materialIds = addMaterials(modelMaterials, materialCount);
+		}
 
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
-	}
+		// the same fix ups addModel makes, into the model's own arrays
+		streamed.vertices.assign(modelVertices, modelVertices + vertexCount);
+		for (Vertex& vertex : streamed.vertices) {
+			vertex.material = materialIds[vertex.material];
+		}
+		streamed.indices.resize(indexCount);
+		for (uint32_t i = 0; i < indexCount; i++) {
+			streamed.indices[i] = modelIndices[i] + streamed.vertexOffset;
+		}
+		streamed.meshlets.assign(modelMeshlets, modelMeshlets + meshletCount);
+		for (meshletCulling::Meshlet& meshlet : streamed.meshlets) {
+			meshlet.firstIndex += streamed.indexOffset;
+		}
+		streamed.model = createModel(streamed.vertices.data(), vertexCount, streamed.indices.data(), streamed.vertexOffset, streamed.indexOffset,
+			lods, lodCount, indexCount, firstMeshlet, meshletCount, imported.textureName, imported.normalMapName, request.source.buildCollider);
+		imported = ImportedModel();
+
+		VkDeviceSize vertexBytes = sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCount);
+		VkDeviceSize indexBytes = sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCount);
+		VkDeviceSize meshletBytes = sizeof(meshletCulling::Meshlet) * static_cast<VkDeviceSize>(meshletCount);
+		VkDeviceSize stagingSize = vertexBytes + indexBytes + meshletBytes;
+		if (stagingSize > 0) {
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingBufferMemory;
+			createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+			void* data;
+			vkMapMemory(device, stagingBufferMemory, 0, stagingSize, 0, &data);
+			char* staging = static_cast<char*>(data);
+			memcpy(staging, streamed.vertices.data(), static_cast<size_t>(vertexBytes));
+			memcpy(staging + vertexBytes, streamed.indices.data(), static_cast<size_t>(indexBytes));
+			memcpy(staging + vertexBytes + indexBytes, streamed.meshlets.data(), static_cast<size_t>(meshletBytes));
+			vkUnmapMemory(device, stagingBufferMemory);
+
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = streamingCommandPools[loaderIndex];
+			allocInfo.commandBufferCount = 1;
+			VkCommandBuffer commandBuffer;
+			vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
 
-	void Graphics::createUniformBuffers() {
-		VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(commandBuffer, &beginInfo);
+			VkBufferCopy copies[3] = {};
+			copies[0] = { 0, sizeof(Vertex) * static_cast<VkDeviceSize>(streamed.vertexOffset), vertexBytes };
+			copies[1] = { vertexBytes, sizeof(uint32_t) * static_cast<VkDeviceSize>(streamed.indexOffset), indexBytes };
+			copies[2] = { vertexBytes + indexBytes, sizeof(meshletCulling::Meshlet) * static_cast<VkDeviceSize>(firstMeshlet), meshletBytes };
+			VkBuffer destinations[3] = { vertexBuffer, indexBuffer, meshletBuffer.buffer };
+			for (int i = 0; i < 3; i++) {
+				if (copies[i].size > 0) {
+					vkCmdCopyBuffer(commandBuffer, stagingBuffer, destinations[i], 1, &copies[i]);
+				}
+			}
+			vkEndCommandBuffer(commandBuffer);
+
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			VkFence fence;
+			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &streamed.copied) != VK_SUCCESS || vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create streaming sync objects!");
+			}
 
-		uniformBuffers.resize(swapChainImages.size());
-		uniformBuffersMemory.resize(swapChainImages.size());
+			// the semaphore makes the copies visible to the graphics queue, the fence tells this thread the staging memory is free
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &streamed.copied;
+			VkResult result;
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				result = vkQueueSubmit(transferQueue, 1, &submitInfo, fence);
+			}
+			if (result != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit streaming copy!");
+			}
+			vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
 
-		for (size_t i = 0; i < swapChainImages.size(); i++) {
-			createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+			vkDestroyFence(device, fence, nullptr);
+			vkFreeCommandBuffers(device, streamingCommandPools[loaderIndex], 1, &commandBuffer);
+			vkDestroyBuffer(device, stagingBuffer, nullptr);
+			vkFreeMemory(device, stagingBufferMemory, nullptr);
 		}
+
+		std::lock_guard<std::mutex> lock(streamingMutex);
+		streamedModels.push_back(std::move(streamed));
 	}
 
-	void Graphics::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-		VkBufferCreateInfo bufferInfo = {};
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = size;
-		bufferInfo.usage = usage;
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	namespace {
+		// bilinear, for a texture file that isn't the size of its atlas region
+		std::vector<unsigned char> resizePixels(const unsigned char* pixels, int width, int height, int newWidth, int newHeight) {
+			std::vector<unsigned char> resized(static_cast<size_t>(newWidth) * newHeight * 4);
+			for (int y = 0; y < newHeight; y++) {
+				float sourceY = std::min(std::max((y + 0.5f) * height / newHeight - 0.5f, 0.0f), static_cast<float>(height - 1));
+				int y0 = static_cast<int>(sourceY);
+				int y1 = std::min(y0 + 1, height - 1);
+				float fy = sourceY - y0;
+				for (int x = 0; x < newWidth; x++) {
+					float sourceX = std::min(std::max((x + 0.5f) * width / newWidth - 0.5f, 0.0f), static_cast<float>(width - 1));
+					int x0 = static_cast<int>(sourceX);
+					int x1 = std::min(x0 + 1, width - 1);
+					float fx = sourceX - x0;
+					for (int c = 0; c < 4; c++) {
+						float top = pixels[(y0 * width + x0) * 4 + c] * (1.0f - fx) + pixels[(y0 * width + x1) * 4 + c] * fx;
+						float bottom = pixels[(y1 * width + x0) * 4 + c] * (1.0f - fx) + pixels[(y1 * width + x1) * 4 + c] * fx;
+						resized[(static_cast<size_t>(y) * newWidth + x) * 4 + c] = static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+					}
+				}
+			}
+			return resized;
+		}
 
-		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create buffer!");
+		// the next mip level, each texel the average of the up to four under it
+		std::vector<unsigned char> halvePixels(const std::vector<unsigned char>& pixels, int width, int height, int newWidth, int newHeight) {
+			std::vector<unsigned char> halved(static_cast<size_t>(newWidth) * newHeight * 4);
+			for (int y = 0; y < newHeight; y++) {
+				int y0 = std::min(y * 2, height - 1);
+				int y1 = std::min(y * 2 + 1, height - 1);
+				for (int x = 0; x < newWidth; x++) {
+					int x0 = std::min(x * 2, width - 1);
+					int x1 = std::min(x * 2 + 1, width - 1);
+					for (int c = 0; c < 4; c++) {
+						int sum = pixels[(y0 * width + x0) * 4 + c] + pixels[(y0 * width + x1) * 4 + c] + pixels[(y1 * width + x0) * 4 + c] + pixels[(y1 * width + x1) * 4 + c];
+						halved[(static_cast<size_t>(y) * newWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+					}
+				}
+			}
+			return halved;
 		}
+	}
 
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+	void Graphics::streamTextureOnLoader(const StreamRequest& request) {
+		const ImageInfo* region = nullptr;
+		for (const ImageInfo& info : atlasOffsets) {
+			if (info.name == request.textureName) {
+				region = &info;
+			}
+		}
+		if (region == nullptr) {
+			throw std::runtime_error("texture isn't in the atlas");
+		}
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		int texWidth, texHeight, texChannels;
+		stbi_uc* pixels = stbi_load(region->path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (!pixels) {
+			throw std::runtime_error("failed to load texture image!");
+		}
+		int regionX = static_cast<int>(region->coordinates.x);
+		int regionY = static_cast<int>(region->coordinates.y);
+		int width = static_cast<int>(region->dimensions.x);
+		int height = static_cast<int>(region->dimensions.y);
+		std::vector<unsigned char> level;
+		if (texWidth == width && texHeight == height) {
+			level.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		}
+		else {
+			level = resizePixels(pixels, texWidth, texHeight, width, height);
+		}
+		stbi_image_free(pixels);
 
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate buffer memory!");
+		// every mip level the region still covers a texel of, made on the cpu since the atlas can't be blitted away from the graphics queue
+		std::vector<unsigned char> staging;
+		StreamedTexture streamed;
+		streamed.name = request.textureName;
+		for (uint32_t mip = 0; mip < mipLevels && width > 0 && height > 0; mip++) {
+			int mipWidth = std::max(textureWidth >> mip, 1);
+			int mipHeight = std::max(textureHeight >> mip, 1);
+			int x = regionX >> mip;
+			int y = regionY >> mip;
+			if (x >= mipWidth || y >= mipHeight) {
+				break;
+			}
+			VkBufferImageCopy copy = {};
+			copy.bufferOffset = staging.size();
+			copy.bufferRowLength = static_cast<uint32_t>(width);
+			copy.bufferImageHeight = static_cast<uint32_t>(height);
+			copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copy.imageSubresource.mipLevel = mip;
+			copy.imageSubresource.baseArrayLayer = 0;
+			copy.imageSubresource.layerCount = 1;
+			copy.imageOffset = { x, y, 0 };
+			copy.imageExtent = { static_cast<uint32_t>(std::min(width, mipWidth - x)), static_cast<uint32_t>(std::min(height, mipHeight - y)), 1 };
+			streamed.regions.push_back(copy);
+			staging.insert(staging.end(), level.begin(), level.end());
+
+			int nextWidth = width >> 1;
+			int nextHeight = height >> 1;
+			if (nextWidth > 0 && nextHeight > 0) {
+				level = halvePixels(level, width, height, nextWidth, nextHeight);
+			}
+			width = nextWidth;
+			height = nextHeight;
 		}
 
-		vkBindBufferMemory(device, buffer, bufferMemory, 0);
+		VkDeviceSize stagingSize = staging.size();
+		createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, streamed.stagingBuffer, streamed.stagingBufferMemory);
+		void* data;
+		vkMapMemory(device, streamed.stagingBufferMemory, 0, stagingSize, 0, &data);
+		memcpy(data, staging.data(), staging.size());
+		vkUnmapMemory(device, streamed.stagingBufferMemory);
+
+		std::lock_guard<std::mutex> lock(streamingMutex);
+		streamedTextures.push_back(std::move(streamed));
 	}
 
-	VkCommandBuffer Graphics::beginSingleTimeCommands() {
-		VkCommandBufferAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = commandPool;
-		allocInfo.commandBufferCount = 1;
+	void Graphics::commitStreamedAssets() {
+		std::vector<StreamedModel> arrived;
+		{
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			for (const std::string& error : streamErrors) {
+				std::cout << "couldn't stream " << error << std::endl;
+			}
+			streamErrors.clear();
+			if (streamedModels.empty() && streamedTextures.empty()) {
+				return;
+			}
+			pendingStreamCount -= static_cast<uint32_t>(streamedModels.size() + streamedTextures.size());
+			arrived.swap(streamedModels);
+			for (StreamedTexture& texture : streamedTextures) {
+				textureCopies.push_back(std::move(texture));
+			}
+			streamedTextures.clear();
 
-		VkCommandBuffer commandBuffer;
-		vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+			// materials loaders added go up with this frame's uploads, before any draw that can use them
+			uint32_t materialCount = static_cast<uint32_t>(materialTable.size());
+			stageUpload(materialBuffer, materialTable.data() + uploadedMaterialCount, sizeof(MaterialData) * (materialCount - uploadedMaterialCount),
+				sizeof(MaterialData) * uploadedMaterialCount);
+			uploadedMaterialCount = materialCount;
+		}
+
+		for (StreamedModel& streamed : arrived) {
+			// the cpu copies are what colliders and cpu culling read
+			uint32_t vertexEnd = streamed.vertexOffset + static_cast<uint32_t>(streamed.vertices.size());
+			uint32_t indexEnd = streamed.indexOffset + static_cast<uint32_t>(streamed.indices.size());
+			uint32_t meshletEnd = streamed.model.firstMeshlet + streamed.model.meshletCount;
+			vertices.resize(std::max(static_cast<uint32_t>(vertices.size()), vertexEnd));
+			indices.resize(std::max(static_cast<uint32_t>(indices.size()), indexEnd));
+			meshletTable.resize(std::max(static_cast<uint32_t>(meshletTable.size()), meshletEnd));
+			std::copy(streamed.vertices.begin(), streamed.vertices.end(), vertices.begin() + streamed.vertexOffset);
+			std::copy(streamed.indices.begin(), streamed.indices.end(), indices.begin() + streamed.indexOffset);
+			std::copy(streamed.meshlets.begin(), streamed.meshlets.end(), meshletTable.begin() + streamed.model.firstMeshlet);
+
+			if (streamed.reload) {
+				// the retired copy keeps the old collider alive until this frame comes round again,
+				// by then whoever placed it has looked up the new one with getModelCollider,
+				// a reload with no triangles has no collider to swap in, so the old one stays
+				if (!streamed.model.collider) {
+					streamed.model.collider = models[streamed.modelIndex].collider;
+				}
+				frameRetirements[currentFrame].replacedModels.push_back(models[streamed.modelIndex]);
+			}
+			models[streamed.modelIndex] = std::move(streamed.model);
+			if (streamed.copied != VK_NULL_HANDLE) {
+				streamWaitSemaphores.push_back(streamed.copied);
+			}
+			commandBuffersDirty = true;
+		}
+	}
+
+	void Graphics::destroyFrameRetirements(FrameRetirements& retirements) {
+		for (VkSemaphore semaphore : retirements.semaphores) {
+			vkDestroySemaphore(device, semaphore, nullptr);
+		}
+		for (auto& buffer : retirements.buffers) {
+			vkDestroyBuffer(device, buffer.first, nullptr);
+			vkFreeMemory(device, buffer.second, nullptr);
+		}
+		if (!retirements.replacedModels.empty()) {
+			std::lock_guard<std::mutex> lock(streamingMutex);
+			for (const Model& model : retirements.replacedModels) {
+				vertexRanges.free(model.vertexOffset, model.vertexCount);
+				indexRanges.free(model.offset, model.indexCount);
+				meshletRanges.free(model.firstMeshlet, model.meshletCount);
+			}
+		}
+		retirements.semaphores.clear();
+		retirements.buffers.clear();
+		retirements.replacedModels.clear();
+	}
+
+	void Graphics::pollResourceChanges() {
+		bool graphicsShaders = false;
+		bool cullShader = false;
+		for (const std::string& path : resourceWatcher.poll()) {
+			size_t slash = path.find_last_of('/');
+			std::string directory = path.substr(0, slash);
+			std::string name = path.substr(slash + 1);
+			std::string extension = name.substr(std::min(name.find_last_of('.'), name.size()));
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+			if (path == VERTEX_SHADER_PATH || path == INDIRECT_VERTEX_SHADER_PATH || path == FRAGMENT_SHADER_PATH) {
+				graphicsShaders = true;
+			}
+			else if (path == CULL_SHADER_PATH) {
+				cullShader = true;
+			}
+			else if (extension == ".obj" || extension == ".mtl") {
+				// the cooked copy is checked against the obj and its libraries, so a reload re-imports it only if one of them really changed
+				for (size_t i = 0; i < modelSources.size(); i++) {
+					const std::string& source = modelSources[i].path;
+					bool sameDirectory = source.compare(0, directory.size() + 1, directory + "/") == 0;
+					if ((extension == ".obj" && source == path) || (extension == ".mtl" && sameDirectory)) {
+						StreamRequest request;
+						request.source = modelSources[i];
+						request.modelIndex = static_cast<int>(i);
+						request.reload = true;
+						if (extension == ".mtl") {
+							request.materialLibrary = name;
+						}
+						std::lock_guard<std::mutex> lock(streamingMutex);
+						streamRequests.push_back(request);
+						pendingStreamCount++;
+						streamingCondition.notify_one();
+					}
+				}
+			}
+			else {
+				for (const ImageInfo& info : atlasOffsets) {
+					if (info.path == path) {
+						streamTexture(info.name);
+					}
+				}
+			}
+		}
+		if (graphicsShaders || cullShader) {
+			reloadShaders(graphicsShaders, cullShader);
+		}
+	}
+
+	void Graphics::reloadShaders(bool graphics, bool cull) {
+		// no frame in flight may still be using a pipeline that gets destroyed
+		vkWaitForFences(device, MAX_FRAMES_IN_FLIGHT, inFlightFences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+		try {
+			if (graphics) {
+				PipelineBundle& bundle = pipelineBundles[0];
+				VkPipelineLayout pipelineLayout;
+				VkPipeline pipeline = createGraphicsPipeline(indirectDrawEnabled ? INDIRECT_VERTEX_SHADER_PATH : VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH,
+					bundle.descriptorSetLayout, swapChainExtent, renderPass, pipelineLayout, pushConstantInfos);
+				vkDestroyPipeline(device, bundle.pipeline, nullptr);
+				vkDestroyPipelineLayout(device, bundle.pipelineLayout, nullptr);
+				bundle.pipeline = pipeline;
+				bundle.pipelineLayout = pipelineLayout;
+				std::cout << "reloaded draw shaders" << std::endl;
+			}
+			if (cull && gpuCullingEnabled) {
+				PipelineBundle& bundle = cullPipelineBundles[0];
+				VkPipelineLayout pipelineLayout;
+				VkPipeline pipeline = createComputePipeline(CULL_SHADER_PATH, bundle.descriptorSetLayout, pipelineLayout, cullPushConstantInfos);
+				vkDestroyPipeline(device, bundle.pipeline, nullptr);
+				vkDestroyPipelineLayout(device, bundle.pipelineLayout, nullptr);
+				bundle.pipeline = pipeline;
+				bundle.pipelineLayout = pipelineLayout;
+				std::cout << "reloaded cull shader" << std::endl;
+			}
+		}
+		catch (const std::runtime_error& error) {
+			std::cout << "keeping the old shaders, " << error.what() << std::endl;
+		}
+		// the draws are recorded with the pipelines bound
+		commandBuffersDirty = true;
+	}
+
+
+	void Graphics::createVertexBuffer() {
+		if (vertices.size() > MAX_VERTICES) {
+			throw std::runtime_error("too many vertices to fit in the vertex buffer!");
+		}
+		// sized for streamed models too, only what was loaded at start is copied now
+		VkDeviceSize capacity = sizeof(vertices[0]) * MAX_VERTICES;
+		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+		createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory, true);
+		if (bufferSize == 0) {
+			return;
+		}
+
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+		void* data;
+		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+		memcpy(data, vertices.data(), (size_t)bufferSize);
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	}
+
+	void Graphics::createIndexBuffer() {
+		if (indices.size() > MAX_INDICES) {
+			throw std::runtime_error("too many indices to fit in the index buffer!");
+		}
+		// sized for streamed models too, only what was loaded at start is copied now
+		VkDeviceSize capacity = sizeof(indices[0]) * MAX_INDICES;
+		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+		createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory, true);
+		if (bufferSize == 0) {
+			return;
+		}
+
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+		void* data;
+		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+		memcpy(data, indices.data(), (size_t)bufferSize);
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+		
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	}
+
+	StorageBufferObject Graphics::createStorageBuffer(std::string name, VkDeviceSize size, VkBufferUsageFlags extraUsage, const void* data, VkDeviceSize dataSize, bool shared) {
+		StorageBufferObject storageBuffer;
+		storageBuffer.name = name;
+		storageBuffer.size = size;
+
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+		if (data && dataSize > 0) {
+			void* mapped;
+			vkMapMemory(device, stagingBufferMemory, 0, dataSize, 0, &mapped);
+			memcpy(mapped, data, (size_t)dataSize);
+			vkUnmapMemory(device, stagingBufferMemory);
+		}
+
+		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | extraUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, storageBuffer.buffer, storageBuffer.memory, shared);
+
+		copyBuffer(stagingBuffer, storageBuffer.buffer, size);
+
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+		return storageBuffer;
+	}
+
+	void Graphics::createUploadRing(VkDeviceSize regionSize) {
+		uploadRing.regionSize = regionSize;
+		VkDeviceSize totalSize = regionSize * MAX_FRAMES_IN_FLIGHT;
+
+		createBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uploadRing.buffer, uploadRing.memory);
+
+		// mapped once for the lifetime of the buffer, coherent memory means no flushes are needed before submitting
+		void* data;
+		if (vkMapMemory(device, uploadRing.memory, 0, totalSize, 0, &data) != VK_SUCCESS) {
+			throw std::runtime_error("failed to map upload ring!");
+		}
+		uploadRing.mapped = static_cast<char*>(data);
+	}
+
+	void Graphics::destroyUploadRing() {
+		vkUnmapMemory(device, uploadRing.memory);
+		vkDestroyBuffer(device, uploadRing.buffer, nullptr);
+		vkFreeMemory(device, uploadRing.memory, nullptr);
+		uploadRing = UploadRing();
+	}
+
+	void Graphics::createUploadCommandBuffers() {
+		uploadCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = (uint32_t)uploadCommandBuffers.size();
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, uploadCommandBuffers.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate upload command buffers!");
+		}
+	}
+
+	// must only be called once the fence for frameIndex has been waited on, the gpu is then done reading that region
+	void Graphics::beginUploadFrame(size_t frameIndex) {
+		uploadRing.regionOffset = uploadRing.regionSize * frameIndex;
+		uploadRing.head = 0;
+		pendingUploads.clear();
+	}
+
+	void Graphics::stageUpload(const StorageBufferObject& storageBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+		if (size == 0) {
+			return;
+		}
+		if (dstOffset + size > storageBuffer.size) {
+			throw std::runtime_error("Data size exceeds maximum buffer size");
+		}
+
+		VkDeviceSize offset = (uploadRing.head + 15) & ~VkDeviceSize(15);
+		if (offset + size > uploadRing.regionSize) {
+			throw std::runtime_error("upload ring region overflow for " + storageBuffer.name);
+		}
+
+		memcpy(uploadRing.mapped + uploadRing.regionOffset + offset, data, static_cast<size_t>(size));
+		uploadRing.head = offset + size;
+
+		PendingUpload upload;
+		upload.dstBuffer = storageBuffer.buffer;
+		upload.region.srcOffset = uploadRing.regionOffset + offset;
+		upload.region.dstOffset = dstOffset;
+		upload.region.size = size;
+		pendingUploads.push_back(upload);
+	}
+
+	VkDeviceSize Graphics::stageDirtyRanges(const StorageBufferObject& storageBuffer, DirtyRanges& dirtyRanges, const void* data, VkDeviceSize elementSize, size_t elementCount) {
+		dirtyRanges.merge();
+
+		VkDeviceSize stagedBytes = 0;
+		for (const auto& range : dirtyRanges.ranges) {
+			uint32_t end = std::min(range.second, static_cast<uint32_t>(elementCount));
+			if (range.first >= end) {
+				continue;
+			}
+			VkDeviceSize size = elementSize * (end - range.first);
+			stageUpload(storageBuffer, static_cast<const char*>(data) + elementSize * range.first, size, elementSize * range.first);
+			stagedBytes += size;
+		}
+		dirtyRanges.clear();
+
+		return stagedBytes;
+	}
+
+	// builds the indirect commands and draw data of each model draw, only needed when the draw layout changes, a model's full
+	// triangles get one command per meshlet, or a single one when the meshlets don't fit, then each coarser lod gets one,
+	// every command has room behind its firstInstance for all of the draw's instances, culling decides which ones each draws,
+	// the push constant path keeps them on the cpu and records them itself
+	void Graphics::stageIndirectDraws(const std::vector<ModelDraw>& draws) {
+		// meshlets are only used where they fit after every draw has its single commands
+		size_t commandCount = 0;
+		uint64_t slotCount = 0;
+		for (const ModelDraw& draw : draws) {
+			commandCount += models[draw.modelIndex].lods.size();
+			slotCount += static_cast<uint64_t>(models[draw.modelIndex].lods.size()) * draw.instanceCount;
+		}
+		if (commandCount > static_cast<size_t>(MAX_INDIRECT_DRAWS)) {
+			throw std::runtime_error("too many draws for the indirect buffer");
+		}
+		if (slotCount > static_cast<uint64_t>(MAX_VISIBLE_SLOTS)) {
+			throw std::runtime_error("too many instance lods for the visible instance buffer");
+		}
+		std::vector<uint32_t> meshletCounts(draws.size(), 0);
+		for (size_t i = 0; i < draws.size(); i++) {
+			uint32_t meshletCount = models[draws[i].modelIndex].meshletCount;
+			if (meshletCount == 0) {
+				continue;
+			}
+			uint64_t extraSlots = static_cast<uint64_t>(meshletCount - 1) * draws[i].instanceCount;
+			if (commandCount + meshletCount - 1 <= static_cast<size_t>(MAX_INDIRECT_DRAWS) && slotCount + extraSlots <= static_cast<uint64_t>(MAX_VISIBLE_SLOTS)) {
+				meshletCounts[i] = meshletCount;
+				commandCount += meshletCount - 1;
+				slotCount += extraSlots;
+			}
+		}
+
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		std::vector<DrawData> drawData;
+		std::vector<uint32_t> firstCommands;
+		commands.reserve(commandCount);
+		drawData.reserve(commandCount);
+		firstCommands.reserve(draws.size());
+		uint32_t visibleSlots = 0;
+
+		for (size_t i = 0; i < draws.size(); i++) {
+			const ModelDraw& draw = draws[i];
+			const Model& model = models[draw.modelIndex];
+			uint32_t firstCommand = static_cast<uint32_t>(commands.size());
+			firstCommands.push_back(firstCommand);
+
+			DrawData data = {};
+			data.textureOffsetSize = glm::vec4(model.textureOffset, model.textureSize) / 4096.0f;
+			data.normalTextureOffsetSize = glm::vec4(model.normalTextureOffset, model.normalTextureSize) / 4096.0f;
+			data.boundingSphere = model.bounds.sphere;
+			data.hasNormalMap = model.hasNormalMap;
+			data.firstInstance = draw.firstInstance;
+			data.instanceCount = draw.instanceCount;
+			data.firstCommand = firstCommand;
+			data.meshletCount = meshletCounts[i];
+			data.lodCount = static_cast<uint32_t>(model.lods.size());
+
+			// firstInstance offsets gl_InstanceIndex, so the shader indexes the visible instances with it directly
+			auto addCommand = [&](uint32_t firstIndex, uint32_t indexCount, uint32_t meshlet, float lodError) {
+				VkDrawIndexedIndirectCommand command = {};
+				command.indexCount = indexCount;
+				command.instanceCount = draw.instanceCount;
+				command.firstIndex = firstIndex;
+				command.vertexOffset = 0;
+				command.firstInstance = visibleSlots;
+				commands.push_back(command);
+				visibleSlots += draw.instanceCount;
+
+				data.meshlet = meshlet;
+				data.lodError = lodError;
+				drawData.push_back(data);
+			};
+
+			if (meshletCounts[i] > 0) {
+				for (uint32_t m = 0; m < meshletCounts[i]; m++) {
+					const meshletCulling::Meshlet& meshlet = meshletTable[model.firstMeshlet + m];
+					addCommand(meshlet.firstIndex, meshlet.indexCount, model.firstMeshlet + m, 0.0f);
+				}
+			}
+			else {
+				addCommand(model.lods[0].offset, model.lods[0].size, 0, model.lods[0].error);
+			}
+			for (uint32_t lod = 1; lod < model.lods.size(); lod++) {
+				addCommand(model.lods[lod].offset, model.lods[lod].size, 0, model.lods[lod].error);
+			}
+		}
+
+		if (gpuCullingEnabled) {
+			// the cull pass starts every frame from these and counts the visible instances back in
+			for (auto& command : commands) {
+				command.instanceCount = 0;
+			}
+			stageUpload(indirectTemplateBuffer, commands.data(), sizeof(VkDrawIndexedIndirectCommand) * commands.size());
+		}
+		// without the cull shader cullInstancesOnCpu uploads the commands every frame with the visible counts filled in
+		if (indirectDrawEnabled) {
+			stageUpload(drawDataBuffer, drawData.data(), sizeof(DrawData) * drawData.size());
+		}
+		indirectDraws = draws;
+		indirectFirstCommands = firstCommands;
+		indirectMeshletCounts = meshletCounts;
+		indirectCommands = commands;
+		indirectDrawCount = static_cast<uint32_t>(commands.size());
+		visibleInstanceSlots = visibleSlots;
+	}
+
+	// culls every draw's instances against the camera on the cpu and sorts the visible ones into the lod commands by their
+	// distance, the ones drawn in full are culled again per meshlet, then uploads the visible transform indices behind each
+	// command's firstInstance and the commands with the visible counts, the push constant path records them from here instead
+	void Graphics::cullInstancesOnCpu() {
+		visibleInstances.resize(visibleInstanceSlots);
+		cullStats = frustumCulling::CullStats();
+		meshletCullStats = meshletCulling::CullStats();
+
+		for (size_t i = 0; i < indirectDraws.size(); i++) {
+			const ModelDraw& draw = indirectDraws[i];
+			const Model& model = models[draw.modelIndex];
+			uint32_t firstCommand = indirectFirstCommands[i];
+			uint32_t meshletCount = indirectMeshletCounts[i];
+			uint32_t lodCount = static_cast<uint32_t>(model.lods.size());
+			// the full model's commands, then one per coarser lod
+			uint32_t fullCommands = std::max(meshletCount, 1u);
+			uint32_t commandCount = fullCommands + lodCount - 1;
+
+			// culled into the first command's slots, the rest are moved out from there, never ahead of where they're read from
+			uint32_t* culled = &visibleInstances[indirectCommands[firstCommand].firstInstance];
+			uint32_t visibleCount = frustumCulling::cullInstances(frustum, model.bounds,
+				&instanceTransforms[draw.firstInstance], draw.instanceCount, draw.firstInstance, culled);
+
+			for (uint32_t c = 0; c < commandCount; c++) {
+				indirectCommands[firstCommand + c].instanceCount = 0;
+			}
+			float lodErrors[GENERATED_LODS + 1];
+			for (uint32_t lod = 0; lod < lodCount; lod++) {
+				lodErrors[lod] = model.lods[lod].error;
+			}
+			visibleMeshlets.resize(meshletCount);
+			for (uint32_t v = 0; v < visibleCount; v++) {
+				uint32_t instance = culled[v];
+				const glm::mat4& transform = instanceTransforms[instance];
+				uint32_t lod = 0;
+				if (lodCount > 1) {
+					glm::vec3 centre = glm::vec3(transform * glm::vec4(glm::vec3(model.bounds.sphere), 1.0f));
+					float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+					if (scale > 0.0f) {
+						// from the near side of the bounding sphere, in model space so the lod errors apply as they are
+						float distance = glm::max(glm::length(centre - eyePosition) / scale - model.bounds.sphere.w, 0.0f);
+						lod = meshSimplifier::selectLod(lodErrors, lodCount, distance, lodScale);
+					}
+				}
+
+				if (lod == 0 && meshletCount > 0) {
+					uint32_t meshletVisible = meshletCulling::cullMeshlets(frustum, eyePosition, transform, &meshletTable[model.firstMeshlet], meshletCount,
+						visibleMeshlets.data(), &meshletCullStats);
+					for (uint32_t m = 0; m < meshletVisible; m++) {
+						VkDrawIndexedIndirectCommand& command = indirectCommands[firstCommand + visibleMeshlets[m]];
+						visibleInstances[command.firstInstance + command.instanceCount++] = instance;
+					}
+				}
+				else {
+					VkDrawIndexedIndirectCommand& command = indirectCommands[firstCommand + (lod == 0 ? 0 : fullCommands + lod - 1)];
+					visibleInstances[command.firstInstance + command.instanceCount++] = instance;
+				}
+			}
+
+			for (uint32_t c = 0; c < commandCount && indirectDrawEnabled; c++) {
+				const VkDrawIndexedIndirectCommand& command = indirectCommands[firstCommand + c];
+				stageUpload(visibleInstanceBuffer, &visibleInstances[command.firstInstance], sizeof(uint32_t) * command.instanceCount, sizeof(uint32_t) * command.firstInstance);
+			}
+
+			cullStats.tested += draw.instanceCount;
+			cullStats.drawn += visibleCount;
+		}
+		cullStats.culled = cullStats.tested - cullStats.drawn;
+
+		if (indirectDrawEnabled) {
+			stageUpload(indirectBuffer, indirectCommands.data(), sizeof(VkDrawIndexedIndirectCommand) * indirectCommands.size());
+		}
+	}
+
+	void Graphics::recordUploadCommands(VkCommandBuffer commandBuffer) {
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording upload command buffer!");
+		}
+
+		if (!pendingUploads.empty()) {
+			// the previous frame may still be reading the storage and indirect buffers, wait for those stages before overwriting them
+			VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer,
+				readStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				1, &barrier,
+				0, nullptr,
+				0, nullptr);
+
+			for (const PendingUpload& upload : pendingUploads) {
+				vkCmdCopyBuffer(commandBuffer, uploadRing.buffer, upload.dstBuffer, 1, &upload.region);
+			}
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0,
+				1, &barrier,
+				0, nullptr,
+				0, nullptr);
+		}
+
+		// streamed textures go into the atlas here rather than on the transfer queue, earlier frames may still be sampling it
+		for (const StreamedTexture& texture : textureCopies) {
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = textureImage;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = mipLevels;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier);
+
+			vkCmdCopyBufferToImage(commandBuffer, texture.stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				static_cast<uint32_t>(texture.regions.size()), texture.regions.data());
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier);
+		}
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record upload command buffer!");
+		}
+	}
+
+	void Graphics::createUniformBuffers() {
+		VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+
+		uniformBuffers.resize(swapChainImages.size());
+		uniformBuffersMemory.resize(swapChainImages.size());
+
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+		}
+	}
+
+	void Graphics::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory, bool shared) {
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (shared && !sharedQueueFamilies.empty()) {
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(sharedQueueFamilies.size());
+			bufferInfo.pQueueFamilyIndices = sharedQueueFamilies.data();
+		}
+
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create buffer!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate buffer memory!");
+		}
+
+		vkBindBufferMemory(device, buffer, bufferMemory, 0);
+	}
+
+	VkCommandBuffer Graphics::beginSingleTimeCommands() {
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
 
 		VkCommandBufferBeginInfo beginInfo = {};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1190,8 +2424,11 @@
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
-		vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue);
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+			vkQueueWaitIdle(graphicsQueue);
+		}
 
 		vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 	}
@@ -1224,7 +2461,7 @@
 
 		VkCommandBufferAllocateInfo allocInfo = {};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = commandPool;
+		allocInfo.commandPool = drawCommandPool;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 		allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
 
@@ -1232,82 +2469,278 @@
 			throw std::runtime_error("failed to allocate command buffers!");
 		}
 
-		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			VkCommandBufferBeginInfo beginInfo = {};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-
-			if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-				throw std::runtime_error("failed to begin recording command buffer!");
-			}
-
-			VkRenderPassBeginInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = renderPass;
-			renderPassInfo.framebuffer = swapChainFramebuffers[i];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = swapChainExtent;
-
-			std::array<VkClearValue, 2> clearValues = {};
-			clearValues[0].color = { 0.0f, 0.0f,0.0f, 1.0f };
-			clearValues[1].depthStencil = { 1.0f, 0 };
-
-			renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-			renderPassInfo.pClearValues = clearValues.data();
-
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineBundles[0].pipeline);
-
-			VkBuffer vertexBuffers[] = { vertexBuffer };
-			VkDeviceSize offsets[] = { 0 };
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-
-			vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-			// TODO:
-			//
-			// loop through each group of instances, setting a push constant for the starting index in the storage buffer, and doing an instances draw
-			// also update the descriptor set with the correct texture
-			// what happens if there is no texture or it's a 2D image draw:
-			// lets not support no texture for now
-			// we need a new pipeline for only 2D stuff.
-			int startingIndex = 0;
-			
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineBundles[0].pipelineLayout, 0, 1, &(pipelineBundles[0].descriptorSets)[i], 0, nullptr); //HERE123
-
-			for (int j = 0; j < renderInstances.size(); j++) {
-				if (renderInstanceIndexes[j] > 0) {
-					//updatePipelineBundleResources(pipelineBundles[0], uniformBuffers, storageBuffer, textureImageView, textureSampler);
-					//updateDescriptorSet(pipelineBundles[0], i);
-					//vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineBundles[0].pipelineLayout, 0, 1, &(pipelineBundles[0].descriptorSets)[i], 0, nullptr); //HERE123
-					//updatePipelineBundleResources(pipelineBundles[0], uniformBuffers, storageBuffer, renderInstances[j][0].model->textureImageView, textureSampler);
-					
-					PushConstants pushConstants = {
-						startingIndex,
-						static_cast<float>(renderInstances[j][0].model->textureOffset.x) / 4096.0f,
-						static_cast<float>(renderInstances[j][0].model->textureOffset.y) / 4096.0f,
-						static_cast<float>(renderInstances[j][0].model->textureSize.x) / 4096.0f,
-						static_cast<float>(renderInstances[j][0].model->textureSize.y) / 4096.0f,
-						renderInstances[j][0].model->hasNormalMap,
-						static_cast<float>(renderInstances[j][0].model->normalTextureOffset.x) / 4096.0f,
-						static_cast<float>(renderInstances[j][0].model->normalTextureOffset.y) / 4096.0f,
-						static_cast<float>(renderInstances[j][0].model->normalTextureSize.x) / 4096.0f,
-						static_cast<float>(renderInstances[j][0].model->normalTextureSize.y) / 4096.0f,
-					};
-					updatePushConstants(commandBuffers[i], pipelineBundles[0].pipelineLayout, pushConstantInfos[0], &pushConstants);
-					int lightCount = lights.size();
-					updatePushConstants(commandBuffers[i], pipelineBundles[0].pipelineLayout, pushConstantInfos[1], &lightCount);
-					vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(models[j].size), renderInstanceIndexes[j], static_cast<uint32_t>(models[j].offset), 0, 0);
+		secondaryCommandBuffers.assign(commandBuffers.size(), std::vector<VkCommandBuffer>());
+		if (indirectDrawEnabled) {
+			return;
+		}
+
+		// command pools are externally synchronised, so every job system worker gets its own for secondary buffers,
+		// one per image so an image's buffers can be recorded again while the others are still pending
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = findQueueFamilies(physicalDevice).graphicsFamily;
+		workerCommandPools.assign(commandBuffers.size(), std::vector<WorkerCommandPool>(jobSystem.getWorkerCount()));
+		for (auto& imagePools : workerCommandPools) {
+			for (auto& workerPool : imagePools) {
+				if (vkCreateCommandPool(device, &poolInfo, nullptr, &workerPool.pool) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create worker command pool!");
 				}
-				startingIndex += renderInstanceIndexes[j];
 			}
-			
-			vkCmdEndRenderPass(commandBuffers[i]);
+		}
+	}
+
+	std::vector<ModelDraw> Graphics::buildModelDraws() {
+		std::vector<ModelDraw> draws;
+		for (uint32_t j = 0; j < renderInstances.size(); j++) {
+			// a streamed model's slot is empty until it arrives
+			if (renderInstanceIndexes[j] > 0 && models[j].size > 0) {
+				draws.push_back({ j, modelInstanceOffsets[j], static_cast<uint32_t>(renderInstanceIndexes[j]) });
+			}
+		}
+		// cull.comp finds an instance's draw by searching them by firstInstance
+		std::sort(draws.begin(), draws.end(), [](const ModelDraw& a, const ModelDraw& b) { return a.firstInstance < b.firstInstance; });
+		return draws;
+	}
 
-			if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to record command buffer!");
+	// only called from the worker that owns the pool
+	VkCommandBuffer Graphics::acquireSecondaryCommandBuffer(size_t imageIndex, uint32_t workerIndex) {
+		WorkerCommandPool& workerPool = workerCommandPools[imageIndex][workerIndex];
+		if (workerPool.usedCount == workerPool.secondaryCommandBuffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = workerPool.pool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffer!");
 			}
+			workerPool.secondaryCommandBuffers.push_back(commandBuffer);
+		}
+		return workerPool.secondaryCommandBuffers[workerPool.usedCount++];
+	}
+
+	void Graphics::bindSceneResources(VkCommandBuffer commandBuffer, size_t imageIndex) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineBundles[0].pipeline);
+
+		VkBuffer vertexBuffers[] = { vertexBuffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineBundles[0].pipelineLayout, 0, 1, &(pipelineBundles[0].descriptorSets)[imageIndex], 0, nullptr);
+
+		int lightCount = lights.size();
+		updatePushConstants(commandBuffer, pipelineBundles[0].pipelineLayout, pushConstantInfos[1], &lightCount);
+	}
+
+	void Graphics::recordDrawBatch(VkCommandBuffer commandBuffer, size_t imageIndex, size_t first, size_t end) {
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording secondary command buffer!");
+		}
+
+		bindSceneResources(commandBuffer, imageIndex);
+
+		// the same commands the indirect path would draw, with the instances cullInstancesOnCpu left in each,
+		// the push constant holds where the model's instances start in the storage buffer
+		for (size_t i = first; i < end; i++) {
+			const ModelDraw& draw = indirectDraws[i];
+			const Model& model = models[draw.modelIndex];
+			uint32_t firstCommand = indirectFirstCommands[i];
+			uint32_t commandCount = std::max(indirectMeshletCounts[i], 1u) + static_cast<uint32_t>(model.lods.size()) - 1;
+			bool anyVisible = false;
+			for (uint32_t c = 0; c < commandCount; c++) {
+				anyVisible = anyVisible || indirectCommands[firstCommand + c].instanceCount > 0;
+			}
+			if (!anyVisible) {
+				continue;
+			}
+
+			PushConstants pushConstants = {
+				static_cast<int>(draw.firstInstance),
+				static_cast<float>(model.textureOffset.x) / 4096.0f,
+				static_cast<float>(model.textureOffset.y) / 4096.0f,
+				static_cast<float>(model.textureSize.x) / 4096.0f,
+				static_cast<float>(model.textureSize.y) / 4096.0f,
+				model.hasNormalMap,
+				static_cast<float>(model.normalTextureOffset.x) / 4096.0f,
+				static_cast<float>(model.normalTextureOffset.y) / 4096.0f,
+				static_cast<float>(model.normalTextureSize.x) / 4096.0f,
+				static_cast<float>(model.normalTextureSize.y) / 4096.0f,
+			};
+			updatePushConstants(commandBuffer, pipelineBundles[0].pipelineLayout, pushConstantInfos[0], &pushConstants);
+
+			// shader.vert reads the transform at the push constant plus gl_InstanceIndex, which starts at the firstInstance
+			// given here, so each run of consecutive visible instances is one instanced draw
+			for (uint32_t c = 0; c < commandCount; c++) {
+				const VkDrawIndexedIndirectCommand& command = indirectCommands[firstCommand + c];
+				const uint32_t* visible = &visibleInstances[command.firstInstance];
+				uint32_t v = 0;
+				while (v < command.instanceCount) {
+					uint32_t run = 1;
+					while (v + run < command.instanceCount && visible[v + run] == visible[v] + run) {
+						run++;
+					}
+					vkCmdDrawIndexed(commandBuffer, command.indexCount, run, command.firstIndex, 0, visible[v] - draw.firstInstance);
+					v += run;
+				}
+			}
+		}
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record secondary command buffer!");
+		}
+	}
+
+	// every model draw comes from the indirect buffer in a single call, the per draw data is looked up with gl_DrawID
+	void Graphics::recordIndirectDraw(VkCommandBuffer commandBuffer, size_t imageIndex) {
+		bindSceneResources(commandBuffer, imageIndex);
+
+		if (indirectDrawCount > 0) {
+			vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer.buffer, 0, indirectDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+
+	// resets the instance counts, then lets the cull shader append every instance inside the frustum to its draw
+	// recorded outside the render pass, ahead of recordIndirectDraw
+	void Graphics::recordCullPass(VkCommandBuffer commandBuffer, size_t imageIndex) {
+		if (indirectDrawCount == 0) {
+			return;
+		}
+
+		// the previous frame may still be drawing from the indirect and visible instance buffers
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+
+		VkBufferCopy region = {};
+		region.size = sizeof(VkDrawIndexedIndirectCommand) * indirectDrawCount;
+		vkCmdCopyBuffer(commandBuffer, indirectTemplateBuffer.buffer, indirectBuffer.buffer, 1, &region);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineBundles[0].pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineBundles[0].pipelineLayout, 0, 1, &(cullPipelineBundles[0].descriptorSets)[imageIndex], 0, nullptr);
+
+		CullPushConstants cullData = { static_cast<uint32_t>(instanceTransforms.size()), indirectDrawCount };
+		updatePushConstants(commandBuffer, cullPipelineBundles[0].pipelineLayout, cullPushConstantInfos[0], &cullData);
+
+		// one invocation per instance, matches local_size_x in cull.comp
+		vkCmdDispatch(commandBuffer, (cullData.instanceCount + 63) / 64, 1, 1);
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+	}
+
+	// callers must make sure none of the command buffers are still pending on the gpu
+	void Graphics::recordCommandBuffers() {
+		for (size_t i = 0; i < commandBuffers.size(); i++) {
+			recordCommandBuffer(i);
+		}
+	}
+
+	// callers must make sure the image's command buffers are no longer pending on the gpu
+	void Graphics::recordCommandBuffer(size_t imageIndex) {
+		VkCommandBuffer commandBuffer = commandBuffers[imageIndex];
+		uint32_t batchCount = 0;
+
+		// the indirect path records a single draw inline, otherwise there is one draw per model to spread over the workers
+		if (!indirectDrawEnabled) {
+			for (auto& workerPool : workerCommandPools[imageIndex]) {
+				vkResetCommandPool(device, workerPool.pool, 0);
+				workerPool.usedCount = 0;
+			}
+
+			// split the model draws into contiguous batches, small scenes stay on one batch since a job costs more than a few draws
+			size_t drawCount = indirectDraws.size();
+			if (drawCount > 0) {
+				batchCount = std::max(1u, std::min(jobSystem.getWorkerCount(), static_cast<uint32_t>(drawCount) / MIN_DRAWS_PER_BATCH));
+			}
+
+			std::vector<VkCommandBuffer>& secondaries = secondaryCommandBuffers[imageIndex];
+			secondaries.assign(batchCount, VK_NULL_HANDLE);
+
+			jobSystem.parallelFor(batchCount, [&](uint32_t batch, uint32_t workerIndex) {
+				size_t first = drawCount * batch / batchCount;
+				size_t end = drawCount * (batch + 1) / batchCount;
+
+				VkCommandBuffer secondary = acquireSecondaryCommandBuffer(imageIndex, workerIndex);
+				recordDrawBatch(secondary, imageIndex, first, end);
+				secondaries[batch] = secondary;
+			});
+		}
+
+		// beginning a buffer resets it, the pool lets them be reset one at a time
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording command buffer!");
+		}
+
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = swapChainExtent;
+
+		std::array<VkClearValue, 2> clearValues = {};
+		clearValues[0].color = { 0.0f, 0.0f,0.0f, 1.0f };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		if (gpuCullingEnabled) {
+			recordCullPass(commandBuffer, imageIndex);
+		}
+
+		if (indirectDrawEnabled) {
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			recordIndirectDraw(commandBuffer, imageIndex);
+		}
+		else {
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			if (batchCount > 0) {
+				vkCmdExecuteCommands(commandBuffer, batchCount, secondaryCommandBuffers[imageIndex].data());
+			}
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
 		}
 	}
 
@@ -1315,6 +2748,7 @@
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+		imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
 
 		VkSemaphoreCreateInfo semaphoreInfo = {};
 		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1350,10 +2784,17 @@
 
 		UniformBufferObject ubo = {};
 		//ubo.model = glm::rotate(glm::mat4(), 0.0f, glm::vec3(0, 0, 1));
-		ubo.view = glm::lookAt(cameraPosition, cameraPosition + direction, up);
+		glm::vec3 eye = previousCameraPosition + (cameraPosition - previousCameraPosition) * interpolationAlpha;
+		ubo.view = glm::lookAt(eye, eye + direction, up);
 		ubo.proj = glm::perspective(glm::radians(FOV), swapChainExtent.width / (float)swapChainExtent.height, 0.001f, 1000.0f);
+		// pixels a unit covers at distance 1, proj[1][1] is the focal length in half screen heights
+		lodScale = ubo.proj[1][1] * swapChainExtent.height * 0.5f / LOD_PIXEL_ERROR;
 		ubo.proj[1][1] *= -1;
-		ubo.cameraPos = cameraPosition;
+		ubo.cameraPos = eye;
+		ubo.lodScale = lodScale;
+		eyePosition = eye;
+		frustum = frustumCulling::extractFrustum(ubo.proj * ubo.view);
+		std::copy(std::begin(frustum.planes), std::end(frustum.planes), ubo.frustumPlanes);
 		//static auto startTime = std::chrono::high_resolution_clock::now();
 
 		//auto currentTime = std::chrono::high_resolution_clock::now();
@@ -1378,7 +2819,7 @@
 		
 
 		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-		vkResetFences(device, 1, &inFlightFences[currentFrame]);
+		destroyFrameRetirements(frameRetirements[currentFrame]);
 
 		uint32_t imageIndex;
 		VkResult result = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -1391,37 +2832,76 @@
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
 
+		// the uniform buffer and command buffer for this image may still be in use by an older frame
+		if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+			vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		}
+		imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
 		//renderInstances[0][0].transformData = glm::translate(glm::mat4(1.0f), cameraPosition);
 
 		updateUniformBuffer(imageIndex);
-		std::vector<glm::mat4> storageBufferData;
-		for (int i = 0; i < renderInstances.size(); i++) {
-			for (int j = 0; j < renderInstanceIndexes[i]; j++) {
-				storageBufferData.push_back(renderInstances[i][j].transformData);
-			}
+		applyInstanceMotions();
+
+		// only the transforms and lights that changed since the last frame are copied, the device local buffers keep the rest
+		beginUploadFrame(currentFrame);
+		commitStreamedAssets();
+		uploadStats.transformBytes = stageDirtyRanges(transformBuffer, transformDirtyRanges, instanceTransforms.data(), sizeof(glm::mat4), instanceTransforms.size());
+		uploadStats.lightBytes = stageDirtyRanges(lightBuffer, lightDirtyRanges, lights.data(), sizeof(LightData), lights.size());
+		// the indirect commands change exactly when the recorded draws would have to, so they are rebuilt alongside them,
+		// the push constant path draws the same commands one by one
+		if (commandBuffersDirty) {
+			stageIndirectDraws(buildModelDraws());
+		}
+		if (!gpuCullingEnabled) {
+			cullInstancesOnCpu();
+		}
+		uploadStats.copyRegions = static_cast<uint32_t>(pendingUploads.size());
+		recordUploadCommands(uploadCommandBuffers[currentFrame]);
+		for (const StreamedTexture& texture : textureCopies) {
+			frameRetirements[currentFrame].buffers.emplace_back(texture.stagingBuffer, texture.stagingBufferMemory);
 		}
+		textureCopies.clear();
 
-		VkDeviceSize maxBufferSize = sizeof(storageBufferData[0]) * MAX_RENDER_INSTANCES;
-		updateStorageBuffer(transformBuffer, storageBufferData);
-		updateStorageBuffer(lightBuffer, lights);
-		createCommandBuffers();
+		// the indirect draws are recorded once and only redone when the number of instances per model or lights changes,
+		// the push constant draws hold the visible instances themselves, so this image's are recorded again every frame
+		if (!indirectDrawEnabled) {
+			recordCommandBuffer(imageIndex);
+		}
+		else if (commandBuffersDirty) {
+			vkWaitForFences(device, MAX_FRAMES_IN_FLIGHT, inFlightFences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+			recordCommandBuffers();
+		}
+		commandBuffersDirty = false;
+
+		vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
+		// streamed models' copies on the transfer queue have to land before anything reads the vertex, index or meshlet buffers
+		std::vector<VkSemaphore> waitSemaphores = { imageAvailableSemaphores[currentFrame] };
+		std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		for (VkSemaphore semaphore : streamWaitSemaphores) {
+			waitSemaphores.push_back(semaphore);
+			waitStages.push_back(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			frameRetirements[currentFrame].semaphores.push_back(semaphore);
+		}
+		streamWaitSemaphores.clear();
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
 
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+		// uploads go first in the same submission, their barriers order them before the draw reads
+		VkCommandBuffer submitCommandBuffers[] = { uploadCommandBuffers[currentFrame], commandBuffers[imageIndex] };
+		submitInfo.commandBufferCount = 2;
+		submitInfo.pCommandBuffers = submitCommandBuffers;
 
 		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
+		std::unique_lock<std::mutex> queueLock(queueMutex);
 		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
@@ -1439,6 +2919,7 @@
 		presentInfo.pImageIndices = &imageIndex;
 
 		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+		queueLock.unlock();
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
 			framebufferResized = false;
@@ -1600,6 +3081,16 @@
 			i++;
 		}
 
+		// copies on a family the frame's work doesn't use can overlap with drawing instead of queueing behind it
+		indices.transferFamily = indices.graphicsFamily;
+		for (uint32_t family = 0; family < queueFamilyCount; family++) {
+			VkQueueFlags flags = queueFamilies[family].queueFlags;
+			if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				indices.transferFamily = static_cast<int>(family);
+				break;
+			}
+		}
+
 		return indices;
 	}
 
@@ -1660,6 +3151,11 @@
 		return buffer;
 	}
 
+	bool Graphics::fileExists(const std::string& filename) {
+		std::ifstream file(filename, std::ios::binary);
+		return file.is_open();
+	}
+
 	VKAPI_ATTR VkBool32 VKAPI_CALL Graphics::debugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location, int32_t code, const char* layerPrefix, const char* msg, void* userData) {
 		std::cerr << "validation layer: " << msg << std::endl;
 
@@ -1668,13 +3164,19 @@
 
 	void Graphics::loadResources()
 	{
-		loadModel("resources/models/texcube.obj", glm::vec4(0.9, 0.1, 0.1, 1), 1);
-		loadModel("resources/models/test3.obj", glm::vec4(0.2, 0.4, 0.9, 1), 1);
-		loadModel("resources/models/xyzOrigin.obj", glm::vec4(0.1, 0.9, 0.1, 1), 1);
-		loadModel("resources/models/bep.obj", glm::vec4(0.7, 0.9, 0.1, 1), 1);
+		loadModels({
+			{ "resources/models/texcube.obj", glm::vec4(0.9, 0.1, 0.1, 1), 1 },
+			{ "resources/models/test3.obj", glm::vec4(0.2, 0.4, 0.9, 1), 1, true, true },
+			{ "resources/models/xyzOrigin.obj", glm::vec4(0.1, 0.9, 0.1, 1), 1 },
+			{ "resources/models/bep.obj", glm::vec4(0.7, 0.9, 0.1, 1), 1, false, true },
+		});
 		renderInstances.resize(models.size());
 		renderInstanceIndexes.resize(models.size());
 		std::fill(renderInstanceIndexes.begin(), renderInstanceIndexes.end(), 0);
+		modelInstanceOffsets.resize(models.size());
+		std::fill(modelInstanceOffsets.begin(), modelInstanceOffsets.end(), 0);
+		modelInstanceCapacities.resize(models.size());
+		std::fill(modelInstanceCapacities.begin(), modelInstanceCapacities.end(), 0);
 	}
 
 
@@ -1691,6 +3193,7 @@
 	void Graphics::setUpCamera() {
 		cameraAngle = glm::vec3(1, 1, 1);
 		cameraPosition = glm::vec3(0, 0, 0);
+		previousCameraPosition = cameraPosition;
 	}
 
 	void Graphics::changeCameraPos(float x, float y, float z) {
@@ -1698,6 +3201,7 @@
 		cameraPosition += x * right * cameraVelocity;
 		cameraPosition.y += y * cameraVelocity;
 		cameraPosition += z * forward * cameraVelocity;
+		previousCameraPosition = cameraPosition;
 	}
 
 	glm::vec3 Graphics::getProperCameraVelocity(glm::vec3 cameraVel) {
@@ -1714,6 +3218,12 @@
 	void Graphics::setCameraPos(glm::vec3 cameraPos)
 	{
 		cameraPosition = cameraPos;
+		previousCameraPosition = cameraPos;
+	}
+
+	void Graphics::setCameraPos(glm::vec3 previousPos, glm::vec3 currentPos) {
+		previousCameraPosition = previousPos;
+		cameraPosition = currentPos;
 	}
 
 	GLFWwindow* Graphics::getWindowPointer() {
@@ -1722,7 +3232,7 @@
 
 	void Graphics::addRenderInstance(float x, float y, float z, int modelIndex) {
 		
-		if (modelIndex >= models.size()) {
+		if (modelIndex < 0 || static_cast<size_t>(modelIndex) >= models.size()) {
 			std::cout << "Model index " << modelIndex << "out of range" << std::endl;
 			return;
 		}
@@ -1735,23 +3245,160 @@
 		modelRenderInstances.emplace_back();
 
 		RenderInstance& instance = modelRenderInstances[renderInstanceIndexes[modelIndex]];
-		renderInstanceIndexes[modelIndex]++;
 		instance.model = &models[modelIndex];
 		instance.transformData = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
+
+		// the new instance takes the next free slot of its model's block, so only that slot is uploaded
+		if (renderInstanceIndexes[modelIndex] == modelInstanceCapacities[modelIndex]) {
+			growInstanceBlock(modelIndex);
+		}
+		uint32_t flatIndex = modelInstanceOffsets[modelIndex] + static_cast<uint32_t>(renderInstanceIndexes[modelIndex]);
+		instanceTransforms[flatIndex] = instance.transformData;
+		transformDirtyRanges.mark(flatIndex, 1);
+
+		renderInstanceIndexes[modelIndex]++;
 		totalRenderInstances++;
+		commandBuffersDirty = true;
 		if (modelRenderInstances.size() >= modelRenderInstances.capacity()) {
 			modelRenderInstances.reserve(modelRenderInstances.size() + 5);  // Add margin of 5
 		}
 	}
 
+	void Graphics::growInstanceBlock(int modelIndex) {
+		uint32_t offset = modelInstanceOffsets[modelIndex];
+		uint32_t count = static_cast<uint32_t>(renderInstanceIndexes[modelIndex]);
+		uint32_t capacity = std::max(count * 2, 4u);
+		if (offset + modelInstanceCapacities[modelIndex] != instanceTransforms.size()) {
+			if (instanceTransforms.size() + capacity > static_cast<size_t>(MAX_RENDER_INSTANCES)) {
+				// the blocks left behind by moves have used up the buffer
+				packInstanceBlocks(modelIndex);
+			}
+			else {
+				// moved to the end, the slots it leaves are culled as part of no draw
+				uint32_t moved = static_cast<uint32_t>(instanceTransforms.size());
+				instanceTransforms.resize(moved + count);
+				std::copy(instanceTransforms.begin() + offset, instanceTransforms.begin() + offset + count, instanceTransforms.begin() + moved);
+				modelInstanceOffsets[modelIndex] = moved;
+				transformDirtyRanges.mark(moved, count);
+			}
+		}
+
+		// the block is last, so it grows in place
+		offset = modelInstanceOffsets[modelIndex];
+		capacity = std::min(capacity, static_cast<uint32_t>(MAX_RENDER_INSTANCES) - offset);
+		modelInstanceCapacities[modelIndex] = capacity;
+		instanceTransforms.resize(offset + capacity);
+	}
+
+	void Graphics::packInstanceBlocks(int lastModel) {
+		std::vector<glm::mat4> packed;
+		packed.reserve(totalRenderInstances);
+		auto pack = [&](size_t j) {
+			uint32_t count = static_cast<uint32_t>(renderInstanceIndexes[j]);
+			auto first = instanceTransforms.begin() + modelInstanceOffsets[j];
+			modelInstanceOffsets[j] = static_cast<uint32_t>(packed.size());
+			modelInstanceCapacities[j] = count;
+			packed.insert(packed.end(), first, first + count);
+		};
+		for (size_t j = 0; j < modelInstanceOffsets.size(); j++) {
+			if (j != static_cast<size_t>(lastModel)) {
+				pack(j);
+			}
+		}
+		pack(lastModel);
+		instanceTransforms.swap(packed);
+		transformDirtyRanges.mark(0, static_cast<uint32_t>(instanceTransforms.size()));
+	}
+
+	size_t Graphics::getRenderInstanceCount(int modelIndex) {
+		return modelIndex >= 0 && static_cast<size_t>(modelIndex) < models.size() ? renderInstanceIndexes[modelIndex] : 0;
+	}
+
+	glm::mat4 Graphics::getRenderInstanceTransform(int modelIndex, size_t instanceIndex) {
+		if (modelIndex < 0 || static_cast<size_t>(modelIndex) >= models.size() || instanceIndex >= renderInstanceIndexes[modelIndex]) {
+			return glm::mat4(1.0f);
+		}
+		return renderInstances[modelIndex][instanceIndex].transformData;
+	}
+
+	const collisionDetection::TriangleMesh* Graphics::getModelCollider(int modelIndex) {
+		return modelIndex >= 0 && static_cast<size_t>(modelIndex) < models.size() ? models[modelIndex].collider.get() : nullptr;
+	}
+
+	void Graphics::setRenderInstanceTransform(int modelIndex, size_t instanceIndex, const glm::mat4& transform) {
+		if (modelIndex < 0 || static_cast<size_t>(modelIndex) >= models.size() || instanceIndex >= renderInstanceIndexes[modelIndex]) {
+			std::cout << "Render instance " << instanceIndex << " of model " << modelIndex << " out of range" << std::endl;
+			return;
+		}
+		renderInstances[modelIndex][instanceIndex].transformData = transform;
+		instanceMotions.erase((static_cast<uint64_t>(modelIndex) << 32) | instanceIndex);
+
+		uint32_t flatIndex = modelInstanceOffsets[modelIndex] + static_cast<uint32_t>(instanceIndex);
+		instanceTransforms[flatIndex] = transform;
+		transformDirtyRanges.mark(flatIndex, 1);
+	}
+
+	void Graphics::setRenderInstanceTransform(int modelIndex, size_t instanceIndex, const glm::mat4& previous, const glm::mat4& current) {
+		if (modelIndex < 0 || static_cast<size_t>(modelIndex) >= models.size() || instanceIndex >= renderInstanceIndexes[modelIndex]) {
+			std::cout << "Render instance " << instanceIndex << " of model " << modelIndex << " out of range" << std::endl;
+			return;
+		}
+		renderInstances[modelIndex][instanceIndex].transformData = current;
+		instanceMotions[(static_cast<uint64_t>(modelIndex) << 32) | instanceIndex] = { modelIndex, instanceIndex, previous, current };
+	}
+
+	void Graphics::setInterpolationAlpha(float alpha) {
+		interpolationAlpha = alpha;
+	}
+
+	void Graphics::applyInstanceMotions() {
+		// flat indices move when instances are added to earlier models, so they are looked up every frame
+		for (auto& entry : instanceMotions) {
+			const InstanceMotion& motion = entry.second;
+			uint32_t flatIndex = modelInstanceOffsets[motion.modelIndex] + static_cast<uint32_t>(motion.instanceIndex);
+			instanceTransforms[flatIndex] = motion.previous + (motion.current - motion.previous) * interpolationAlpha;
+			transformDirtyRanges.mark(flatIndex, 1);
+		}
+	}
+
+	UploadStats Graphics::getUploadStats() {
+		return uploadStats;
+	}
+
+	frustumCulling::CullStats Graphics::getCullStats() {
+		return cullStats;
+	}
+
+	meshletCulling::CullStats Graphics::getMeshletCullStats() {
+		return meshletCullStats;
+	}
+
+	JobSystem& Graphics::getJobSystem() {
+		return jobSystem;
+	}
+
 	void Graphics::resetRenderInstances() {
+		for (auto& instances : renderInstances) {
+			instances.clear();
+		}
 		std::fill(renderInstanceIndexes.begin(), renderInstanceIndexes.end(), 0);
+		std::fill(modelInstanceOffsets.begin(), modelInstanceOffsets.end(), 0);
+		std::fill(modelInstanceCapacities.begin(), modelInstanceCapacities.end(), 0);
+		instanceTransforms.clear();
+		instanceMotions.clear();
+		transformDirtyRanges.clear();
+		totalRenderInstances = 0;
+		commandBuffersDirty = true;
 	}
 
 	glm::vec3 Graphics::getCameraPos() {
 		return cameraPosition;
 	}
 
+	glm::vec3 Graphics::getCameraDirection() {
+		return direction;
+	}
+
 	void Graphics::clearStorageBuffer(StorageBufferObject& storageBuffer) {
 		vkDestroyBuffer(device, storageBuffer.buffer, nullptr);
 		vkFreeMemory(device, storageBuffer.memory, nullptr);
@@ -1907,6 +3554,59 @@
 		return graphicsPipeline;
 	}
 
+	VkPipeline Graphics::createComputePipeline(const std::string& compShaderPath, VkDescriptorSetLayout descriptorSetLayout,
+		VkPipelineLayout& pipelineLayout, std::vector<PushConstantInfo>& pushConstantInfos) {
+		auto compShaderCode = readFile(compShaderPath);
+
+		VkShaderModule compShaderModule = createShaderModule(compShaderCode);
+
+		VkPipelineShaderStageCreateInfo compShaderStageInfo = {};
+		compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		compShaderStageInfo.module = compShaderModule;
+		compShaderStageInfo.pName = "main";
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+		std::vector<VkPushConstantRange> pushConstantRanges;
+		uint32_t offset = 0;
+
+		for (int i = 0; i < pushConstantInfos.size(); i++) {
+			VkPushConstantRange range{};
+			range.offset = offset;
+			range.size = pushConstantInfos[i].size;
+			range.stageFlags = pushConstantInfos[i].stageFlags;
+			pushConstantRanges.push_back(range);
+			pushConstantInfos[i].offset = offset;
+			offset += pushConstantInfos[i].size;
+		}
+
+		pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+		pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute pipeline layout!");
+		}
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = compShaderStageInfo;
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		VkPipeline computePipeline;
+		if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute pipeline!");
+		}
+
+		vkDestroyShaderModule(device, compShaderModule, nullptr);
+
+		return computePipeline;
+	}
+
 	void Graphics::updatePushConstants(VkCommandBuffer commandBuffer,
 							VkPipelineLayout pipelineLayout,
 							const PushConstantInfo& pcInfo,
@@ -1952,6 +3652,8 @@ void Graphics::addLight(glm::vec3 position, glm::vec3 color, float intensity) {
 	light.color = color;
 	light.intensity = intensity;
 	lights.push_back(light);
+	lightDirtyRanges.mark(static_cast<uint32_t>(lights.size() - 1), 1);
+	commandBuffersDirty = true; // the light count is a push constant
 }
 
 void Graphics::updateDescriptorSet(const PipelineBundle& bundle, int index) {
@@ -2034,14 +3736,7 @@ VkDescriptorPool Graphics::createDescriptorPool(const std::vector<VkDescriptorPo
     return descriptorPool;
 }
 
-PipelineBundle Graphics::createCurrentPipelineBundle(std::vector<descriptorSetObject> descriptorSetObjects, VkExtent2D swapChainExtent, VkRenderPass renderPass,
-	uint32_t swapChainImageCount, std::vector<PushConstantInfo> &pushConstantInfos) {
-
-	//to make a descriptor available in multiple stages, do something like this: VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT
-	
-	std::vector<VkDescriptorSetLayoutBinding> bindings;
-	std::vector<DescriptorInfo> descriptorInfos;
-
+void Graphics::buildDescriptorBindings(std::vector<descriptorSetObject>& descriptorSetObjects, std::vector<VkDescriptorSetLayoutBinding>& bindings, std::vector<DescriptorInfo>& descriptorInfos) {
 	for (int i = 0; i < descriptorSetObjects.size(); i++) {
 		descriptorSetObjects[i].binding = i;
 		VkDescriptorSetLayoutBinding binding = {descriptorSetObjects[i].binding, descriptorSetObjects[i].type, descriptorSetObjects[i].count, descriptorSetObjects[i].stageFlags, nullptr};
@@ -2062,6 +3757,16 @@ PipelineBundle Graphics::createCurrentPipelineBundle(std::vector<descriptorSetOb
 		descriptorInfos.push_back(info);
 		descriptorSetObjects[i].info = info;
 	}
+}
+
+PipelineBundle Graphics::createCurrentPipelineBundle(std::vector<descriptorSetObject> descriptorSetObjects, VkExtent2D swapChainExtent, VkRenderPass renderPass,
+	uint32_t swapChainImageCount, std::vector<PushConstantInfo> &pushConstantInfos, const std::string& vertShaderPath) {
+
+	//to make a descriptor available in multiple stages, do something like this: VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT
+	
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::vector<DescriptorInfo> descriptorInfos;
+	buildDescriptorBindings(descriptorSetObjects, bindings, descriptorInfos);
 
 	VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayout(bindings);
 
@@ -2073,12 +3778,49 @@ PipelineBundle Graphics::createCurrentPipelineBundle(std::vector<descriptorSetOb
 	VkDescriptorPool descriptorPool = createDescriptorPool(poolSizes, swapChainImageCount);
 
 	VkPipelineLayout pipelineLayout;
-	VkPipeline pipeline = createGraphicsPipeline("resources/shaders/vert.spv", "resources/shaders/frag.spv",
+	VkPipeline pipeline = createGraphicsPipeline(vertShaderPath, FRAGMENT_SHADER_PATH,
 		descriptorSetLayout, swapChainExtent, renderPass, pipelineLayout, pushConstantInfos);
 
 	std::vector<VkDescriptorSet> descriptorSets = createDescriptorSets(descriptorPool, descriptorSetLayout, swapChainImageCount);
 
-	return PipelineBundle(pipeline, pipelineLayout, std::move(descriptorSets), std::move(descriptorInfos), std::move(descriptorSetObjects));
+	PipelineBundle bundle(pipeline, pipelineLayout, std::move(descriptorSets), std::move(descriptorInfos), std::move(descriptorSetObjects));
+	bundle.descriptorSetLayout = descriptorSetLayout;
+	bundle.descriptorPool = descriptorPool;
+	return bundle;
+}
+
+// compute counterpart of createCurrentPipelineBundle, one descriptor set per swap chain image since each reads that image's uniform buffer
+PipelineBundle Graphics::createCullPipelineBundle(std::vector<descriptorSetObject> descriptorSetObjects, uint32_t swapChainImageCount, std::vector<PushConstantInfo>& pushConstantInfos) {
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	std::vector<DescriptorInfo> descriptorInfos;
+	buildDescriptorBindings(descriptorSetObjects, bindings, descriptorInfos);
+
+	VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayout(bindings);
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto& binding : bindings) {
+		poolSizes.push_back({ binding.descriptorType, swapChainImageCount });
+	}
+	VkDescriptorPool descriptorPool = createDescriptorPool(poolSizes, swapChainImageCount);
+
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline = createComputePipeline(CULL_SHADER_PATH, descriptorSetLayout, pipelineLayout, pushConstantInfos);
+
+	std::vector<VkDescriptorSet> descriptorSets = createDescriptorSets(descriptorPool, descriptorSetLayout, swapChainImageCount);
+
+	PipelineBundle bundle(pipeline, pipelineLayout, std::move(descriptorSets), std::move(descriptorInfos), std::move(descriptorSetObjects));
+	bundle.descriptorSetLayout = descriptorSetLayout;
+	bundle.descriptorPool = descriptorPool;
+	return bundle;
+}
+
+// destroying the pool frees the bundle's descriptor sets with it
+void Graphics::destroyPipelineBundle(PipelineBundle& bundle) {
+	vkDestroyPipeline(device, bundle.pipeline, nullptr);
+	vkDestroyPipelineLayout(device, bundle.pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, bundle.descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, bundle.descriptorSetLayout, nullptr);
+	bundle.descriptorSets.clear();
 }
 
 void Graphics::updateDescriptorResource(PipelineBundle& bundle, std::string name, descriptorResource& resource) {
@@ -2100,6 +3842,22 @@ void Graphics::updateDescriptorResource(PipelineBundle& bundle, std::string name
 	}
 }
 
+// points every descriptor of a bundle at the resources it reads and writes each swap chain image's set, names the bundle doesn't use are skipped
+void Graphics::bindDescriptorResources(PipelineBundle& bundle) {
+	updateDescriptorResource(bundle, "Uniform Buffer", descriptorResource(uniformBuffers));
+	updateDescriptorResource(bundle, "Texture", descriptorResource(textureSampler, textureImageView));
+	updateDescriptorResource(bundle, "Storage Buffer", descriptorResource(transformBuffer.buffer));
+	updateDescriptorResource(bundle, "Light Buffer", descriptorResource(lightBuffer.buffer));
+	updateDescriptorResource(bundle, "Draw Data", descriptorResource(drawDataBuffer.buffer));
+	updateDescriptorResource(bundle, "Indirect Commands", descriptorResource(indirectBuffer.buffer));
+	updateDescriptorResource(bundle, "Visible Instances", descriptorResource(visibleInstanceBuffer.buffer));
+	updateDescriptorResource(bundle, "Material Table", descriptorResource(materialBuffer.buffer));
+	updateDescriptorResource(bundle, "Meshlet Table", descriptorResource(meshletBuffer.buffer));
+	for (int i = 0; i < swapChainImages.size(); i++) {
+		updateDescriptorSet(bundle, i);
+	}
+}
+
 void copyImageSection(unsigned char* src, int srcWidth, int srcHeight, int srcChannels,
 	unsigned char* dest, int destWidth, int destHeight, int destChannels,
 	int srcX, int srcY, int destX, int destY, int copyWidth, int copyHeight) {
@@ -2167,7 +3925,8 @@ void Graphics::readImageInfoFromFile(const std::string& filePath) {
 			}
 
 			// Store the parsed data in atlasOffsets (assuming atlasOffsets stores name, coordinates, and size)
-			atlasOffsets.push_back({ filename, glm::vec2(x, y), glm::vec2(w, h) });
+			std::replace(fullPath.begin(), fullPath.end(), '\\', '/');
+			atlasOffsets.push_back({ filename, fullPath, glm::vec2(x, y), glm::vec2(w, h) });
 		}
 	}
 	file.close();
@@ -5,10 +5,8 @@
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/hash.hpp>
 
 
 
@@ -23,6 +21,23 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "JobSystem.h"
+#include "FrustumCulling.h"
+#include "TriangleMesh.h"
+#include "MeshCache.h"
+#include "VertexWelder.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "MeshSimplifier.h"
+#include "MeshletCulling.h"
+#include "RangeAllocator.h"
+#include "FileWatcher.h"
 
 struct DescriptorInfo {
 	VkDescriptorType type;
@@ -75,6 +90,8 @@ struct PipelineBundle {
 	std::vector<VkDescriptorSet> descriptorSets;  // One per swap chain image
 	std::vector<DescriptorInfo> descriptorInfos;  // New member to store descriptor information
 	std::vector<descriptorSetObject> descriptorSetObjects;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE; // kept so the pipeline can be rebuilt when its shaders change
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE; // the descriptor sets come from this, kept so they go with the bundle
 	// Constructor to initialize members
 	PipelineBundle(VkPipeline p, VkPipelineLayout pl,
 		std::vector<VkDescriptorSet> ds,
@@ -106,6 +123,75 @@ struct StorageBufferObject {
 	VkDeviceSize size;
 };
 
+//host visible staging buffer that stays mapped, split into one region per frame in flight
+struct UploadRing {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	char* mapped = nullptr;
+	VkDeviceSize regionSize = 0;
+	VkDeviceSize regionOffset = 0; // start of the region owned by the current frame
+	VkDeviceSize head = 0;         // write position inside that region
+};
+
+struct PendingUpload {
+	VkBuffer dstBuffer;
+	VkBufferCopy region;
+};
+
+//command pool owned by one job system worker for one swap chain image, secondary command buffers are reused after the pool is reset
+struct WorkerCommandPool {
+	VkCommandPool pool;
+	std::vector<VkCommandBuffer> secondaryCommandBuffers;
+	uint32_t usedCount = 0;
+};
+
+//one instanced draw of every instance of a model
+struct ModelDraw {
+	uint32_t modelIndex;
+	uint32_t firstInstance; // into the transform buffer
+	uint32_t instanceCount;
+};
+
+//element ranges of a cpu side array that changed since they were last uploaded
+struct DirtyRanges {
+	std::vector<std::pair<uint32_t, uint32_t>> ranges; // [first, end)
+
+	void mark(uint32_t first, uint32_t count) {
+		if (count > 0) {
+			ranges.emplace_back(first, first + count);
+		}
+	}
+
+	// sorts the ranges and merges any that overlap or touch, so each becomes a single copy
+	void merge() {
+		if (ranges.size() < 2) {
+			return;
+		}
+		std::sort(ranges.begin(), ranges.end());
+		size_t last = 0;
+		for (size_t i = 1; i < ranges.size(); i++) {
+			if (ranges[i].first <= ranges[last].second) {
+				ranges[last].second = std::max(ranges[last].second, ranges[i].second);
+			}
+			else {
+				ranges[++last] = ranges[i];
+			}
+		}
+		ranges.resize(last + 1);
+	}
+
+	void clear() {
+		ranges.clear();
+	}
+};
+
+//what actually went to the gpu in the last frame
+struct UploadStats {
+	VkDeviceSize transformBytes = 0;
+	VkDeviceSize lightBytes = 0;
+	uint32_t copyRegions = 0;
+};
+
 struct Texture {
 	VkImage textureImage;
 	VkDeviceMemory textureImageMemory;
@@ -116,15 +202,30 @@ struct Texture {
 	uint32_t mipLevels;
 };
 
+//one level of detail of a model, offset and size are into the shared indices like the model's own
+struct ModelLod {
+	uint32_t offset;
+	uint32_t size;
+	float error; // model space distance the lod's surface is off by, 0 for the full model
+};
+
 //model struct
 struct Model {
 	uint32_t offset;
 	uint32_t size;
+	std::vector<ModelLod> lods; // lods[0] is offset and size above, coarser ones follow
+	uint32_t firstMeshlet; // into the meshlet table, the full model's triangles split up, each meshlet's are consecutive
+	uint32_t meshletCount;
+	uint32_t vertexOffset; // the model's ranges of the shared vertices and indices, every lod's indices from offset on
+	uint32_t vertexCount;
+	uint32_t indexCount;
 	glm::vec2 textureOffset;
 	glm::vec2 textureSize;
 	bool hasNormalMap;
 	glm::vec2 normalTextureOffset;
 	glm::vec2 normalTextureSize;
+	frustumCulling::BoundingVolume bounds; // model space
+	std::shared_ptr<collisionDetection::TriangleMesh> collider; // model space, null unless asked for when loaded
 };
 
 //Object struct
@@ -133,8 +234,17 @@ struct RenderInstance {
 	glm::mat4 transformData;
 };
 
+// an instance moved by the fixed step simulation, drawn between where it was at the last two steps
+struct InstanceMotion {
+	int modelIndex;
+	size_t instanceIndex;
+	glm::mat4 previous;
+	glm::mat4 current;
+};
+
 struct ImageInfo {
 	std::string name;
+	std::string path; // the file the region was packed from
 	glm::vec2 coordinates;
 	glm::vec2 dimensions;
 };
@@ -159,6 +269,8 @@ struct UniformBufferObject {
 	glm::mat4 view;
 	glm::mat4 proj;
 	glm::vec3 cameraPos;
+	float lodScale; // see meshSimplifier::selectLod
+	glm::vec4 frustumPlanes[6]; // world space, xyz = normal pointing inwards, w = distance
 };
 
 struct PushConstants {
@@ -175,15 +287,43 @@ struct PushConstants {
 };
 static_assert(sizeof(PushConstants) == 40, "PushConstants struct size must be 40 bytes");
 
+//per draw data for the indirect path, read in the vertex shader with gl_DrawID and by the cull shader, laid out for std430
+struct DrawData {
+	glm::vec4 textureOffsetSize;       // xy = offset, zw = size, in atlas uv
+	glm::vec4 normalTextureOffsetSize; // xy = offset, zw = size, in atlas uv
+	glm::vec4 boundingSphere;          // of the model, in model space
+	int hasNormalMap;
+	uint32_t firstInstance;            // into the transform buffer
+	uint32_t instanceCount;            // before culling
+	uint32_t firstCommand;             // of the model's draws, the full model is meshletCount of them, or one when that's 0, then one per coarser lod
+	uint32_t meshletCount;
+	uint32_t meshlet;                  // into the meshlet table, of a meshlet's draw
+	uint32_t lodCount;
+	float lodError;                    // of the lod this draw is of
+};
+static_assert(sizeof(DrawData) == 80, "DrawData struct size must match the std430 array stride");
+
+struct CullPushConstants {
+	uint32_t instanceCount;
+	uint32_t drawCount;
+};
+
+// lighting constants shared by every vertex of a material, indexed by Vertex::material, laid out for std430
+struct MaterialData {
+	glm::vec4 diffuse;  // rgb = Kd, a = opacity, d or Tr
+	glm::vec4 specular; // rgb = Ks, a = shininess, Ns
+	glm::vec4 ambient;  // rgb = Ka
+};
+static_assert(sizeof(MaterialData) == 48, "MaterialData struct size must match the std430 array stride");
+
+// 24 bytes, positions stay full floats since bounds, colliders and the optimizer read them on the cpu,
+// the rest is packed with vertexPacking and unpacked by the vertex fetch and the vertex shaders
 struct Vertex {
 	glm::vec3 pos;
-	glm::vec3 normal;
-	glm::vec2 texCoord;
-	glm::vec3 diffuse;   // Kd
-	glm::vec3 specular;  // Ks
-	glm::vec3 ambient;   // Ka
-	float shininess;     // Ns
-	float opacity;       // d or Tr
+	int16_t normal[2];    // octahedral, snorm16
+	uint16_t texCoord[2]; // halves
+	uint16_t material;    // into the material table
+	uint16_t padding;     // always 0, vertices are welded and hashed as raw bytes
 
 	static VkVertexInputBindingDescription getBindingDescription() {
 		VkVertexInputBindingDescription bindingDescription = {};
@@ -193,8 +333,8 @@ struct Vertex {
 		return bindingDescription;
 	}
 
-	static std::array<VkVertexInputAttributeDescription, 8> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 8> attributeDescriptions = {};
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = {};
 		attributeDescriptions[0].binding = 0;
 		attributeDescriptions[0].location = 0;
 		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
@@ -202,56 +342,92 @@ struct Vertex {
 
 		attributeDescriptions[1].binding = 0;
 		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
 		attributeDescriptions[1].offset = offsetof(Vertex, normal);
 
 		attributeDescriptions[2].binding = 0;
 		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+		attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
 		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
 
 		attributeDescriptions[3].binding = 0;
 		attributeDescriptions[3].location = 3;
-		attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[3].offset = offsetof(Vertex, diffuse);
-
-		attributeDescriptions[4].binding = 0;
-		attributeDescriptions[4].location = 4;
-		attributeDescriptions[4].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[4].offset = offsetof(Vertex, specular);
-
-		attributeDescriptions[5].binding = 0;
-		attributeDescriptions[5].location = 5;
-		attributeDescriptions[5].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[5].offset = offsetof(Vertex, ambient);
-
-		attributeDescriptions[6].binding = 0;
-		attributeDescriptions[6].location = 6;
-		attributeDescriptions[6].format = VK_FORMAT_R32_SFLOAT;
-		attributeDescriptions[6].offset = offsetof(Vertex, shininess);
-
-		attributeDescriptions[7].binding = 0;
-		attributeDescriptions[7].location = 7;
-		attributeDescriptions[7].format = VK_FORMAT_R32_SFLOAT;
-		attributeDescriptions[7].offset = offsetof(Vertex, opacity);
+		attributeDescriptions[3].format = VK_FORMAT_R16_UINT;
+		attributeDescriptions[3].offset = offsetof(Vertex, material);
 
 		return attributeDescriptions;
 	}
 
 	bool operator==(const Vertex& other) const {
-		return pos == other.pos && normal == other.normal && texCoord == other.texCoord &&
-			diffuse == other.diffuse && specular == other.specular && ambient == other.ambient &&
-			shininess == other.shininess && opacity == other.opacity;
+		return pos == other.pos && normal[0] == other.normal[0] && normal[1] == other.normal[1] &&
+			texCoord[0] == other.texCoord[0] && texCoord[1] == other.texCoord[1] && material == other.material;
 	}
 };
+static_assert(sizeof(Vertex) == 24, "Vertex struct size must match the attribute offsets");
+
+// a model to load and what to load it with
+struct ModelSource {
+	std::string path;
+	glm::vec4 colour;
+	float scale;
+	bool buildCollider = false;
+	bool generateLods = false;
+};
 
-namespace std {
-	template<> struct hash<Vertex> {
-		size_t operator()(Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
-		}
-	};
-}
+// one model's geometry after importing, before it is added to the shared arrays,
+// either mapped from its cooked file or freshly parsed into the vectors
+struct ImportedModel {
+	std::unique_ptr<meshCache::CookedMesh> cooked;
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices; // from the model's first vertex, every lod one after the other
+	std::vector<meshCache::LodRange> lods; // the full model first, always at least that one
+	std::vector<meshletCulling::Meshlet> meshlets; // of the full model, index ranges from the model's first index
+	std::vector<MaterialData> materials; // the vertices' material ids count from the model's first material
+	std::string textureName;
+	std::string normalMapName;
+	bool cacheWritten = true;
+	bool optimized = false; // freshly imported, so the stats below are filled in
+	meshOptimizer::VertexCacheStats before;
+	meshOptimizer::VertexCacheStats after;
+};
+
+// a model or texture asked for with streamModel or streamTexture, waiting for a loader thread
+struct StreamRequest {
+	ModelSource source;      // of a model
+	int modelIndex = -1;     // the slot reserved for a model, -1 for a texture
+	bool reload = false;     // replaces a model that is already there, collider included
+	std::string materialLibrary; // when set, a reload only goes ahead if the model's obj uses this library
+	std::string textureName; // of a texture, its region of the atlas gets the file's new pixels
+};
+
+// a model imported by a loader thread, its geometry already copied into the shared buffers on the transfer queue
+struct StreamedModel {
+	int modelIndex;
+	bool reload;
+	Model model;
+	std::vector<Vertex> vertices; // cpu copies of what was copied, for the shared arrays
+	std::vector<uint32_t> indices;
+	std::vector<meshletCulling::Meshlet> meshlets;
+	uint32_t vertexOffset;
+	uint32_t indexOffset;
+	VkSemaphore copied; // signalled by the transfer submit, the first frame drawing the model waits on it
+};
+
+// a texture decoded by a loader thread, every mip level of its atlas region in a staging buffer,
+// copied by the next frame's upload commands since only the queue sampling the atlas can change its layout
+struct StreamedTexture {
+	std::string name;
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	std::vector<VkBufferImageCopy> regions;
+};
+
+// what a frame's submission used that has to live until its fence signals
+struct FrameRetirements {
+	std::vector<VkSemaphore> semaphores;
+	std::vector<std::pair<VkBuffer, VkDeviceMemory>> buffers;
+	std::vector<Model> replacedModels; // reloaded, their ranges of the shared buffers go back to the allocators
+};
 
 struct SwapChainSupportDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -263,6 +439,7 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
 	int graphicsFamily = -1;
 	int presentFamily = -1;
+	int transferFamily = -1; // a family with transfer and neither graphics nor compute when there is one, otherwise the graphics family
 
 	bool isComplete() {
 		return graphicsFamily >= 0 && presentFamily >= 0;
@@ -285,6 +462,10 @@ struct PushConstantInfo {
 
 const std::string MODEL_PATH = "resources/models/chalet.obj";
 const std::string TEXTURE_PATH = "resources/textures/normal.png";
+const std::string VERTEX_SHADER_PATH = "resources/shaders/vert.spv";
+const std::string INDIRECT_VERTEX_SHADER_PATH = "resources/shaders/vert_indirect.spv";
+const std::string FRAGMENT_SHADER_PATH = "resources/shaders/frag.spv";
+const std::string CULL_SHADER_PATH = "resources/shaders/cull.spv";
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -317,22 +498,70 @@ public:
 
 	void setCameraPos(glm::vec3 cameraPos);
 
+	// the camera is drawn between the two positions by the interpolation alpha
+	void setCameraPos(glm::vec3 previousPos, glm::vec3 currentPos);
+
 	glm::vec3 getProperCameraVelocity(glm::vec3 cameraVel);
 
 	GLFWwindow* getWindowPointer();
 
 	void addRenderInstance(float x, float y, float z, int modelIndex);
 
+	size_t getRenderInstanceCount(int modelIndex);
+
+	// current transform of an instance, identity when it doesn't exist
+	glm::mat4 getRenderInstanceTransform(int modelIndex, size_t instanceIndex);
+
+	// the model's triangle mesh, null when it was loaded without one,
+	// a hot reload replaces it and the old one is freed a frame or more after the run that swapped it
+	const collisionDetection::TriangleMesh* getModelCollider(int modelIndex);
+
 	void addLight(glm::vec3 position, glm::vec3 color, float intensity);
 
 	glm::vec3 getCameraPos();
 
+	// unit vector the camera looks along, as of the last frame drawn
+	glm::vec3 getCameraDirection();
+
+	void setRenderInstanceTransform(int modelIndex, size_t instanceIndex, const glm::mat4& transform);
+
+	// the instance is drawn between the two transforms by the interpolation alpha until it is given a single transform,
+	// the matrices are blended element by element, which is exact for translation and scale
+	void setRenderInstanceTransform(int modelIndex, size_t instanceIndex, const glm::mat4& previous, const glm::mat4& current);
+
+	// how far between the previous and current simulation step to draw, from FixedTimestep::getAlpha
+	void setInterpolationAlpha(float alpha);
+
+	UploadStats getUploadStats();
+
+	// instances tested and drawn by the cpu culler in the last frame, all zero when culling runs on the gpu
+	frustumCulling::CullStats getCullStats();
+
+	meshletCulling::CullStats getMeshletCullStats();
+
+	// shared with the rest of the game so work outside rendering doesn't start a second set of threads
+	JobSystem& getJobSystem();
+
+	// loads a model on a loader thread and copies it to the gpu on the transfer queue while frames keep being drawn,
+	// returns the model index right away, its instances draw nothing until it has arrived
+	int streamModel(const ModelSource& source);
+
+	// reloads a texture that has a region in the atlas on a loader thread, the region shows the new pixels once it has arrived
+	void streamTexture(const std::string& textureName);
+
+	// models and textures asked for that haven't arrived or failed yet
+	uint32_t getPendingStreamCount();
+
 private:
 
 	std::vector<descriptorSetObject> descriptorSetObjects;
 
 	std::vector<PushConstantInfo> pushConstantInfos;
 
+	std::vector<descriptorSetObject> cullDescriptorSetObjects;
+
+	std::vector<PushConstantInfo> cullPushConstantInfos;
+
 	std::vector<Texture> textures;
 
 	int textureWidth, textureHeight;
@@ -343,6 +572,26 @@ private:
 
 	std::vector<size_t> renderInstanceIndexes;
 
+	// every instance transform, each model's in a block of its own, mirrors the transform storage buffer
+	std::vector<glm::mat4> instanceTransforms;
+
+	// index of each model's first instance in instanceTransforms
+	std::vector<uint32_t> modelInstanceOffsets;
+
+	// slots of each model's block, the ones past its instance count are free for the next instances added
+	std::vector<uint32_t> modelInstanceCapacities;
+
+	// keyed by model index in the upper 32 bits and instance index in the lower
+	std::unordered_map<uint64_t, InstanceMotion> instanceMotions;
+
+	float interpolationAlpha = 1.0f;
+
+	DirtyRanges transformDirtyRanges;
+
+	DirtyRanges lightDirtyRanges;
+
+	UploadStats uploadStats;
+
 	std::vector<std::vector<Sprite>> spriteInstances;
 
 	std::vector<size_t> spriteInstanceIndexes;
@@ -353,6 +602,32 @@ private:
 
 	const int MAX_RENDER_INSTANCES = 50000;
 
+	const int MAX_INDIRECT_DRAWS = 4096;
+
+	const int MAX_MATERIALS = 1024; // material ids are 16 bit, so at most 65536
+
+	const int MAX_MESHLETS = 65536;
+
+	// the vertex and index buffers are made this large so streamed models can be copied in after the ones loaded at start
+	const uint32_t MAX_VERTICES = 1 << 20;
+
+	const uint32_t MAX_INDICES = 1 << 22;
+
+	const uint32_t STREAMING_THREAD_COUNT = 2;
+
+	// each draw's lods and meshlets get room for all of its instances in the visible instance buffer,
+	// draws fall back to one command for the full model when their meshlets don't fit
+	const int MAX_VISIBLE_SLOTS = MAX_RENDER_INSTANCES * 8;
+
+	// simplified lods made for models loaded with generateLods, on top of the full model
+	static const uint32_t GENERATED_LODS = 4;
+
+	const int MAX_MODEL_LODS = 1 + GENERATED_LODS;
+
+	// pixels of error an instance's lod may show, a pixel is about where popping stops being noticeable
+	const float LOD_PIXEL_ERROR = 1.0f;
+
+
 	const int WIDTH = 1920;
 	const int HEIGHT = 1080;
 	const int MAX_FRAMES_IN_FLIGHT = 2;
@@ -361,6 +636,8 @@ private:
 
 	glm::vec3 cameraPosition;
 
+	glm::vec3 previousCameraPosition;
+
 	float FOV = 90;
 
 	glm::vec3 direction;
@@ -382,6 +659,13 @@ private:
 
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue transferQueue; // may be graphicsQueue itself when the device has neither a transfer family nor a second graphics queue
+
+	// queues are externally synchronised and loader threads submit too, held around every submit, present and wait idle
+	std::mutex queueMutex;
+
+	// the graphics and transfer families when they differ, buffers streamed into are shared between them so no ownership transfers are needed
+	std::vector<uint32_t> sharedQueueFamilies;
 
 	VkSwapchainKHR swapChain;
 	std::vector<VkImage> swapChainImages;
@@ -396,6 +680,7 @@ private:
 	VkPipeline graphicsPipeline;
 
 	VkCommandPool commandPool;
+	VkCommandPool drawCommandPool;
 
 	VkImage depthImage;
 	VkDeviceMemory depthImageMemory;
@@ -409,6 +694,8 @@ private:
 
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
+	std::vector<MaterialData> materialTable; // every loaded model's materials, identical ones shared
+	std::vector<meshletCulling::Meshlet> meshletTable; // every loaded model's meshlets, index ranges into indices
 	VkBuffer vertexBuffer;
 	VkDeviceMemory vertexBufferMemory;
 	VkBuffer indexBuffer;
@@ -416,6 +703,49 @@ private:
 
 	StorageBufferObject transformBuffer;
 	StorageBufferObject lightBuffer;
+	StorageBufferObject drawDataBuffer;
+	StorageBufferObject indirectBuffer;
+	StorageBufferObject indirectTemplateBuffer; // the indirect commands with no instances, copied over indirectBuffer before culling
+	StorageBufferObject visibleInstanceBuffer;  // transform index of each drawn instance, indexed by gl_InstanceIndex
+	StorageBufferObject materialBuffer;         // materialTable, written once after loading
+	StorageBufferObject meshletBuffer;          // meshletTable, written once after loading
+
+	// set when the device supports multi draw indirect and shader draw parameters and the indirect vertex shader is built
+	bool indirectDrawEnabled = false;
+
+	// instances are culled by a compute pass at the start of each frame, needs the indirect path and the cull shader
+	// otherwise they're culled on the cpu every frame, on either path
+	bool gpuCullingEnabled = false;
+
+	uint32_t indirectDrawCount = 0;
+
+	std::vector<ModelDraw> indirectDraws; // what the indirect commands were built from, the push constant path draws these too
+
+	std::vector<uint32_t> indirectFirstCommands; // of each of indirectDraws, see DrawData::firstCommand
+
+	std::vector<uint32_t> indirectMeshletCounts; // of each of indirectDraws, 0 when its full model is a single command
+
+	uint32_t visibleInstanceSlots = 0; // each command has room behind its firstInstance for every instance of its draw
+
+	std::vector<VkDrawIndexedIndirectCommand> indirectCommands;
+
+	std::vector<uint32_t> visibleInstances; // cpu culling output, same layout as visibleInstanceBuffer
+
+	frustumCulling::Frustum frustum; // of the camera in the current frame
+
+	glm::vec3 eyePosition; // of the camera in the current frame
+
+	float lodScale = 0.0f; // of the current frame, see meshSimplifier::selectLod
+
+	frustumCulling::CullStats cullStats;
+
+	meshletCulling::CullStats meshletCullStats; // of the full model draws, only counted when culling on the cpu
+
+	std::vector<uint32_t> visibleMeshlets; // cpu culling scratch, of one instance
+
+	UploadRing uploadRing;
+	std::vector<PendingUpload> pendingUploads;
+	std::vector<VkCommandBuffer> uploadCommandBuffers; // one per frame in flight
 
 	std::vector<VkBuffer> uniformBuffers;
 	std::vector<VkDeviceMemory> uniformBuffersMemory;
@@ -425,13 +755,50 @@ private:
 
 	std::vector<VkCommandBuffer> commandBuffers;
 
+	bool commandBuffersDirty = true;
+
+	JobSystem jobSystem;
+
+	std::vector<std::vector<WorkerCommandPool>> workerCommandPools; // [image][worker], only on the push constant path
+
+	std::vector<std::vector<VkCommandBuffer>> secondaryCommandBuffers; // [image][batch]
+
+	const uint32_t MIN_DRAWS_PER_BATCH = 64;
+
+	std::vector<std::thread> streamingThreads;
+	std::vector<VkCommandPool> streamingCommandPools; // one per loader thread, on the transfer family
+
+	std::mutex streamingMutex; // guards everything down to stopStreaming, and materialTable once the loader threads run
+	std::condition_variable streamingCondition;
+	std::deque<StreamRequest> streamRequests;
+	std::vector<StreamedModel> streamedModels;     // arrived, waiting for the render thread
+	std::vector<StreamedTexture> streamedTextures; // decoded, waiting for the render thread
+	std::vector<std::string> streamErrors;
+	RangeAllocator vertexRanges; // free parts of the shared buffers, loader threads take their ranges from these
+	RangeAllocator indexRanges;
+	RangeAllocator meshletRanges;
+	uint32_t uploadedMaterialCount = 0; // materialTable entries already in materialBuffer
+	uint32_t pendingStreamCount = 0;
+	bool stopStreaming = false;
+
+	std::vector<VkSemaphore> streamWaitSemaphores; // copies the next submission has to wait on
+	std::vector<StreamedTexture> textureCopies;    // recorded into the next upload commands
+	std::vector<FrameRetirements> frameRetirements; // per frame in flight
+
+	// resources/models, textures and shaders, changed files are reloaded while running
+	FileWatcher resourceWatcher;
+	std::vector<ModelSource> modelSources; // what each model was loaded from, for reloading it
+
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
 	std::vector<VkFence> inFlightFences;
+	std::vector<VkFence> imagesInFlight;
 	size_t currentFrame = 0;
 
 	std::vector<PipelineBundle> pipelineBundles;
 
+	std::vector<PipelineBundle> cullPipelineBundles; // empty unless gpu culling is enabled
+
 	bool framebufferResized = false;
 
 	std::vector<ImageInfo> atlasOffsets;
@@ -471,6 +838,8 @@ private:
 
 	void resetRenderInstances();
 
+	void applyInstanceMotions();
+
 	void addSpriteInstance(int textureId, glm::vec3 position, glm::vec2 size, glm::vec2 texOffset, glm::vec2 texSize, float rotation, float opacity);
 
 	void resetSpriteInstances();
@@ -546,21 +915,85 @@ private:
 
 	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 
-	void loadModel(std::string path, glm::vec4 colour, float scale);
+	// with buildCollider the model's triangles also go into a TriangleMesh that every instance shares
+	// the imported model is cooked to path + ".mesh" and mapped from there on later runs, until the obj, its materials or the parameters change
+	void loadModel(std::string path, glm::vec4 colour, float scale, bool buildCollider = false, bool generateLods = false);
+
+	// imports the models on the job system's workers, then adds them in the order given, so model indices and offsets
+	// don't depend on which finished first, must not be called from inside a job
+	void loadModels(const std::vector<ModelSource>& sources);
+
+	// maps the model's cooked file, or imports the obj and cooks it, touches nothing shared so models can be imported at the same time
+	static void importModel(const ModelSource& source, ImportedModel& imported);
+
+	// parses an obj and welds its identical vertices, indices count from the model's first vertex
+	static void importObj(const std::string& path, glm::vec4 colour, float scale, std::vector<Vertex>& modelVertices, std::vector<uint32_t>& modelIndices,
+		std::vector<MaterialData>& modelMaterials, std::string& textureName, std::string& normalMapName);
+
+	// adds the materials that aren't in materialTable yet and returns where each of them is
+	std::vector<uint16_t> addMaterials(const MaterialData* modelMaterials, uint32_t materialCount);
+
+	// the Model of vertices and indices already placed at vertexOffset and at lods' offsets from indexOffset, reads nothing the render thread changes
+	Model createModel(const Vertex* modelVertices, uint32_t vertexCount, const uint32_t* modelIndices, uint32_t vertexOffset, uint32_t indexOffset,
+		const meshCache::LodRange* lods, uint32_t lodCount, uint32_t indexCount, uint32_t firstMeshlet, uint32_t meshletCount,
+		const std::string& textureName, const std::string& normalMapName, bool buildCollider);
+
+	// appends a model's vertices, indices, materials and meshlets to the shared arrays and adds its Model
+	void addModel(const Vertex* modelVertices, uint32_t vertexCount, const uint32_t* modelIndices, uint32_t indexCount,
+		const meshCache::LodRange* lods, uint32_t lodCount, const meshletCulling::Meshlet* modelMeshlets, uint32_t meshletCount, const MaterialData* modelMaterials, uint32_t materialCount, const std::string& textureName, const std::string& normalMapName, bool buildCollider);
+
+	void startStreaming();
+
+	void stopStreamingThreads();
+
+	// runs on each loader thread until stopStreamingThreads
+	void streamingLoop(uint32_t loaderIndex);
+
+	void streamModelOnLoader(const StreamRequest& request, uint32_t loaderIndex);
+
+	void streamTextureOnLoader(const StreamRequest& request);
+
+	// puts models and textures that arrived since the last frame in place, on the render thread before the frame's uploads are recorded
+	void commitStreamedAssets();
+
+	void destroyFrameRetirements(FrameRetirements& retirements);
+
+	// reloads whatever the resource watcher saw change, models and textures are streamed, shaders rebuild their pipeline
+	void pollResourceChanges();
+
+	// the draw or cull pipeline again from its .spv files, the old one stays if the new one can't be made
+	void reloadShaders(bool graphics, bool cull);
 
 	void createVertexBuffer();
 
 	void createIndexBuffer();
 
 	void clearStorageBuffer(StorageBufferObject& storageBuffer);
-	StorageBufferObject createStorageBuffer(std::string name, VkDeviceSize size);
+	// data, when given, is copied to the start of the buffer
+	StorageBufferObject createStorageBuffer(std::string name, VkDeviceSize size, VkBufferUsageFlags extraUsage = 0, const void* data = nullptr, VkDeviceSize dataSize = 0, bool shared = false);
+
+	void createUploadRing(VkDeviceSize regionSize);
+
+	void destroyUploadRing();
+
+	void createUploadCommandBuffers();
+
+	void beginUploadFrame(size_t frameIndex);
+
+	void stageUpload(const StorageBufferObject& storageBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
 
-	template<typename T>
-    void updateStorageBuffer(StorageBufferObject storageBuffer, const std::vector<T>& data);
+	void recordUploadCommands(VkCommandBuffer commandBuffer);
+
+	VkDeviceSize stageDirtyRanges(const StorageBufferObject& storageBuffer, DirtyRanges& dirtyRanges, const void* data, VkDeviceSize elementSize, size_t elementCount);
+
+	void stageIndirectDraws(const std::vector<ModelDraw>& draws);
+
+	void cullInstancesOnCpu();
 
 	void createUniformBuffers();
 
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	// shared buffers can be written on the transfer queue and read on the graphics queue
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory, bool shared = false);
 
 	VkCommandBuffer beginSingleTimeCommands();
 
@@ -572,6 +1005,28 @@ private:
 
 	void createCommandBuffers();
 
+	void recordCommandBuffers();
+
+	void recordCommandBuffer(size_t imageIndex);
+
+	std::vector<ModelDraw> buildModelDraws();
+
+	// makes room for another instance at the end of a full model's block
+	void growInstanceBlock(int modelIndex);
+
+	// puts every model's block straight after the one before, lastModel's at the end
+	void packInstanceBlocks(int lastModel);
+
+	VkCommandBuffer acquireSecondaryCommandBuffer(size_t imageIndex, uint32_t workerIndex);
+
+	void bindSceneResources(VkCommandBuffer commandBuffer, size_t imageIndex);
+
+	void recordDrawBatch(VkCommandBuffer commandBuffer, size_t imageIndex, size_t first, size_t end);
+
+	void recordIndirectDraw(VkCommandBuffer commandBuffer, size_t imageIndex);
+
+	void recordCullPass(VkCommandBuffer commandBuffer, size_t imageIndex);
+
 	void createSyncObjects();
 
 	void updateUniformBuffer(uint32_t currentImage);
@@ -600,24 +1055,37 @@ private:
 
 	static std::vector<char> readFile(const std::string& filename);
 
+	static bool fileExists(const std::string& filename);
+
 	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t obj, size_t location, int32_t code, const char* layerPrefix, const char* msg, void* userData);
 
 	VkPipeline createGraphicsPipeline(const std::string& vertShaderPath, const std::string& fragShaderPath,
 		VkDescriptorSetLayout descriptorSetLayout, VkExtent2D swapChainExtent,
 		VkRenderPass renderPass, VkPipelineLayout& pipelineLayout, std::vector<PushConstantInfo> &pushConstantInfos);
 
+	VkPipeline createComputePipeline(const std::string& compShaderPath, VkDescriptorSetLayout descriptorSetLayout,
+		VkPipelineLayout& pipelineLayout, std::vector<PushConstantInfo>& pushConstantInfos);
+
 	VkDescriptorSetLayout createDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
 	
 	std::vector<VkDescriptorSet> createDescriptorSets(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t count);
 
 	void updateDescriptorSet(const PipelineBundle& bundle, int index);
 
-	PipelineBundle createCurrentPipelineBundle(std::vector<descriptorSetObject> descriptorSetObjects, VkExtent2D swapChainExtent, VkRenderPass renderPass, uint32_t swapChainImageCount, std::vector<PushConstantInfo> &pushConstantInfos);
+	void buildDescriptorBindings(std::vector<descriptorSetObject>& descriptorSetObjects, std::vector<VkDescriptorSetLayoutBinding>& bindings, std::vector<DescriptorInfo>& descriptorInfos);
+
+	PipelineBundle createCurrentPipelineBundle(std::vector<descriptorSetObject> descriptorSetObjects, VkExtent2D swapChainExtent, VkRenderPass renderPass, uint32_t swapChainImageCount, std::vector<PushConstantInfo> &pushConstantInfos, const std::string& vertShaderPath);
+
+	PipelineBundle createCullPipelineBundle(std::vector<descriptorSetObject> descriptorSetObjects, uint32_t swapChainImageCount, std::vector<PushConstantInfo>& pushConstantInfos);
+
+	void destroyPipelineBundle(PipelineBundle& bundle);
 
 	VkDescriptorPool createDescriptorPool(const std::vector<VkDescriptorPoolSize>& poolSizes, uint32_t maxSets);
 
 	void updateDescriptorResource(PipelineBundle& bundle, std::string name, descriptorResource& resource);
 
+	void bindDescriptorResources(PipelineBundle& bundle);
+
 	void createTextureAtlasArray(std::vector<std::string> texturePaths);
 
 };
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "JobSystem.h"
+
+JobSystem::~JobSystem() {
+	shutdown();
+}
+
+void JobSystem::init(uint32_t workerThreadCount) {
+	if (!threads.empty()) {
+		return;
+	}
+	if (workerThreadCount == 0) {
+		uint32_t cores = std::thread::hardware_concurrency();
+		workerThreadCount = cores > 1 ? cores - 1 : 0;
+	}
+
+	stopping = false;
+	for (uint32_t i = 0; i < workerThreadCount; i++) {
+		threads.emplace_back(&JobSystem::workerLoop, this, i + 1);
+	}
+}
+
+void JobSystem::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+uint32_t JobSystem::getWorkerCount() const {
+	return static_cast<uint32_t>(threads.size()) + 1;
+}
+
+void JobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t index, uint32_t workerIndex)>& job) {
+	if (count == 0) {
+		return;
+	}
+	if (threads.empty() || count == 1) {
+		for (uint32_t i = 0; i < count; i++) {
+			job(i, 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentJob = &job;
+		jobCount = count;
+		nextIndex = 0;
+		finishedCount = 0;
+		firstException = nullptr;
+		generation++;
+		activeWorkers++;
+	}
+	wakeCondition.notify_all();
+
+	runJobs(0);
+
+	std::exception_ptr exception;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		activeWorkers--;
+		// wait for the workers to leave runJobs too, so none of them can pick up an index from the next batch
+		doneCondition.wait(lock, [this] { return finishedCount == jobCount && activeWorkers == 0; });
+		currentJob = nullptr;
+		exception = firstException;
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex) {
+	uint64_t seenGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+			if (stopping) {
+				return;
+			}
+			seenGeneration = generation;
+			if (currentJob == nullptr) {
+				continue;
+			}
+			activeWorkers++;
+		}
+
+		runJobs(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeWorkers--;
+		}
+		doneCondition.notify_all();
+	}
+}
+
+void JobSystem::runJobs(uint32_t workerIndex) {
+	while (true) {
+		uint32_t index = nextIndex.fetch_add(1);
+		if (index >= jobCount) {
+			return;
+		}
+
+		try {
+			(*currentJob)(index, workerIndex);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!firstException) {
+				firstException = std::current_exception();
+			}
+		}
+
+		bool lastJob;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finishedCount++;
+			lastJob = finishedCount == jobCount;
+		}
+		if (lastJob) {
+			doneCondition.notify_all();
+		}
+	}
+}
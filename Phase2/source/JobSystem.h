@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed pool of worker threads that run batches of indexed jobs
+// the thread calling parallelFor works on the batch too, as worker 0
+class JobSystem {
+public:
+	~JobSystem();
+
+	// workerThreadCount is the number of extra threads, 0 picks one less than the number of cores
+	void init(uint32_t workerThreadCount = 0);
+
+	void shutdown();
+
+	// threads that can run jobs, including the calling thread, worker indices are below this
+	uint32_t getWorkerCount() const;
+
+	// runs job(index, workerIndex) for every index in [0, count) and returns once they have all finished
+	// the first exception thrown by a job is rethrown here, must not be called from inside a job
+	void parallelFor(uint32_t count, const std::function<void(uint32_t index, uint32_t workerIndex)>& job);
+
+private:
+	void workerLoop(uint32_t workerIndex);
+
+	void runJobs(uint32_t workerIndex);
+
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	const std::function<void(uint32_t, uint32_t)>* currentJob = nullptr;
+	uint32_t jobCount = 0;
+	std::atomic<uint32_t> nextIndex{ 0 };
+	uint32_t finishedCount = 0;
+	uint32_t activeWorkers = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+	std::exception_ptr firstException;
+};
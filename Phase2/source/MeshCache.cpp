@@ -0,0 +1,270 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace meshCache {
+	namespace {
+		const uint32_t MAGIC = 0x4853454d; // "MESH"
+
+		bool readFile(const std::string& path, std::vector<char>& contents) {
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open()) {
+				return false;
+			}
+			contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			return true;
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	bool MappedFile::open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(handle);
+			return false;
+		}
+		HANDLE fileMapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (fileMapping == nullptr) {
+			CloseHandle(handle);
+			return false;
+		}
+		const void* view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr) {
+			CloseHandle(fileMapping);
+			CloseHandle(handle);
+			return false;
+		}
+		file = handle;
+		mapping = fileMapping;
+		mapped = static_cast<const char*>(view);
+		length = static_cast<size_t>(fileSize.QuadPart);
+#else
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			return false;
+		}
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+			::close(descriptor);
+			return false;
+		}
+		void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+		// the mapping keeps the file's pages, the descriptor isn't needed past here
+		::close(descriptor);
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		mapped = static_cast<const char*>(view);
+		length = static_cast<size_t>(status.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (mapped == nullptr) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(mapped);
+		CloseHandle(mapping);
+		CloseHandle(file);
+		mapping = nullptr;
+		file = nullptr;
+#else
+		munmap(const_cast<char*>(mapped), length);
+#endif
+		mapped = nullptr;
+		length = 0;
+	}
+
+	const char* MappedFile::data() const {
+		return mapped;
+	}
+
+	size_t MappedFile::size() const {
+		return length;
+	}
+
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool hashSource(const std::string& path, uint64_t& hash) {
+		std::vector<char> contents;
+		if (!readFile(path, contents)) {
+			return false;
+		}
+		hash = hashBytes(contents.data(), contents.size());
+
+		// texture names come from the material libraries, so an edit to one has to be noticed too
+		std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+		std::istringstream lines(std::string(contents.begin(), contents.end()));
+		std::string line;
+		while (std::getline(lines, line)) {
+			if (line.compare(0, 7, "mtllib ") != 0) {
+				continue;
+			}
+			std::string library = line.substr(7);
+			library.erase(library.find_last_not_of(" \t\r") + 1);
+			hash = hashBytes(library.data(), library.size(), hash);
+			std::vector<char> material;
+			if (readFile(directory + library, material)) {
+				hash = hashBytes(material.data(), material.size(), hash);
+			}
+		}
+		return true;
+	}
+
+	bool CookedMesh::open(const std::string& path, uint64_t sourceHash, uint32_t vertexSize, uint32_t materialSize, uint32_t meshletSize) {
+		header = nullptr;
+		if (!file.open(path) || file.size() < sizeof(Header)) {
+			return false;
+		}
+
+		const Header* candidate = reinterpret_cast<const Header*>(file.data());
+		if (candidate->magic != MAGIC || candidate->version != FORMAT_VERSION || candidate->sourceHash != sourceHash || candidate->vertexSize != vertexSize
+			|| candidate->materialSize != materialSize || candidate->meshletSize != meshletSize) {
+			file.close();
+			return false;
+		}
+		uint64_t expected = sizeof(Header) + static_cast<uint64_t>(candidate->vertexSize) * candidate->vertexCount + sizeof(uint32_t) * static_cast<uint64_t>(candidate->indexCount)
+			+ static_cast<uint64_t>(candidate->materialSize) * candidate->materialCount + sizeof(LodRange) * static_cast<uint64_t>(candidate->lodCount)
+			+ static_cast<uint64_t>(candidate->meshletSize) * candidate->meshletCount + candidate->textureNameLength + candidate->normalMapNameLength;
+		if (expected != file.size()) {
+			file.close();
+			return false;
+		}
+		header = candidate;
+		return true;
+	}
+
+	const void* CookedMesh::getVertices() const {
+		return file.data() + sizeof(Header);
+	}
+
+	uint32_t CookedMesh::getVertexCount() const {
+		return header->vertexCount;
+	}
+
+	const uint32_t* CookedMesh::getIndices() const {
+		return reinterpret_cast<const uint32_t*>(file.data() + sizeof(Header) + static_cast<size_t>(header->vertexSize) * header->vertexCount);
+	}
+
+	uint32_t CookedMesh::getIndexCount() const {
+		return header->indexCount;
+	}
+
+	const void* CookedMesh::getMaterials() const {
+		return getIndices() + header->indexCount;
+	}
+
+	uint32_t CookedMesh::getMaterialCount() const {
+		return header->materialCount;
+	}
+
+	const LodRange* CookedMesh::getLods() const {
+		return reinterpret_cast<const LodRange*>(static_cast<const char*>(getMaterials()) + static_cast<size_t>(header->materialSize) * header->materialCount);
+	}
+
+	uint32_t CookedMesh::getLodCount() const {
+		return header->lodCount;
+	}
+
+	const void* CookedMesh::getMeshlets() const {
+		return getLods() + header->lodCount;
+	}
+
+	uint32_t CookedMesh::getMeshletCount() const {
+		return header->meshletCount;
+	}
+
+	std::string CookedMesh::getTextureName() const {
+		const char* names = static_cast<const char*>(getMeshlets()) + static_cast<size_t>(header->meshletSize) * header->meshletCount;
+		return std::string(names, header->textureNameLength);
+	}
+
+	std::string CookedMesh::getNormalMapName() const {
+		const char* names = static_cast<const char*>(getMeshlets()) + static_cast<size_t>(header->meshletSize) * header->meshletCount;
+		return std::string(names + header->textureNameLength, header->normalMapNameLength);
+	}
+
+	bool write(const std::string& path, uint64_t sourceHash, const void* vertices, uint32_t vertexSize, uint32_t vertexCount,
+		const uint32_t* indices, uint32_t indexCount, const void* materials, uint32_t materialSize, uint32_t materialCount,
+		const LodRange* lods, uint32_t lodCount, const void* meshlets, uint32_t meshletSize, uint32_t meshletCount, const std::string& textureName, const std::string& normalMapName) {
+		Header header = {};
+		header.magic = MAGIC;
+		header.version = FORMAT_VERSION;
+		header.sourceHash = sourceHash;
+		header.vertexSize = vertexSize;
+		header.vertexCount = vertexCount;
+		header.indexCount = indexCount;
+		header.textureNameLength = static_cast<uint32_t>(textureName.size());
+		header.normalMapNameLength = static_cast<uint32_t>(normalMapName.size());
+		header.materialSize = materialSize;
+		header.materialCount = materialCount;
+		header.lodCount = lodCount;
+		header.meshletSize = meshletSize;
+		header.meshletCount = meshletCount;
+
+		std::string temporary = path + ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(static_cast<const char*>(vertices), static_cast<std::streamsize>(vertexSize) * vertexCount);
+			file.write(reinterpret_cast<const char*>(indices), static_cast<std::streamsize>(sizeof(uint32_t)) * indexCount);
+			file.write(static_cast<const char*>(materials), static_cast<std::streamsize>(materialSize) * materialCount);
+			file.write(reinterpret_cast<const char*>(lods), static_cast<std::streamsize>(sizeof(LodRange)) * lodCount);
+			file.write(static_cast<const char*>(meshlets), static_cast<std::streamsize>(meshletSize) * meshletCount);
+			file.write(textureName.data(), textureName.size());
+			file.write(normalMapName.data(), normalMapName.size());
+			if (!file) {
+				file.close();
+				std::remove(temporary.c_str());
+				return false;
+			}
+		}
+
+#ifdef _WIN32
+		bool renamed = MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		bool renamed = std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+		if (!renamed) {
+			std::remove(temporary.c_str());
+		}
+		return renamed;
+	}
+}
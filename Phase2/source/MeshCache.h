@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// cooked binary copies of imported models, written the first time a model is imported and memory mapped afterwards
+// vertices, materials and meshlets are stored as raw bytes so this has no dependency on the renderer's layouts, the caller checks the sizes match
+namespace meshCache {
+	// bump when the layout below or the importer's output changes, older files are then imported again
+	const uint32_t FORMAT_VERSION = 7;
+
+	// a read only view of a whole file, empty when the file couldn't be opened
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& path);
+
+		void close();
+
+		const char* data() const;
+
+		size_t size() const;
+
+	private:
+		const char* mapped = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#endif
+	};
+
+	// 64 bit fnv-1a
+	uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+	// hash of the source file and every material library it names, returns false when the file can't be read
+	bool hashSource(const std::string& path, uint64_t& hash);
+
+	// where one level of detail's triangles are in the indices
+	struct LodRange {
+		uint32_t first;
+		uint32_t count;
+		float error; // model space distance the lod's surface is off by
+		uint32_t padding;
+	};
+
+	// fixed size start of a cooked file, vertices follow it, then indices, then materials, then lod ranges, then meshlets, then the texture names
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t vertexSize;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t textureNameLength;
+		uint32_t normalMapNameLength;
+		uint32_t materialSize;
+		uint32_t materialCount;
+		uint32_t lodCount;
+		uint32_t meshletSize;
+		uint32_t meshletCount;
+		uint32_t padding[2]; // keeps the vertices 64 byte aligned in the mapping
+	};
+
+	// a cooked file mapped into memory, the pointers stay valid while it is alive
+	class CookedMesh {
+	public:
+		// false when there is no cooked file, it was cooked from a different source or by another version, or it is truncated
+		bool open(const std::string& path, uint64_t sourceHash, uint32_t vertexSize, uint32_t materialSize, uint32_t meshletSize);
+
+		const void* getVertices() const;
+
+		uint32_t getVertexCount() const;
+
+		// relative to the model's first vertex
+		const uint32_t* getIndices() const;
+
+		uint32_t getIndexCount() const;
+
+		// the vertices' material ids index into these
+		const void* getMaterials() const;
+
+		uint32_t getMaterialCount() const;
+
+		// the full model first, then coarser ones
+		const LodRange* getLods() const;
+
+		uint32_t getLodCount() const;
+
+		// of the full model, their index ranges are relative to the indices like the lods'
+		const void* getMeshlets() const;
+
+		uint32_t getMeshletCount() const;
+
+		std::string getTextureName() const;
+
+		std::string getNormalMapName() const;
+
+	private:
+		MappedFile file;
+		const Header* header = nullptr;
+	};
+
+	// writes to a temporary file and renames it over path, so a crash part way never leaves a truncated cooked file behind
+	bool write(const std::string& path, uint64_t sourceHash, const void* vertices, uint32_t vertexSize, uint32_t vertexCount,
+		const uint32_t* indices, uint32_t indexCount, const void* materials, uint32_t materialSize, uint32_t materialCount,
+		const LodRange* lods, uint32_t lodCount, const void* meshlets, uint32_t meshletSize, uint32_t meshletCount, const std::string& textureName, const std::string& normalMapName);
+}
@@ -0,0 +1,273 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace meshOptimizer {
+	namespace {
+		const uint32_t UNUSED = 0xffffffff;
+
+		// fifo cache simulated with time stamps, a vertex is in the cache if fewer than cacheSize misses happened since it was loaded
+		struct CacheSimulation {
+			std::vector<uint32_t> stamps;
+			uint32_t time;
+			uint32_t cacheSize;
+
+			CacheSimulation(size_t vertexCount, uint32_t cacheSize) : stamps(vertexCount, 0), time(cacheSize + 1), cacheSize(cacheSize) {
+			}
+
+			bool isCached(uint32_t vertex) const {
+				return time - stamps[vertex] <= cacheSize;
+			}
+
+			// returns true on a miss
+			bool use(uint32_t vertex) {
+				if (isCached(vertex)) {
+					return false;
+				}
+				stamps[vertex] = time++;
+				return true;
+			}
+
+			void flush() {
+				time += cacheSize + 1;
+			}
+		};
+
+		glm::vec3 getPosition(const glm::vec3* positions, size_t stride, uint32_t vertex) {
+			return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+		}
+	}
+
+	VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+		VertexCacheStats stats;
+		if (indexCount < 3) {
+			return stats;
+		}
+
+		CacheSimulation cache(vertexCount, cacheSize);
+		std::vector<bool> used(vertexCount, false);
+		size_t misses = 0;
+		size_t usedCount = 0;
+		for (size_t i = 0; i < indexCount; i++) {
+			misses += cache.use(indices[i]) ? 1 : 0;
+			if (!used[indices[i]]) {
+				used[indices[i]] = true;
+				usedCount++;
+			}
+		}
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+		stats.atvr = static_cast<float>(misses) / static_cast<float>(usedCount);
+		return stats;
+	}
+
+	void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* hardBoundaries, uint32_t cacheSize) {
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0) {
+			return;
+		}
+
+		// triangles around each vertex, and how many of them haven't been output yet
+		std::vector<uint32_t> live(vertexCount, 0);
+		for (size_t i = 0; i < triangleCount * 3; i++) {
+			live[indices[i]]++;
+		}
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++) {
+			offsets[v + 1] = offsets[v] + live[v];
+		}
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		CacheSimulation cache(vertexCount, cacheSize);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(triangleCount * 3);
+		size_t cursor = 0;
+
+		// a recently used vertex with triangles left if there is one, otherwise the next one in order that has any
+		auto skipDeadEnd = [&]() -> uint32_t {
+			while (!deadEnds.empty()) {
+				uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (live[vertex] > 0) {
+					return vertex;
+				}
+			}
+			while (cursor < vertexCount) {
+				if (live[cursor] > 0) {
+					return static_cast<uint32_t>(cursor);
+				}
+				cursor++;
+			}
+			return UNUSED;
+		};
+
+		uint32_t fanning = skipDeadEnd();
+		while (fanning != UNUSED) {
+			if (hardBoundaries && !cache.isCached(fanning)) {
+				hardBoundaries->push_back(static_cast<uint32_t>(output.size() / 3));
+			}
+
+			candidates.clear();
+			for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+				uint32_t triangle = adjacency[a];
+				if (emitted[triangle]) {
+					continue;
+				}
+				for (int k = 0; k < 3; k++) {
+					uint32_t vertex = indices[triangle * 3 + k];
+					output.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					live[vertex]--;
+					cache.use(vertex);
+				}
+				emitted[triangle] = true;
+			}
+
+			// the candidate that will still be in the cache once its remaining triangles are out, and has been in it longest
+			uint32_t next = UNUSED;
+			int bestPriority = -1;
+			for (uint32_t vertex : candidates) {
+				if (live[vertex] == 0) {
+					continue;
+				}
+				int priority = 0;
+				int age = static_cast<int>(cache.time - cache.stamps[vertex]);
+				if (age + 2 * static_cast<int>(live[vertex]) <= static_cast<int>(cacheSize)) {
+					priority = age;
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+			fanning = next != UNUSED ? next : skipDeadEnd();
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	void optimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t stride, size_t vertexCount, float threshold, uint32_t cacheSize) {
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0) {
+			return;
+		}
+
+		std::vector<uint32_t> hardBoundaries;
+		optimizeVertexCache(indices, indexCount, vertexCount, &hardBoundaries, cacheSize);
+		hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+		// a hard cluster is cut wherever the part so far is already within threshold of the whole cluster's acmr,
+		// each cut costs a cache flush, so the part after it is checked from an empty cache
+		std::vector<uint32_t> clusters;
+		CacheSimulation cache(vertexCount, cacheSize);
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+			uint32_t first = hardBoundaries[h];
+			uint32_t end = hardBoundaries[h + 1];
+			if (first == end) {
+				continue;
+			}
+
+			cache.flush();
+			size_t clusterMisses = 0;
+			for (size_t i = first * 3; i < end * 3; i++) {
+				clusterMisses += cache.use(indices[i]) ? 1 : 0;
+			}
+			float target = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - first);
+
+			cache.flush();
+			clusters.push_back(first);
+			uint32_t start = first;
+			size_t misses = 0;
+			for (uint32_t triangle = first; triangle < end; triangle++) {
+				for (int k = 0; k < 3; k++) {
+					misses += cache.use(indices[triangle * 3 + k]) ? 1 : 0;
+				}
+				if (triangle + 1 < end && static_cast<float>(misses) / static_cast<float>(triangle + 1 - start) <= target) {
+					clusters.push_back(triangle + 1);
+					start = triangle + 1;
+					misses = 0;
+					cache.flush();
+				}
+			}
+		}
+		clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+		// clusters whose faces point away from the middle are drawn first, they are the outside of the mesh that hides the inside
+		glm::vec3 meshCentre(0.0f);
+		float meshArea = 0.0f;
+		std::vector<glm::vec3> clusterCentres(clusters.size() - 1, glm::vec3(0.0f));
+		std::vector<glm::vec3> clusterNormals(clusters.size() - 1, glm::vec3(0.0f));
+		std::vector<float> clusterAreas(clusters.size() - 1, 0.0f);
+		for (size_t c = 0; c + 1 < clusters.size(); c++) {
+			for (uint32_t triangle = clusters[c]; triangle < clusters[c + 1]; triangle++) {
+				glm::vec3 a = getPosition(positions, stride, indices[triangle * 3 + 0]);
+				glm::vec3 b = getPosition(positions, stride, indices[triangle * 3 + 1]);
+				glm::vec3 d = getPosition(positions, stride, indices[triangle * 3 + 2]);
+				glm::vec3 normal = glm::cross(b - a, d - a); // length is twice the area
+				float area = glm::length(normal);
+				glm::vec3 centre = (a + b + d) * (1.0f / 3.0f);
+				clusterCentres[c] += centre * area;
+				clusterNormals[c] += normal;
+				clusterAreas[c] += area;
+				meshCentre += centre * area;
+				meshArea += area;
+			}
+		}
+		if (meshArea > 0.0f) {
+			meshCentre = meshCentre / meshArea;
+		}
+
+		std::vector<float> facing(clusters.size() - 1, 0.0f);
+		for (size_t c = 0; c < facing.size(); c++) {
+			float normalLength = glm::length(clusterNormals[c]);
+			if (clusterAreas[c] > 0.0f && normalLength > 0.0f) {
+				facing[c] = glm::dot(clusterCentres[c] / clusterAreas[c] - meshCentre, clusterNormals[c] / normalLength);
+			}
+		}
+		std::vector<uint32_t> order(facing.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return facing[a] > facing[b];
+		});
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(triangleCount * 3);
+		for (uint32_t c : order) {
+			sorted.insert(sorted.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+		}
+		std::copy(sorted.begin(), sorted.end(), indices);
+	}
+
+	size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, uint32_t* indices, size_t indexCount) {
+		std::vector<uint32_t> remap(vertexCount, UNUSED);
+		uint32_t next = 0;
+		for (size_t i = 0; i < indexCount; i++) {
+			uint32_t& target = remap[indices[i]];
+			if (target == UNUSED) {
+				target = next++;
+			}
+			indices[i] = target;
+		}
+
+		std::vector<char> reordered(static_cast<size_t>(next) * vertexSize);
+		const char* source = static_cast<const char*>(vertices);
+		for (size_t v = 0; v < vertexCount; v++) {
+			if (remap[v] != UNUSED) {
+				std::memcpy(&reordered[remap[v] * vertexSize], source + v * vertexSize, vertexSize);
+			}
+		}
+		if (!reordered.empty()) {
+			std::memcpy(vertices, reordered.data(), reordered.size());
+		}
+		return next;
+	}
+}
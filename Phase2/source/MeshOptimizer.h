@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// reorders a model's triangles and vertices at load time so the gpu transforms fewer vertices and shades fewer hidden pixels,
+// the triangles drawn stay the same, only their order and the order of the vertices change
+namespace meshOptimizer {
+	// entries in the post transform cache the orderings aim at, and that the statistics simulate, as a fifo
+	const uint32_t CACHE_SIZE = 16;
+
+	struct VertexCacheStats {
+		float acmr = 0.0f; // vertices transformed per triangle, 0.5 is the best a large regular grid can do, 3 the worst
+		float atvr = 0.0f; // vertices transformed per vertex in the mesh, 1 is the best possible
+	};
+
+	VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+	// tipsify, a triangle order that fans around vertices still in the cache, when hardBoundaries is given it receives the first triangle
+	// of every run that started from a vertex out of the cache, the order can be cut there without costing any cache hits
+	void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* hardBoundaries = nullptr, uint32_t cacheSize = CACHE_SIZE);
+
+	// orders the triangles for the vertex cache, then splits the order into clusters wherever the cache gets little worse for it
+	// and draws the clusters that face away from the middle of the mesh first, as those are the ones that hide the rest,
+	// threshold is how much worse than the plain cache order the acmr of each cluster is allowed to get
+	void optimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t stride, size_t vertexCount, float threshold = 1.05f, uint32_t cacheSize = CACHE_SIZE);
+
+	// moves the vertices into the order the indices first use them and rewrites the indices to match,
+	// vertices no index uses are dropped, returns how many are left at the front of vertices
+	size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, uint32_t* indices, size_t indexCount);
+}
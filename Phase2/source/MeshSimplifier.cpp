@@ -0,0 +1,348 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace meshSimplifier {
+	namespace {
+		const uint32_t NONE = 0xffffffff;
+
+		// how much more moving a vertex off an open edge or an attribute seam costs than moving it off a face
+		const double BORDER_WEIGHT = 10.0;
+
+		// sum of squared distances to a set of planes, as the symmetric matrix A, the vector b and the constant c
+		// of x'Ax + 2b'x + c, weight is the face area the planes came from
+		struct Quadric {
+			double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double weight = 0;
+
+			void addPlane(glm::vec3 normal, float distance, double planeWeight) {
+				double x = normal.x, y = normal.y, z = normal.z, d = distance;
+				a00 += planeWeight * x * x; a01 += planeWeight * x * y; a02 += planeWeight * x * z;
+				a11 += planeWeight * y * y; a12 += planeWeight * y * z; a22 += planeWeight * z * z;
+				b0 += planeWeight * x * d; b1 += planeWeight * y * d; b2 += planeWeight * z * d;
+				c += planeWeight * d * d;
+			}
+
+			void add(const Quadric& other) {
+				a00 += other.a00; a01 += other.a01; a02 += other.a02;
+				a11 += other.a11; a12 += other.a12; a22 += other.a22;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				weight += other.weight;
+			}
+
+			double evaluate(glm::vec3 point) const {
+				double x = point.x, y = point.y, z = point.z;
+				double result = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+					+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+				return std::max(result, 0.0);
+			}
+		};
+
+		struct Collapse {
+			double cost;
+			uint32_t from; // positions, from moves onto to
+			uint32_t to;
+		};
+
+		glm::vec3 getPosition(const glm::vec3* positions, size_t stride, uint32_t vertex) {
+			return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+		}
+
+		// positions of a triangle's corners, with every corner on from moved to the point given
+		bool flips(const glm::vec3 corners[3], int moved, glm::vec3 point) {
+			glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			glm::vec3 after[3] = { corners[0], corners[1], corners[2] };
+			after[moved] = point;
+			glm::vec3 normal = glm::cross(after[1] - after[0], after[2] - after[0]);
+			return glm::dot(before, normal) <= 0.0f;
+		}
+	}
+
+	std::vector<Lod> buildLodChain(const uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t stride, size_t vertexCount,
+		uint32_t lodCount, float reduction) {
+		std::vector<Lod> chain;
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0 || lodCount == 0) {
+			return chain;
+		}
+
+		// vertices split along uv or normal seams share a position, collapses work on positions so seams move as one
+		std::vector<uint32_t> byPosition(vertexCount);
+		std::iota(byPosition.begin(), byPosition.end(), 0);
+		std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) {
+			glm::vec3 p = getPosition(positions, stride, a);
+			glm::vec3 q = getPosition(positions, stride, b);
+			return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+		});
+		std::vector<uint32_t> positionOf(vertexCount);
+		std::vector<glm::vec3> points;
+		for (size_t i = 0; i < vertexCount; i++) {
+			glm::vec3 point = getPosition(positions, stride, byPosition[i]);
+			if (points.empty() || !(points.back() == point)) {
+				points.push_back(point);
+			}
+			positionOf[byPosition[i]] = static_cast<uint32_t>(points.size() - 1);
+		}
+		size_t pointCount = points.size();
+
+		// every face's plane, weighted by its area, goes to its corners
+		std::vector<Quadric> quadrics(pointCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			glm::vec3 corners[3];
+			for (int k = 0; k < 3; k++) {
+				corners[k] = points[positionOf[indices[t * 3 + k]]];
+			}
+			glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			float doubleArea = glm::length(normal);
+			if (doubleArea == 0.0f) {
+				continue;
+			}
+			normal = normal / doubleArea;
+			for (int k = 0; k < 3; k++) {
+				Quadric& quadric = quadrics[positionOf[indices[t * 3 + k]]];
+				quadric.addPlane(normal, -glm::dot(normal, corners[0]), doubleArea * 0.5);
+				quadric.weight += doubleArea * 0.5;
+			}
+		}
+
+		// an edge only one triangle uses is an open edge or a seam, a plane through it at right angles to the face keeps it in place
+		std::vector<std::pair<uint64_t, uint32_t>> edges; // vertex pair, triangle
+		edges.reserve(triangleCount * 3);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (int k = 0; k < 3; k++) {
+				uint32_t a = indices[t * 3 + k];
+				uint32_t b = indices[t * 3 + (k + 1) % 3];
+				edges.emplace_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b), static_cast<uint32_t>(t));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size(); i++) {
+			bool shared = (i > 0 && edges[i - 1].first == edges[i].first) || (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+			if (shared) {
+				continue;
+			}
+			uint32_t t = edges[i].second;
+			glm::vec3 corners[3];
+			for (int k = 0; k < 3; k++) {
+				corners[k] = points[positionOf[indices[t * 3 + k]]];
+			}
+			glm::vec3 a = points[positionOf[static_cast<uint32_t>(edges[i].first >> 32)]];
+			glm::vec3 b = points[positionOf[static_cast<uint32_t>(edges[i].first)]];
+			glm::vec3 faceNormal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			glm::vec3 normal = glm::cross(b - a, faceNormal);
+			float length = glm::length(normal);
+			if (length == 0.0f) {
+				continue;
+			}
+			normal = normal / length;
+			double edgeWeight = BORDER_WEIGHT * glm::dot(b - a, b - a);
+			quadrics[positionOf[static_cast<uint32_t>(edges[i].first >> 32)]].addPlane(normal, -glm::dot(normal, a), edgeWeight);
+			quadrics[positionOf[static_cast<uint32_t>(edges[i].first)]].addPlane(normal, -glm::dot(normal, a), edgeWeight);
+		}
+
+		std::vector<uint32_t> current(indices, indices + triangleCount * 3);
+		std::vector<uint32_t> adjacencyOffsets;
+		std::vector<uint32_t> adjacency;
+		std::vector<std::pair<uint32_t, uint32_t>> positionEdges;
+		std::vector<Collapse> collapses;
+		std::vector<bool> locked;
+		std::vector<uint32_t> vertexRemap(vertexCount);
+		std::vector<uint32_t> wedges;
+		std::vector<uint32_t> partners;
+		float error = 0.0f;
+
+		// triangles around a position, and the vertices at it, under the current indices
+		auto buildAdjacency = [&]() {
+			adjacencyOffsets.assign(pointCount + 1, 0);
+			for (uint32_t vertex : current) {
+				adjacencyOffsets[positionOf[vertex] + 1]++;
+			}
+			for (size_t p = 0; p < pointCount; p++) {
+				adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+			}
+			adjacency.resize(current.size());
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < current.size(); i++) {
+				adjacency[fill[positionOf[current[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+		};
+
+		// every vertex at from needs a vertex at to that it shares a triangle with to be remapped onto, otherwise
+		// the collapse would drag one side of a seam across the other, fills wedges and partners when it can
+		auto findPartners = [&](uint32_t from, uint32_t to) {
+			wedges.clear();
+			partners.clear();
+			for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++) {
+				const uint32_t* triangle = &current[adjacency[a] * 3];
+				for (int k = 0; k < 3; k++) {
+					if (positionOf[triangle[k]] == from && std::find(wedges.begin(), wedges.end(), triangle[k]) == wedges.end()) {
+						wedges.push_back(triangle[k]);
+						partners.push_back(NONE);
+					}
+				}
+			}
+			for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++) {
+				const uint32_t* triangle = &current[adjacency[a] * 3];
+				uint32_t wedge = NONE;
+				uint32_t partner = NONE;
+				for (int k = 0; k < 3; k++) {
+					if (positionOf[triangle[k]] == from) {
+						wedge = triangle[k];
+					}
+					else if (positionOf[triangle[k]] == to) {
+						partner = triangle[k];
+					}
+				}
+				if (partner == NONE) {
+					continue;
+				}
+				size_t w = std::find(wedges.begin(), wedges.end(), wedge) - wedges.begin();
+				if (partners[w] == NONE) {
+					partners[w] = partner;
+				}
+			}
+			return std::find(partners.begin(), partners.end(), NONE) == partners.end();
+		};
+
+		auto cost = [&](uint32_t from, uint32_t to) {
+			const Quadric& moving = quadrics[from];
+			const Quadric& staying = quadrics[to];
+			return moving.evaluate(points[to]) / std::max(moving.weight, 1e-12) + staying.evaluate(points[to]) / std::max(staying.weight, 1e-12);
+		};
+
+		auto wouldFlip = [&](uint32_t from, uint32_t to) {
+			for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++) {
+				const uint32_t* triangle = &current[adjacency[a] * 3];
+				glm::vec3 corners[3];
+				int moved = -1;
+				bool removed = false;
+				for (int k = 0; k < 3; k++) {
+					uint32_t position = positionOf[triangle[k]];
+					corners[k] = points[position];
+					moved = position == from ? k : moved;
+					removed = removed || position == to;
+				}
+				// the triangles on the edge disappear, the rest must keep facing the same way
+				if (!removed && flips(corners, moved, points[to])) {
+					return true;
+				}
+			}
+			return false;
+		};
+
+		for (uint32_t lod = 0; lod < lodCount; lod++) {
+			size_t startTriangles = current.size() / 3;
+			size_t targetTriangles = static_cast<size_t>(startTriangles * reduction);
+
+			// each pass collapses the cheapest edges that don't touch each other, until the target or nothing more can go
+			while (current.size() / 3 > targetTriangles) {
+				buildAdjacency();
+
+				positionEdges.clear();
+				for (size_t t = 0; t < current.size() / 3; t++) {
+					for (int k = 0; k < 3; k++) {
+						uint32_t a = positionOf[current[t * 3 + k]];
+						uint32_t b = positionOf[current[t * 3 + (k + 1) % 3]];
+						positionEdges.emplace_back(std::min(a, b), std::max(a, b));
+					}
+				}
+				std::sort(positionEdges.begin(), positionEdges.end());
+				positionEdges.erase(std::unique(positionEdges.begin(), positionEdges.end()), positionEdges.end());
+
+				// either end can move onto the other, the cheaper direction is the candidate
+				collapses.clear();
+				for (const auto& edge : positionEdges) {
+					// each end's own planes all pass through it, so only the moving end's planes measure anything,
+					// they are averaged over that end's area alone so a large flat neighbour doesn't hide the error
+					double toSecond = cost(edge.first, edge.second);
+					double toFirst = cost(edge.second, edge.first);
+					if (toSecond <= toFirst) {
+						collapses.push_back({ toSecond, edge.first, edge.second });
+						collapses.push_back({ toFirst, edge.second, edge.first });
+					}
+					else {
+						collapses.push_back({ toFirst, edge.second, edge.first });
+						collapses.push_back({ toSecond, edge.first, edge.second });
+					}
+				}
+				std::stable_sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+					return a.cost < b.cost;
+				});
+
+				std::iota(vertexRemap.begin(), vertexRemap.end(), 0);
+				locked.assign(pointCount, false);
+				size_t remaining = current.size() / 3;
+				size_t applied = 0;
+				for (const Collapse& collapse : collapses) {
+					if (remaining <= targetTriangles) {
+						break;
+					}
+					if (locked[collapse.from] || locked[collapse.to] || !findPartners(collapse.from, collapse.to) || wouldFlip(collapse.from, collapse.to)) {
+						continue;
+					}
+
+					for (size_t w = 0; w < wedges.size(); w++) {
+						vertexRemap[wedges[w]] = partners[w];
+					}
+					quadrics[collapse.to].add(quadrics[collapse.from]);
+					error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+					applied++;
+
+					// everything around from changes shape, so none of it is collapsed again until the next pass
+					for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++) {
+						const uint32_t* triangle = &current[adjacency[a] * 3];
+						bool onEdge = false;
+						for (int k = 0; k < 3; k++) {
+							locked[positionOf[triangle[k]]] = true;
+							onEdge = onEdge || positionOf[triangle[k]] == collapse.to;
+						}
+						remaining -= onEdge ? 1 : 0;
+					}
+				}
+				if (applied == 0) {
+					break;
+				}
+
+				// triangles left with two corners on one position have no area and go
+				size_t kept = 0;
+				for (size_t t = 0; t < current.size() / 3; t++) {
+					uint32_t a = vertexRemap[current[t * 3 + 0]];
+					uint32_t b = vertexRemap[current[t * 3 + 1]];
+					uint32_t c = vertexRemap[current[t * 3 + 2]];
+					if (positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[a] == positionOf[c]) {
+						continue;
+					}
+					current[kept * 3 + 0] = a;
+					current[kept * 3 + 1] = b;
+					current[kept * 3 + 2] = c;
+					kept++;
+				}
+				current.resize(kept * 3);
+			}
+
+			// nothing left to draw, or too little gained to be worth a draw of its own
+			if (current.empty() || current.size() / 3 > startTriangles * MIN_REDUCTION) {
+				break;
+			}
+			Lod simplified;
+			simplified.indices = current;
+			simplified.error = error;
+			chain.push_back(std::move(simplified));
+		}
+		return chain;
+	}
+
+	uint32_t selectLod(const float* errors, uint32_t lodCount, float distance, float lodScale) {
+		for (uint32_t lod = lodCount; lod-- > 1;) {
+			if (errors[lod] * lodScale <= distance) {
+				return lod;
+			}
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// coarser versions of a model for drawing it far away, built at load time by quadric error edge collapse,
+// vertices are only ever merged into other existing vertices so the lods index the model's own vertex range
+namespace meshSimplifier {
+	// a simplified copy of a model's triangles
+	struct Lod {
+		std::vector<uint32_t> indices;
+		float error = 0.0f; // model space, about how far the surface moved, never less than the lod before's
+	};
+
+	// each lod aims for reduction times the triangles of the one before, the chain ends early when a step
+	// can't get below MIN_REDUCTION of them or would leave nothing, so it can come back shorter than lodCount or empty
+	std::vector<Lod> buildLodChain(const uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t stride, size_t vertexCount,
+		uint32_t lodCount, float reduction = 0.5f);
+
+	// a step has to leave at most this share of the triangles before it to be kept
+	const float MIN_REDUCTION = 0.85f;
+
+	// the coarsest lod whose error, times lodScale, is within distance, errors are in the same units as distance,
+	// lodScale is how many pixels a unit covers at distance 1 divided by the pixels of error allowed, cull.comp does the same
+	uint32_t selectLod(const float* errors, uint32_t lodCount, float distance, float lodScale);
+}
@@ -0,0 +1,237 @@
+#include "MeshletCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace meshletCulling {
+	namespace {
+		const uint32_t UNUSED = 0xffffffff;
+
+		glm::vec3 getPosition(const glm::vec3* positions, size_t stride, uint32_t vertex) {
+			return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+		}
+
+		// sphere around the box of the meshlet's corners and the narrowest cone around its triangles' facings
+		void computeBounds(Meshlet& meshlet, const uint32_t* indices, const std::vector<glm::vec3>& normals, const glm::vec3* positions, size_t stride) {
+			const uint32_t* first = indices + meshlet.firstIndex;
+			glm::vec3 low(std::numeric_limits<float>::max());
+			glm::vec3 high(-std::numeric_limits<float>::max());
+			for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+				glm::vec3 position = getPosition(positions, stride, first[i]);
+				low = glm::min(low, position);
+				high = glm::max(high, position);
+			}
+			glm::vec3 centre = (low + high) * 0.5f;
+			float radius = 0.0f;
+			for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+				radius = glm::max(radius, glm::length(getPosition(positions, stride, first[i]) - centre));
+			}
+			meshlet.sphere = glm::vec4(centre, radius);
+
+			// triangles with no area are never rasterized, so they don't widen the cone
+			uint32_t firstTriangle = meshlet.firstIndex / 3;
+			uint32_t triangleCount = meshlet.indexCount / 3;
+			glm::vec3 facing(0.0f);
+			for (uint32_t t = 0; t < triangleCount; t++) {
+				facing += normals[firstTriangle + t];
+			}
+			float facingLength = glm::length(facing);
+			if (facingLength == 0.0f) {
+				meshlet.cone = glm::vec4(0.0f, 0.0f, 1.0f, -1.0f);
+				return;
+			}
+			glm::vec3 axis = facing / facingLength;
+			float cosine = 1.0f;
+			for (uint32_t t = 0; t < triangleCount; t++) {
+				const glm::vec3& normal = normals[firstTriangle + t];
+				if (normal != glm::vec3(0.0f)) {
+					cosine = glm::min(cosine, glm::dot(normal, axis));
+				}
+			}
+			meshlet.cone = glm::vec4(axis, cosine);
+		}
+	}
+
+	std::vector<Meshlet> buildMeshlets(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t stride, size_t vertexCount) {
+		std::vector<Meshlet> result;
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0) {
+			return result;
+		}
+
+		// unit facing of each triangle, zero for ones with no area
+		std::vector<glm::vec3> normals(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			glm::vec3 a = getPosition(positions, stride, indices[t * 3 + 0]);
+			glm::vec3 b = getPosition(positions, stride, indices[t * 3 + 1]);
+			glm::vec3 c = getPosition(positions, stride, indices[t * 3 + 2]);
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+		}
+
+		// the triangles using each vertex, adjacency[adjacencyOffsets[v]] up to adjacencyOffsets[v + 1]
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < triangleCount * 3; i++) {
+			adjacencyOffsets[indices[i] + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++) {
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++) {
+			adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> vertexMeshlet(vertexCount, UNUSED); // the last meshlet each vertex was added to
+		std::vector<uint32_t> order; // triangles in meshlet order
+		order.reserve(triangleCount);
+		std::vector<uint32_t> candidates; // unemitted triangles sharing a vertex with the current meshlet, may repeat
+		size_t nextSeed = 0;
+		uint32_t seed = UNUSED;
+
+		while (order.size() < triangleCount) {
+			if (seed == UNUSED) {
+				while (emitted[nextSeed]) {
+					nextSeed++;
+				}
+				seed = static_cast<uint32_t>(nextSeed);
+			}
+
+			uint32_t meshletIndex = static_cast<uint32_t>(result.size());
+			Meshlet meshlet = {};
+			meshlet.firstIndex = static_cast<uint32_t>(order.size() * 3);
+			glm::vec3 facing(0.0f);
+			candidates.clear();
+
+			uint32_t triangle = seed;
+			while (triangle != UNUSED) {
+				emitted[triangle] = true;
+				order.push_back(triangle);
+				meshlet.indexCount += 3;
+				facing += normals[triangle];
+				for (uint32_t k = 0; k < 3; k++) {
+					uint32_t vertex = indices[triangle * 3 + k];
+					if (vertexMeshlet[vertex] == meshletIndex) {
+						continue;
+					}
+					vertexMeshlet[vertex] = meshletIndex;
+					meshlet.vertexCount++;
+					for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++) {
+						if (!emitted[adjacency[a]]) {
+							candidates.push_back(adjacency[a]);
+						}
+					}
+				}
+				if (meshlet.indexCount / 3 >= MAX_TRIANGLES) {
+					break;
+				}
+
+				// the candidate adding the fewest vertices, then the one facing most like the meshlet so its cone stays narrow
+				triangle = UNUSED;
+				uint32_t bestAdded = 4;
+				float bestFacing = -std::numeric_limits<float>::max();
+				size_t kept = 0;
+				for (uint32_t candidate : candidates) {
+					if (emitted[candidate]) {
+						continue;
+					}
+					candidates[kept++] = candidate;
+					uint32_t added = 0;
+					for (uint32_t k = 0; k < 3; k++) {
+						added += vertexMeshlet[indices[candidate * 3 + k]] != meshletIndex ? 1 : 0;
+					}
+					if (meshlet.vertexCount + added > MAX_VERTICES) {
+						continue;
+					}
+					float candidateFacing = glm::dot(normals[candidate], facing);
+					if (added < bestAdded || (added == bestAdded && candidateFacing > bestFacing)) {
+						triangle = candidate;
+						bestAdded = added;
+						bestFacing = candidateFacing;
+					}
+				}
+				candidates.resize(kept);
+			}
+
+			// the next meshlet grows from where this one stopped, if anything is left around it
+			seed = UNUSED;
+			for (uint32_t candidate : candidates) {
+				if (!emitted[candidate]) {
+					seed = candidate;
+					break;
+				}
+			}
+			result.push_back(meshlet);
+		}
+
+		std::vector<uint32_t> reordered(triangleCount * 3);
+		std::vector<glm::vec3> reorderedNormals(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (uint32_t k = 0; k < 3; k++) {
+				reordered[t * 3 + k] = indices[order[t] * 3 + k];
+			}
+			reorderedNormals[t] = normals[order[t]];
+		}
+		std::copy(reordered.begin(), reordered.end(), indices);
+
+		for (Meshlet& meshlet : result) {
+			computeBounds(meshlet, indices, reorderedNormals, positions, stride);
+		}
+		return result;
+	}
+
+	bool isBackFacing(const Meshlet& meshlet, glm::vec3 cameraPosition) {
+		float cosine = meshlet.cone.w;
+		if (cosine <= 0.0f) {
+			return false;
+		}
+		// the camera has to be behind the plane of any triangle facing within the cone and passing through any point in the sphere,
+		// the worst facing is the one in the cone turned furthest towards the camera
+		glm::vec3 axis = glm::vec3(meshlet.cone);
+		glm::vec3 toMeshlet = glm::vec3(meshlet.sphere) - cameraPosition;
+		float along = glm::dot(toMeshlet, axis);
+		float across = std::sqrt(glm::max(glm::dot(toMeshlet, toMeshlet) - along * along, 0.0f));
+		float sine = std::sqrt(glm::max(1.0f - cosine * cosine, 0.0f));
+		return along * cosine - across * sine > meshlet.sphere.w;
+	}
+
+	uint32_t cullMeshlets(const frustumCulling::Frustum& frustum, glm::vec3 cameraPosition, const glm::mat4& transform,
+		const Meshlet* meshlets, uint32_t count, uint32_t* visible, CullStats* stats) {
+		// facing is tested in model space, which keeps which side of a triangle the camera is on under any affine transform
+		glm::vec3 localCamera = glm::vec3(glm::inverse(transform) * glm::vec4(cameraPosition, 1.0f));
+		float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		uint32_t visibleCount = 0;
+		uint32_t frustumCulled = 0;
+		uint32_t backfaceCulled = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			const Meshlet& meshlet = meshlets[i];
+			glm::vec3 centre = glm::vec3(transform * glm::vec4(glm::vec3(meshlet.sphere), 1.0f));
+			float radius = meshlet.sphere.w * scale;
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				inside = glm::dot(glm::vec3(frustum.planes[p]), centre) + frustum.planes[p].w >= -radius;
+			}
+			if (!inside) {
+				frustumCulled++;
+			}
+			else if (isBackFacing(meshlet, localCamera)) {
+				backfaceCulled++;
+			}
+			else {
+				visible[visibleCount++] = i;
+			}
+		}
+
+		if (stats != nullptr) {
+			stats->tested += count;
+			stats->frustumCulled += frustumCulled;
+			stats->backfaceCulled += backfaceCulled;
+		}
+		return visibleCount;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+// small clusters of a model's triangles, built at load time, each with bounds tight enough to cull it on its own
+// has no vulkan dependency so the builder and the culler can run and be checked without a gpu
+namespace meshletCulling {
+	const uint32_t MAX_VERTICES = 64;
+	const uint32_t MAX_TRIANGLES = 124;
+
+	// model space bounds of one meshlet and where its triangles are, laid out for std430 so cull.comp reads the same
+	struct Meshlet {
+		glm::vec4 sphere; // xyz = centre, w = radius
+		glm::vec4 cone;   // xyz = average facing, w = cosine of the widest angle a triangle faces away from it, 0 or less when it is never culled
+		uint32_t firstIndex; // the meshlet's triangles are indexCount indices from here
+		uint32_t indexCount;
+		uint32_t vertexCount; // unique vertices its triangles use
+		uint32_t padding;
+	};
+	static_assert(sizeof(Meshlet) == 48, "Meshlet struct size must match the std430 array stride");
+
+	struct CullStats {
+		uint32_t tested = 0;
+		uint32_t frustumCulled = 0;
+		uint32_t backfaceCulled = 0;
+	};
+
+	// groups the triangles into meshlets of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles, growing each from
+	// the triangles sharing its vertices that face most like it, and reorders indices so every meshlet's triangles are consecutive,
+	// firstIndex counts from indices, front faces are counter clockwise
+	std::vector<Meshlet> buildMeshlets(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t stride, size_t vertexCount);
+
+	// true when the camera, in the meshlet's space, is behind every one of its triangles, so none of them would be rasterized
+	bool isBackFacing(const Meshlet& meshlet, glm::vec3 cameraPosition);
+
+	// writes the index of each of the count meshlets of an instance that is in the frustum and can face the camera to visible,
+	// in order, and returns how many were written, the frustum and camera are in world space, visible must have room for count entries
+	uint32_t cullMeshlets(const frustumCulling::Frustum& frustum, glm::vec3 cameraPosition, const glm::mat4& transform,
+		const Meshlet* meshlets, uint32_t count, uint32_t* visible, CullStats* stats = nullptr);
+}
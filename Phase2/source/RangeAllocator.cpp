@@ -0,0 +1,56 @@
+#include "RangeAllocator.h"
+
+void RangeAllocator::init(uint32_t capacity, uint32_t used) {
+	freeRanges.clear();
+	if (used < capacity) {
+		freeRanges[used] = capacity - used;
+	}
+}
+
+bool RangeAllocator::allocate(uint32_t count, uint32_t& offset) {
+	if (count == 0) {
+		offset = 0;
+		return true;
+	}
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		if (it->second < count) {
+			continue;
+		}
+		offset = it->first;
+		uint32_t remaining = it->second - count;
+		freeRanges.erase(it);
+		if (remaining > 0) {
+			freeRanges[offset + count] = remaining;
+		}
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t count) {
+	if (count == 0) {
+		return;
+	}
+	auto next = freeRanges.lower_bound(offset);
+	if (next != freeRanges.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			count += previous->second;
+			freeRanges.erase(previous);
+		}
+	}
+	if (next != freeRanges.end() && offset + count == next->first) {
+		count += next->second;
+		freeRanges.erase(next);
+	}
+	freeRanges[offset] = count;
+}
+
+uint32_t RangeAllocator::getFreeCount() const {
+	uint32_t total = 0;
+	for (const auto& range : freeRanges) {
+		total += range.second;
+	}
+	return total;
+}
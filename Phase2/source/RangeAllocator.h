@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+// hands out ranges of a buffer of fixed capacity, freed ranges merge with free neighbours and are reused first fit
+class RangeAllocator {
+public:
+	// everything below used is already taken
+	void init(uint32_t capacity, uint32_t used = 0);
+
+	// false when no free range is large enough, an empty range always fits
+	bool allocate(uint32_t count, uint32_t& offset);
+
+	void free(uint32_t offset, uint32_t count);
+
+	uint32_t getFreeCount() const;
+
+private:
+	std::map<uint32_t, uint32_t> freeRanges; // offset to count
+};
@@ -0,0 +1,369 @@
+#include "RigidBodyWorld.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace collisionDetection {
+	namespace {
+		const int SOLVER_ITERATIONS = 10;
+		// overlap left alone so resting boxes keep touching instead of being pushed apart and falling back every step
+		const float LINEAR_SLOP = 0.005f;
+		// fraction of the remaining overlap pushed out per step
+		const float BAUMGARTE = 0.2f;
+		const float FRICTION = 0.5f;
+		// contacts are made this far apart on top of how far the boxes could move, so nothing passes through in one step
+		const float SPECULATIVE_DISTANCE = 0.02f;
+		// an island whose bodies have all moved slower than this for SLEEP_TIME seconds stops being simulated
+		const float SLEEP_SPEED = 0.05f;
+		const float SLEEP_TIME = 0.5f;
+		// how far around a body its list of nearby static boxes reaches, a body moving slower than this keeps the list for several steps
+		const float STATIC_QUERY_MARGIN = 0.5f;
+
+		// separation along the axis where the boxes are furthest apart, which is the least overlap when they overlap
+		void findSeparatingAxis(const CollisionBox& a, const CollisionBox& b, int& axis, float& sign, float& separation) {
+			glm::vec3 aMax = a.position + a.dimensions;
+			glm::vec3 bMax = b.position + b.dimensions;
+			separation = -std::numeric_limits<float>::max();
+			for (int i = 0; i < 3; i++) {
+				float bAbove = b.position[i] - aMax[i];
+				float bBelow = a.position[i] - bMax[i];
+				float axisSeparation = std::max(bAbove, bBelow);
+				if (axisSeparation > separation) {
+					separation = axisSeparation;
+					axis = i;
+					sign = bAbove >= bBelow ? 1.0f : -1.0f;
+				}
+			}
+		}
+
+		// how far a and b move towards each other along the normal this step, boxes passing side by side don't close at all
+		float getClosingDistance(glm::vec3 velocityA, glm::vec3 velocityB, int axis, float sign, float deltaTime) {
+			return std::max((velocityA[axis] - velocityB[axis]) * sign, 0.0f) * deltaTime;
+		}
+	}
+
+	RigidBodyWorld::RigidBodyWorld(CollisionWorld& world, JobSystem& jobSystem) : world(world), jobSystem(jobSystem), grid(1.0f) {
+	}
+
+	int RigidBodyWorld::addBody(const CollisionBox& box, float mass) {
+		RigidBody body;
+		body.box = box;
+		body.inverseMass = mass > 0.0f ? 1.0f / mass : 0.0f;
+		body.previousPosition = box.position;
+		bodies.push_back(body);
+		travelled.push_back(0.0);
+		staticQueries.emplace_back();
+		int worldBox = world.addBox(box);
+		worldBoxes.push_back(worldBox);
+		isBodyBox.resize(worldBox + 1, false);
+		isBodyBox[worldBox] = true;
+		return static_cast<int>(bodies.size() - 1);
+	}
+
+	int RigidBodyWorld::getWorldBox(int body) const {
+		return worldBoxes[body];
+	}
+
+	const RigidBody& RigidBodyWorld::getBody(int index) const {
+		return bodies[index];
+	}
+
+	size_t RigidBodyWorld::getBodyCount() const {
+		return bodies.size();
+	}
+
+	void RigidBodyWorld::setGravity(glm::vec3 _gravity) {
+		gravity = _gravity;
+	}
+
+	const RigidBodyStats& RigidBodyWorld::getStats() const {
+		return stats;
+	}
+
+	bool RigidBodyWorld::isActive(int body) const {
+		return bodies[body].awake && bodies[body].inverseMass > 0.0f;
+	}
+
+	void RigidBodyWorld::wake(int body, float deltaTime) {
+		// it missed this step's gravity while asleep
+		bodies[body].awake = true;
+		bodies[body].restingTime = 0.0f;
+		bodies[body].box.velocity += gravity * deltaTime;
+	}
+
+	void RigidBodyWorld::step(float deltaTime) {
+		auto start = std::chrono::high_resolution_clock::now();
+		stats.pairsTested = 0;
+
+		for (RigidBody& body : bodies) {
+			body.previousPosition = body.box.position;
+			if (body.awake && body.inverseMass > 0.0f) {
+				body.box.velocity += gravity * deltaTime;
+			}
+		}
+
+		findContacts(deltaTime);
+		buildIslands();
+
+		// islands share no moving bodies, so they can be solved at the same time without locking
+		jobSystem.parallelFor(static_cast<uint32_t>(islandCount), [&](uint32_t index, uint32_t) {
+			solveIsland(islands[index], deltaTime);
+		});
+
+		stats.awakeBodies = 0;
+		for (size_t i = 0; i < bodies.size(); i++) {
+			RigidBody& body = bodies[i];
+			if (body.awake && body.inverseMass > 0.0f) {
+				glm::vec3 move = body.box.velocity * deltaTime;
+				body.box.position += move;
+				travelled[i] += std::max(std::abs(move.x), std::max(std::abs(move.y), std::abs(move.z)));
+				world.setBox(worldBoxes[i], body.box);
+				stats.awakeBodies++;
+			}
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		stats.bodies = static_cast<uint32_t>(bodies.size());
+		stats.contacts = static_cast<uint32_t>(contacts.size());
+		stats.islands = static_cast<uint32_t>(islandCount);
+		stats.stepMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	void RigidBodyWorld::findContacts(float deltaTime) {
+		contacts.clear();
+
+		// bounds grown by how far each body can move this step, anything they don't reach can't be touched,
+		// sleeping bodies don't move so their entries in the grid stay as they were
+		reach.resize(bodies.size());
+		active.clear();
+		for (size_t i = 0; i < bodies.size(); i++) {
+			if (i < gridBodyCount && !isActive(static_cast<int>(i))) {
+				continue;
+			}
+			updateReach(static_cast<int>(i), deltaTime);
+			if (isActive(static_cast<int>(i))) {
+				active.push_back(static_cast<int>(i));
+			}
+		}
+		gridBodyCount = bodies.size();
+
+		// only pairs with an awake body matter, anything awake that can reach a sleeping body wakes it and is searched from too
+		pairs.clear();
+		for (size_t n = 0; n < active.size(); n++) {
+			int body = active[n];
+			candidates.clear();
+			grid.query(reach[body], candidates);
+			for (int other : candidates) {
+				if (other == body) {
+					continue;
+				}
+				pairs.emplace_back(std::min(body, other), std::max(body, other));
+				if (isActive(other) || bodies[other].inverseMass == 0.0f) {
+					continue;
+				}
+
+				int axis;
+				float sign;
+				float separation;
+				if (mayTouch(bodies[body].box, bodies[other].box, deltaTime, axis, sign, separation)) {
+					wake(other, deltaTime);
+					updateReach(other, deltaTime);
+					active.push_back(other);
+				}
+			}
+		}
+		// pairs found from both ends appear twice, sorting also keeps the solver order and so the results the same every run
+		std::sort(pairs.begin(), pairs.end());
+		pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+		for (const std::pair<int, int>& pair : pairs) {
+			const RigidBody& a = bodies[pair.first];
+			const RigidBody& b = bodies[pair.second];
+			if (!isActive(pair.first) && !isActive(pair.second)) {
+				continue;
+			}
+
+			Contact contact = {};
+			contact.bodyA = pair.first;
+			contact.bodyB = pair.second;
+			contact.staticBox = -1;
+			if (mayTouch(a.box, b.box, deltaTime, contact.axis, contact.sign, contact.separation)) {
+				contacts.push_back(contact);
+			}
+		}
+
+		for (int i : active) {
+			// static boxes near a body are looked up with room to spare and the list is kept until the body could have left that room,
+			// every box the body can reach this step is in it
+			const RigidBody& body = bodies[i];
+			glm::vec3 speed = glm::abs(body.box.velocity);
+			float stepReach = std::max(speed.x, std::max(speed.y, speed.z)) * deltaTime + SPECULATIVE_DISTANCE;
+			StaticQuery& query = staticQueries[i];
+			if (query.boxCount != world.getBoxes().size() || travelled[i] - query.travelled + stepReach > query.margin) {
+				query.margin = std::max(STATIC_QUERY_MARGIN, 2.0f * stepReach);
+				query.travelled = travelled[i];
+				query.boxCount = world.getBoxes().size();
+				query.boxes.clear();
+				world.queryCandidates({ body.box.position - glm::vec3(query.margin), body.box.position + body.box.dimensions + glm::vec3(query.margin) }, query.boxes);
+				// the bodies' own boxes move, they're found through the grid above instead
+				query.boxes.erase(std::remove_if(query.boxes.begin(), query.boxes.end(), [&](int box) {
+					return box < static_cast<int>(isBodyBox.size()) && isBodyBox[box];
+				}), query.boxes.end());
+			}
+
+			for (int boxIndex : query.boxes) {
+				// boxes outside the reach are left out as a fresh query would, which keeps the contacts the same
+				const CollisionBox& box = world.getBoxes().get(boxIndex);
+				if (!overlaps(getBounds(box), reach[i])) {
+					continue;
+				}
+				Contact contact = {};
+				contact.bodyA = i;
+				contact.bodyB = STATIC_BODY;
+				contact.staticBox = boxIndex;
+				if (mayTouch(body.box, box, deltaTime, contact.axis, contact.sign, contact.separation)) {
+					contacts.push_back(contact);
+				}
+			}
+		}
+	}
+
+	bool RigidBodyWorld::mayTouch(const CollisionBox& a, const CollisionBox& b, float deltaTime, int& axis, float& sign, float& separation) {
+		stats.pairsTested++;
+		findSeparatingAxis(a, b, axis, sign, separation);
+		return separation < getClosingDistance(a.velocity, b.velocity, axis, sign, deltaTime) + SPECULATIVE_DISTANCE;
+	}
+
+	void RigidBodyWorld::updateReach(int body, float deltaTime) {
+		const CollisionBox& box = bodies[body].box;
+		glm::vec3 travel = glm::abs(box.velocity) * deltaTime + glm::vec3(SPECULATIVE_DISTANCE);
+		reach[body] = { box.position - travel, box.position + box.dimensions + travel };
+		grid.insert(reach[body], body);
+	}
+
+	int RigidBodyWorld::findRoot(int body) {
+		while (parents[body] != body) {
+			parents[body] = parents[parents[body]];
+			body = parents[body];
+		}
+		return body;
+	}
+
+	void RigidBodyWorld::buildIslands() {
+		// union find over the moving bodies, static bodies would join every box resting on the ground into one island
+		parents.resize(bodies.size());
+		for (size_t i = 0; i < bodies.size(); i++) {
+			parents[i] = static_cast<int>(i);
+		}
+		for (const Contact& contact : contacts) {
+			if (contact.bodyB == STATIC_BODY || bodies[contact.bodyA].inverseMass == 0.0f || bodies[contact.bodyB].inverseMass == 0.0f) {
+				continue;
+			}
+			int rootA = findRoot(contact.bodyA);
+			int rootB = findRoot(contact.bodyB);
+			if (rootA != rootB) {
+				parents[rootA] = rootB;
+			}
+		}
+
+		islandOfRoot.assign(bodies.size(), -1);
+		islandCount = 0;
+		for (size_t i = 0; i < contacts.size(); i++) {
+			const Contact& contact = contacts[i];
+			int body = bodies[contact.bodyA].inverseMass > 0.0f ? contact.bodyA : contact.bodyB;
+			int root = findRoot(body);
+			if (islandOfRoot[root] < 0) {
+				islandOfRoot[root] = static_cast<int>(islandCount);
+				if (islandCount == islands.size()) {
+					islands.emplace_back();
+				}
+				islands[islandCount].contacts.clear();
+				islands[islandCount].bodies.clear();
+				islandCount++;
+			}
+			islands[islandOfRoot[root]].contacts.push_back(static_cast<int>(i));
+		}
+		for (size_t i = 0; i < bodies.size(); i++) {
+			int root = findRoot(static_cast<int>(i));
+			if (isActive(static_cast<int>(i)) && islandOfRoot[root] >= 0) {
+				islands[islandOfRoot[root]].bodies.push_back(static_cast<int>(i));
+			}
+		}
+
+		// biggest first so a large pile isn't left until last on one worker
+		std::sort(islands.begin(), islands.begin() + islandCount, [](const Island& a, const Island& b) {
+			return a.contacts.size() > b.contacts.size();
+		});
+	}
+
+	void RigidBodyWorld::solveIsland(const Island& island, float deltaTime) {
+		for (int iteration = 0; iteration < SOLVER_ITERATIONS; iteration++) {
+			for (int contactIndex : island.contacts) {
+				Contact& contact = contacts[contactIndex];
+				RigidBody& a = bodies[contact.bodyA];
+				RigidBody* b = contact.bodyB == STATIC_BODY ? nullptr : &bodies[contact.bodyB];
+				float inverseMassA = a.inverseMass;
+				float inverseMassB = b ? b->inverseMass : 0.0f;
+
+				// bodies that can't move may sit in several islands at once, so only movable ones are written to
+				glm::vec3 fixedVelocityA = a.box.velocity;
+				glm::vec3 fixedVelocityB = b ? b->box.velocity : glm::vec3(0.0f);
+				glm::vec3& velocityA = inverseMassA > 0.0f ? a.box.velocity : fixedVelocityA;
+				glm::vec3& velocityB = inverseMassB > 0.0f ? b->box.velocity : fixedVelocityB;
+				float inverseMassSum = inverseMassA + inverseMassB;
+				int axis = contact.axis;
+
+				// a gap may close this step but no further, an overlap is pushed out a little at a time
+				float targetVelocity;
+				if (contact.separation > 0.0f) {
+					targetVelocity = -contact.separation / deltaTime;
+				}
+				else {
+					targetVelocity = BAUMGARTE * std::max(-contact.separation - LINEAR_SLOP, 0.0f) / deltaTime;
+				}
+
+				float normalVelocity = (velocityB[axis] - velocityA[axis]) * contact.sign;
+				float impulse = (targetVelocity - normalVelocity) / inverseMassSum;
+				float previousImpulse = contact.normalImpulse;
+				contact.normalImpulse = std::max(previousImpulse + impulse, 0.0f);
+				impulse = contact.normalImpulse - previousImpulse;
+				velocityA[axis] -= impulse * contact.sign * inverseMassA;
+				velocityB[axis] += impulse * contact.sign * inverseMassB;
+
+				// friction on the two other axes, limited by how hard the boxes are pressed together
+				float maxFriction = FRICTION * contact.normalImpulse;
+				for (int t = 0; t < 2; t++) {
+					int tangent = (axis + 1 + t) % 3;
+					float tangentVelocity = velocityB[tangent] - velocityA[tangent];
+					float tangentImpulse = tangentVelocity / inverseMassSum;
+					float previousTangentImpulse = contact.tangentImpulse[t];
+					contact.tangentImpulse[t] = std::max(-maxFriction, std::min(previousTangentImpulse + tangentImpulse, maxFriction));
+					tangentImpulse = contact.tangentImpulse[t] - previousTangentImpulse;
+					velocityA[tangent] += tangentImpulse * inverseMassA;
+					velocityB[tangent] -= tangentImpulse * inverseMassB;
+				}
+			}
+		}
+
+		// the whole island sleeps together, a box can't sleep while one it leans on is still moving
+		bool resting = true;
+		for (int body : island.bodies) {
+			RigidBody& rigidBody = bodies[body];
+			if (glm::length(rigidBody.box.velocity) < SLEEP_SPEED) {
+				rigidBody.restingTime += deltaTime;
+			}
+			else {
+				rigidBody.restingTime = 0.0f;
+			}
+			resting = resting && rigidBody.restingTime >= SLEEP_TIME;
+		}
+		if (resting) {
+			for (int body : island.bodies) {
+				bodies[body].awake = false;
+				bodies[body].box.velocity = glm::vec3(0.0f);
+			}
+		}
+	}
+}
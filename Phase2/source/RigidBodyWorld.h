@@ -0,0 +1,125 @@
+#pragma once
+#include "CollisionWorld.h"
+#include "SpatialHashGrid.h"
+#include "JobSystem.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace collisionDetection {
+	// a box that falls and gets pushed around, boxes never rotate since CollisionBox is axis aligned
+	struct RigidBody {
+		CollisionBox box;            // velocity is in units per second
+		float inverseMass;           // 0 for a box nothing can move
+		glm::vec3 previousPosition;  // before the last step, for drawing between steps
+		bool awake = true;           // asleep bodies aren't moved or solved until something awake touches them
+		float restingTime = 0.0f;    // how long the body has been almost still
+	};
+
+	struct RigidBodyStats {
+		uint32_t bodies = 0;
+		uint32_t awakeBodies = 0;
+		uint32_t contacts = 0;
+		uint32_t islands = 0;
+		uint32_t pairsTested = 0;  // pairs the narrowphase looked at this step
+		double stepMilliseconds = 0.0;
+	};
+
+	// dynamic boxes resting on and stacking against each other and the static boxes of a CollisionWorld,
+	// contacts are solved with sequential impulses, each group of touching boxes on its own job
+	// every body is also a box of the world, moved there after each step, so the world's queries see the bodies too
+	class RigidBodyWorld {
+	public:
+		RigidBodyWorld(CollisionWorld& world, JobSystem& jobSystem);
+
+		// returns the body's index
+		int addBody(const CollisionBox& box, float mass = 1.0f);
+
+		// the body's box index in the world
+		int getWorldBox(int body) const;
+
+		const RigidBody& getBody(int index) const;
+
+		size_t getBodyCount() const;
+
+		void setGravity(glm::vec3 gravity);
+
+		void step(float deltaTime);
+
+		const RigidBodyStats& getStats() const;
+
+	private:
+		static const int STATIC_BODY = -1;
+
+		struct Contact {
+			int bodyA;
+			int bodyB;             // STATIC_BODY when touching a static box of the world
+			int staticBox;         // the world's box index when bodyB is STATIC_BODY
+			int axis;              // the normal points along this axis from a to b
+			float sign;
+			float separation;      // negative when overlapping
+			float normalImpulse;   // summed over the iterations so it can be clamped as a whole
+			float tangentImpulse[2];
+		};
+
+		// the static boxes around a body, found with a margin so the list lasts until the body could have moved out of it
+		struct StaticQuery {
+			std::vector<int> boxes;
+			float margin = 0.0f;
+			double travelled = 0.0; // the body's travel when the list was made
+			size_t boxCount = 0;    // boxes in the world then, the list is made again when more are added
+		};
+
+		// boxes joined by contacts, solved together and apart from every other island
+		struct Island {
+			std::vector<int> contacts;
+			std::vector<int> bodies;
+		};
+
+		void findContacts(float deltaTime);
+
+		// whether the boxes are close enough for a contact this step, along with the axis they are furthest apart on
+		bool mayTouch(const CollisionBox& a, const CollisionBox& b, float deltaTime, int& axis, float& sign, float& separation);
+
+		// moves the body's grid entry to cover where it can get to this step
+		void updateReach(int body, float deltaTime);
+
+		void buildIslands();
+
+		void solveIsland(const Island& island, float deltaTime);
+
+		int findRoot(int body);
+
+		bool isActive(int body) const;
+
+		void wake(int body, float deltaTime);
+
+		CollisionWorld& world;
+		JobSystem& jobSystem;
+		glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+		std::vector<RigidBody> bodies;
+		std::vector<int> worldBoxes;   // of each body
+		std::vector<bool> isBodyBox;   // by world box index, boxes added after the last body aren't in it and are static
+		std::vector<Contact> contacts;
+		std::vector<Island> islands;
+		size_t islandCount = 0;
+
+		// bodies in the grid, by the bounds they can reach, the rest were added since the last step
+		SpatialHashGrid grid;
+		std::vector<AABB> reach;
+		size_t gridBodyCount = 0;
+
+		// sum of each step's largest axis move per body, a bound on how far it moved along any axis since any earlier step
+		std::vector<double> travelled;
+		std::vector<StaticQuery> staticQueries;
+
+		// reused every step
+		std::vector<int> active;
+		std::vector<std::pair<int, int>> pairs;
+		std::vector<int> candidates;
+		std::vector<int> parents;
+		std::vector<int> islandOfRoot;
+
+		RigidBodyStats stats;
+	};
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_LANES_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_LANES_SSE
+#endif
+
+// thin wrappers so simd loops are written once for every instruction set,
+// avx processes 8 floats at a time, sse 4, and without either the same loop runs on single floats,
+// avx is only used when the build targets it, see PHASE2_AVX2 in CMakeLists.txt
+namespace simd {
+#if defined(SIMD_LANES_AVX)
+	const uint32_t LANES = 8;
+	typedef __m256 Lanes;
+	inline Lanes load(const float* values) { return _mm256_load_ps(values); }
+	inline Lanes loadUnaligned(const float* values) { return _mm256_loadu_ps(values); }
+	inline Lanes broadcast(float value) { return _mm256_set1_ps(value); }
+	inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+	inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+	inline Lanes minimum(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+	inline Lanes maximum(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+	inline Lanes squareRoot(Lanes a) { return _mm256_sqrt_ps(a); }
+	inline Lanes negate(Lanes a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+	inline Lanes absolute(Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	inline Lanes less(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline Lanes lessEqual(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline Lanes either(Lanes a, Lanes b) { return _mm256_or_ps(a, b); }
+	inline Lanes both(Lanes a, Lanes b) { return _mm256_and_ps(a, b); }
+	inline Lanes none() { return _mm256_setzero_ps(); }
+	inline uint32_t laneMask(Lanes a) { return static_cast<uint32_t>(_mm256_movemask_ps(a)); }
+#elif defined(SIMD_LANES_SSE)
+	const uint32_t LANES = 4;
+	typedef __m128 Lanes;
+	inline Lanes load(const float* values) { return _mm_load_ps(values); }
+	inline Lanes loadUnaligned(const float* values) { return _mm_loadu_ps(values); }
+	inline Lanes broadcast(float value) { return _mm_set1_ps(value); }
+	inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	inline Lanes minimum(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+	inline Lanes maximum(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+	inline Lanes squareRoot(Lanes a) { return _mm_sqrt_ps(a); }
+	inline Lanes negate(Lanes a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+	inline Lanes absolute(Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	inline Lanes less(Lanes a, Lanes b) { return _mm_cmplt_ps(a, b); }
+	inline Lanes lessEqual(Lanes a, Lanes b) { return _mm_cmple_ps(a, b); }
+	inline Lanes either(Lanes a, Lanes b) { return _mm_or_ps(a, b); }
+	inline Lanes both(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+	inline Lanes none() { return _mm_setzero_ps(); }
+	inline uint32_t laneMask(Lanes a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+#else
+	const uint32_t LANES = 1;
+	typedef float Lanes;
+	inline Lanes load(const float* values) { return *values; }
+	inline Lanes loadUnaligned(const float* values) { return *values; }
+	inline Lanes broadcast(float value) { return value; }
+	inline Lanes add(Lanes a, Lanes b) { return a + b; }
+	inline Lanes mul(Lanes a, Lanes b) { return a * b; }
+	inline Lanes minimum(Lanes a, Lanes b) { return std::min(a, b); }
+	inline Lanes maximum(Lanes a, Lanes b) { return std::max(a, b); }
+	inline Lanes squareRoot(Lanes a) { return std::sqrt(a); }
+	inline Lanes negate(Lanes a) { return -a; }
+	inline Lanes absolute(Lanes a) { return std::fabs(a); }
+	inline Lanes less(Lanes a, Lanes b) { return a < b ? 1.0f : 0.0f; }
+	inline Lanes lessEqual(Lanes a, Lanes b) { return a <= b ? 1.0f : 0.0f; }
+	inline Lanes either(Lanes a, Lanes b) { return (a != 0.0f || b != 0.0f) ? 1.0f : 0.0f; }
+	inline Lanes both(Lanes a, Lanes b) { return (a != 0.0f && b != 0.0f) ? 1.0f : 0.0f; }
+	inline Lanes none() { return 0.0f; }
+	inline uint32_t laneMask(Lanes a) { return a != 0.0f ? 1u : 0u; }
+#endif
+}
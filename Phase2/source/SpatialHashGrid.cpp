@@ -0,0 +1,146 @@
+#include "SpatialHashGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace collisionDetection {
+	SpatialHashGrid::SpatialHashGrid(float cellSize) : cellSize(cellSize), inverseCellSize(1.0f / cellSize) {
+	}
+
+	size_t SpatialHashGrid::CellHash::operator()(uint64_t key) const {
+		// the packed coordinates differ mostly in their low bits, mix them so neighbouring cells spread over the buckets
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		key *= 0xc4ceb9fe1a85ec53ULL;
+		key ^= key >> 33;
+		return static_cast<size_t>(key);
+	}
+
+	int SpatialHashGrid::toCell(float coordinate) const {
+		return static_cast<int>(std::floor(coordinate * inverseCellSize));
+	}
+
+	uint64_t SpatialHashGrid::cellKey(int x, int y, int z) {
+		// 21 bits per axis, about a million cells either side of the origin
+		const uint64_t mask = (1ULL << 21) - 1;
+		return (static_cast<uint64_t>(x) & mask) | ((static_cast<uint64_t>(y) & mask) << 21) | ((static_cast<uint64_t>(z) & mask) << 42);
+	}
+
+	template<typename Function>
+	void SpatialHashGrid::forEachCell(const AABB& bounds, Function function) const {
+		int minX = toCell(bounds.min.x), minY = toCell(bounds.min.y), minZ = toCell(bounds.min.z);
+		int maxX = toCell(bounds.max.x), maxY = toCell(bounds.max.y), maxZ = toCell(bounds.max.z);
+		for (int x = minX; x <= maxX; x++) {
+			for (int y = minY; y <= maxY; y++) {
+				for (int z = minZ; z <= maxZ; z++) {
+					function(x, y, z);
+				}
+			}
+		}
+	}
+
+	void SpatialHashGrid::insert(const AABB& bounds, int userData) {
+		if (userData < 0) {
+			throw std::runtime_error("spatial hash grid user data must not be negative");
+		}
+		if (userData >= static_cast<int>(entryBounds.size())) {
+			entryBounds.resize(userData + 1);
+			entryPresent.resize(userData + 1, false);
+			queryStamps.resize(userData + 1, 0);
+		}
+		if (entryPresent[userData]) {
+			remove(userData);
+		}
+
+		entryBounds[userData] = bounds;
+		entryPresent[userData] = true;
+		forEachCell(bounds, [&](int x, int y, int z) {
+			cells[cellKey(x, y, z)].push_back(userData);
+		});
+	}
+
+	void SpatialHashGrid::remove(int userData) {
+		if (userData < 0 || userData >= static_cast<int>(entryPresent.size()) || !entryPresent[userData]) {
+			return;
+		}
+
+		entryPresent[userData] = false;
+		forEachCell(entryBounds[userData], [&](int x, int y, int z) {
+			auto cell = cells.find(cellKey(x, y, z));
+			if (cell == cells.end()) {
+				return;
+			}
+			std::vector<int>& entries = cell->second;
+			auto entry = std::find(entries.begin(), entries.end(), userData);
+			if (entry != entries.end()) {
+				*entry = entries.back();
+				entries.pop_back();
+			}
+			if (entries.empty()) {
+				cells.erase(cell);
+			}
+		});
+	}
+
+	void SpatialHashGrid::query(const AABB& bounds, std::vector<int>& results) const {
+		if (++queryStamp == 0) {
+			// wrapped around, old stamps could now match
+			std::fill(queryStamps.begin(), queryStamps.end(), 0);
+			queryStamp = 1;
+		}
+
+		forEachCell(bounds, [&](int x, int y, int z) {
+			auto cell = cells.find(cellKey(x, y, z));
+			if (cell == cells.end()) {
+				return;
+			}
+			for (int entry : cell->second) {
+				if (queryStamps[entry] != queryStamp) {
+					queryStamps[entry] = queryStamp;
+					if (overlaps(entryBounds[entry], bounds)) {
+						results.push_back(entry);
+					}
+				}
+			}
+		});
+	}
+
+	void SpatialHashGrid::findPairs(std::vector<std::pair<int, int>>& pairs) const {
+		for (const auto& cell : cells) {
+			const std::vector<int>& entries = cell.second;
+			for (size_t i = 0; i < entries.size(); i++) {
+				for (size_t j = i + 1; j < entries.size(); j++) {
+					const AABB& a = entryBounds[entries[i]];
+					const AABB& b = entryBounds[entries[j]];
+					if (!overlaps(a, b)) {
+						continue;
+					}
+					// a pair can share several cells, only the one holding the corner where their overlap starts reports it
+					glm::vec3 corner = glm::max(a.min, b.min);
+					if (cellKey(toCell(corner.x), toCell(corner.y), toCell(corner.z)) != cell.first) {
+						continue;
+					}
+					pairs.emplace_back(std::min(entries[i], entries[j]), std::max(entries[i], entries[j]));
+				}
+			}
+		}
+	}
+
+	float SpatialHashGrid::getCellSize() const {
+		return cellSize;
+	}
+
+	size_t SpatialHashGrid::getCellCount() const {
+		return cells.size();
+	}
+
+	void SpatialHashGrid::clear() {
+		cells.clear();
+		entryBounds.clear();
+		entryPresent.clear();
+		queryStamps.clear();
+		queryStamp = 0;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "AABBTree.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace collisionDetection {
+	// uniform grid hashed into buckets, suited to worlds of many boxes around one cell in size
+	// a box is listed in every cell it touches, so inserting one no bigger than a cell touches at most 8 buckets
+	class SpatialHashGrid {
+	public:
+		explicit SpatialHashGrid(float cellSize = 1.0f);
+
+		// userData is a small non-negative index, such as the box's position in its array, and is what queries return
+		void insert(const AABB& bounds, int userData);
+
+		void remove(int userData);
+
+		// appends the user data of every entry overlapping bounds, each one once
+		void query(const AABB& bounds, std::vector<int>& results) const;
+
+		// every pair of entries whose bounds overlap, first < second, each pair once
+		void findPairs(std::vector<std::pair<int, int>>& pairs) const;
+
+		float getCellSize() const;
+
+		size_t getCellCount() const;
+
+		void clear();
+
+	private:
+		struct CellHash {
+			size_t operator()(uint64_t key) const;
+		};
+
+		int toCell(float coordinate) const;
+
+		static uint64_t cellKey(int x, int y, int z);
+
+		template<typename Function>
+		void forEachCell(const AABB& bounds, Function function) const;
+
+		float cellSize;
+		float inverseCellSize;
+		std::unordered_map<uint64_t, std::vector<int>, CellHash> cells;
+		std::vector<AABB> entryBounds;     // indexed by user data
+		std::vector<bool> entryPresent;
+
+		// entries touching several cells are only reported once per query, marked with the query's stamp
+		mutable std::vector<uint32_t> queryStamps;
+		mutable uint32_t queryStamp = 0;
+	};
+}
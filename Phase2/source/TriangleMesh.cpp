@@ -0,0 +1,325 @@
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace collisionDetection {
+	namespace {
+		const int LEAF_TRIANGLES = 4;
+
+		// Möller-Trumbore, t is in multiples of direction
+		bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t) {
+			glm::vec3 edge1 = b - a;
+			glm::vec3 edge2 = c - a;
+			glm::vec3 p = glm::cross(direction, edge2);
+			float determinant = glm::dot(edge1, p);
+			if (determinant == 0.0f) {
+				return false;
+			}
+			float inverse = 1.0f / determinant;
+			glm::vec3 s = origin - a;
+			float u = glm::dot(s, p) * inverse;
+			if (u < 0.0f || u > 1.0f) {
+				return false;
+			}
+			glm::vec3 q = glm::cross(s, edge1);
+			float v = glm::dot(direction, q) * inverse;
+			if (v < 0.0f || u + v > 1.0f) {
+				return false;
+			}
+			t = glm::dot(edge2, q) * inverse;
+			return t >= 0.0f;
+		}
+
+		// true when the triangle and the box, both relative to the box's centre, project apart on axis
+		bool separatedOn(const glm::vec3& axis, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3 halfEdges[3]) {
+			float pa = glm::dot(a, axis);
+			float pb = glm::dot(b, axis);
+			float pc = glm::dot(c, axis);
+			float radius = std::abs(glm::dot(halfEdges[0], axis)) + std::abs(glm::dot(halfEdges[1], axis)) + std::abs(glm::dot(halfEdges[2], axis));
+			return std::min(pa, std::min(pb, pc)) > radius || std::max(pa, std::max(pb, pc)) < -radius;
+		}
+
+		// separating axis test, the candidates are the box's faces, the triangle's face and every pair of their edges
+		// a degenerate cross product is a zero axis, which never separates, so it needs no special case
+		bool overlapsTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3 halfEdges[3]) {
+			glm::vec3 edges[3] = { b - a, c - b, a - c };
+			if (separatedOn(glm::cross(edges[0], edges[1]), a, b, c, halfEdges)) {
+				return false;
+			}
+			for (int i = 0; i < 3; i++) {
+				if (separatedOn(glm::cross(halfEdges[(i + 1) % 3], halfEdges[(i + 2) % 3]), a, b, c, halfEdges)) {
+					return false;
+				}
+				for (int j = 0; j < 3; j++) {
+					if (separatedOn(glm::cross(halfEdges[i], edges[j]), a, b, c, halfEdges)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		// narrows [enter, exit] to the times the box, moving by displacement from the centre the triangle is relative to,
+		// overlaps the triangle in projection on axis, false when it never does
+		bool overlapTimesOn(const glm::vec3& axis, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3 halfEdges[3],
+			const glm::vec3& displacement, float& enter, float& exit) {
+			float pa = glm::dot(a, axis);
+			float pb = glm::dot(b, axis);
+			float pc = glm::dot(c, axis);
+			float radius = std::abs(glm::dot(halfEdges[0], axis)) + std::abs(glm::dot(halfEdges[1], axis)) + std::abs(glm::dot(halfEdges[2], axis));
+			// the box's centre has to be between these along the axis
+			float low = std::min(pa, std::min(pb, pc)) - radius;
+			float high = std::max(pa, std::max(pb, pc)) + radius;
+			float speed = glm::dot(displacement, axis);
+			if (speed == 0.0f) {
+				return low <= 0.0f && high >= 0.0f;
+			}
+			float first = low / speed;
+			float last = high / speed;
+			if (first > last) {
+				std::swap(first, last);
+			}
+			enter = std::max(enter, first);
+			exit = std::min(exit, last);
+			return enter <= exit;
+		}
+
+		// the box touches the triangle while it overlaps on every axis overlapsTriangle tests, so the first time of contact is
+		// the latest time it starts overlapping on any of them, as long as that comes before it stops overlapping on any
+		bool sweepTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3 halfEdges[3], const glm::vec3& displacement, float& time) {
+			const float infinity = std::numeric_limits<float>::infinity();
+			float enter = -infinity;
+			float exit = infinity;
+			glm::vec3 edges[3] = { b - a, c - b, a - c };
+			if (!overlapTimesOn(glm::cross(edges[0], edges[1]), a, b, c, halfEdges, displacement, enter, exit)) {
+				return false;
+			}
+			for (int i = 0; i < 3; i++) {
+				if (!overlapTimesOn(glm::cross(halfEdges[(i + 1) % 3], halfEdges[(i + 2) % 3]), a, b, c, halfEdges, displacement, enter, exit)) {
+					return false;
+				}
+				for (int j = 0; j < 3; j++) {
+					if (!overlapTimesOn(glm::cross(halfEdges[i], edges[j]), a, b, c, halfEdges, displacement, enter, exit)) {
+						return false;
+					}
+				}
+			}
+			if (exit < 0.0f || enter > 1.0f) {
+				return false;
+			}
+			time = std::max(enter, 0.0f);
+			return true;
+		}
+	}
+
+	TriangleMesh::TriangleMesh(const glm::vec3* positions, size_t stride, const uint32_t* indices, size_t indexCount, uint32_t baseVertex) {
+		if (indexCount % 3 != 0) {
+			throw std::runtime_error("triangle mesh index count is not a multiple of three");
+		}
+
+		const char* base = reinterpret_cast<const char*>(positions);
+		auto position = [&](uint32_t index) {
+			return *reinterpret_cast<const glm::vec3*>(base + (index - baseVertex) * stride);
+		};
+		triangles.reserve(indexCount / 3);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			triangles.push_back({ position(indices[i]), position(indices[i + 1]), position(indices[i + 2]), static_cast<int>(i / 3) });
+		}
+
+		if (triangles.empty()) {
+			nodes.push_back({ { glm::vec3(0.0f), glm::vec3(0.0f) }, 0, 0 });
+			return;
+		}
+		nodes.reserve(2 * triangles.size() / LEAF_TRIANGLES + 1);
+		build(0, static_cast<int>(triangles.size()));
+
+		slots.resize(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i++) {
+			slots[triangles[i].index] = static_cast<int>(i);
+		}
+	}
+
+	int TriangleMesh::build(int first, int count) {
+		int index = static_cast<int>(nodes.size());
+		nodes.emplace_back();
+
+		AABB bounds = { triangles[first].a, triangles[first].a };
+		AABB centroids = bounds;
+		for (int i = first; i < first + count; i++) {
+			const Triangle& triangle = triangles[i];
+			bounds = combine(bounds, { glm::min(triangle.a, glm::min(triangle.b, triangle.c)), glm::max(triangle.a, glm::max(triangle.b, triangle.c)) });
+			glm::vec3 centroid = (triangle.a + triangle.b + triangle.c) * (1.0f / 3.0f);
+			centroids = combine(centroids, { centroid, centroid });
+		}
+		nodes[index].bounds = bounds;
+
+		glm::vec3 spread = centroids.max - centroids.min;
+		if (count <= LEAF_TRIANGLES || (spread.x == 0.0f && spread.y == 0.0f && spread.z == 0.0f)) {
+			nodes[index].first = first;
+			nodes[index].count = count;
+			return index;
+		}
+
+		int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+		int half = count / 2;
+		std::nth_element(triangles.begin() + first, triangles.begin() + first + half, triangles.begin() + first + count, [axis](const Triangle& l, const Triangle& r) {
+			return l.a[axis] + l.b[axis] + l.c[axis] < r.a[axis] + r.b[axis] + r.c[axis];
+		});
+
+		build(first, half);
+		int right = build(first + half, count - half);
+		nodes[index].first = right;
+		nodes[index].count = 0;
+		return index;
+	}
+
+	bool TriangleMesh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, int& triangle) const {
+		struct Entry {
+			int node;
+			float distance;
+		};
+
+		float entryDistance;
+		int axis;
+		if (triangles.empty() || !intersectRay(nodes[0].bounds, origin, direction, maxDistance, entryDistance, axis)) {
+			return false;
+		}
+
+		triangle = -1;
+		std::vector<Entry> stack;
+		stack.push_back({ 0, entryDistance });
+		while (!stack.empty()) {
+			Entry entry = stack.back();
+			stack.pop_back();
+			if (entry.distance > maxDistance) {
+				continue;
+			}
+
+			const Node& node = nodes[entry.node];
+			if (node.count > 0) {
+				for (int i = node.first; i < node.first + node.count; i++) {
+					float t;
+					if (!intersectTriangle(origin, direction, triangles[i].a, triangles[i].b, triangles[i].c, t) || t > maxDistance) {
+						continue;
+					}
+					// the tree decides the order triangles are tested in, so ties go to the lower index
+					if (t < maxDistance || triangle < 0 || triangles[i].index < triangle) {
+						maxDistance = t;
+						triangle = triangles[i].index;
+					}
+				}
+				continue;
+			}
+
+			Entry children[2];
+			int childCount = 0;
+			for (int child : { entry.node + 1, node.first }) {
+				if (intersectRay(nodes[child].bounds, origin, direction, maxDistance, entryDistance, axis)) {
+					children[childCount++] = { child, entryDistance };
+				}
+			}
+			// the nearer child goes on top so its hits can cut the farther one off
+			if (childCount == 2 && children[1].distance > children[0].distance) {
+				std::swap(children[0], children[1]);
+			}
+			for (int i = 0; i < childCount; i++) {
+				stack.push_back(children[i]);
+			}
+		}
+
+		if (triangle < 0) {
+			return false;
+		}
+		distance = maxDistance;
+		return true;
+	}
+
+	bool TriangleMesh::overlaps(const glm::vec3& centre, const glm::vec3 halfEdges[3]) const {
+		if (triangles.empty()) {
+			return false;
+		}
+
+		glm::vec3 reach = glm::abs(halfEdges[0]) + glm::abs(halfEdges[1]) + glm::abs(halfEdges[2]);
+		AABB bounds = { centre - reach, centre + reach };
+
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& node = nodes[stack[--stackSize]];
+			if (!collisionDetection::overlaps(node.bounds, bounds)) {
+				continue;
+			}
+
+			if (node.count > 0) {
+				for (int i = node.first; i < node.first + node.count; i++) {
+					if (overlapsTriangle(triangles[i].a - centre, triangles[i].b - centre, triangles[i].c - centre, halfEdges)) {
+						return true;
+					}
+				}
+				continue;
+			}
+
+			// median splits keep the depth near log2 of the triangle count, far below 64
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = static_cast<int>(&node - nodes.data()) + 1;
+		}
+		return false;
+	}
+
+	bool TriangleMesh::sweep(const glm::vec3& centre, const glm::vec3 halfEdges[3], const glm::vec3& displacement, float& time) const {
+		if (triangles.empty()) {
+			return false;
+		}
+
+		// everything the box passes over, the hits only ever shorten the move so this stays enough
+		glm::vec3 reach = glm::abs(halfEdges[0]) + glm::abs(halfEdges[1]) + glm::abs(halfEdges[2]);
+		glm::vec3 end = centre + displacement;
+		AABB bounds = { glm::min(centre, end) - reach, glm::max(centre, end) + reach };
+
+		bool hit = false;
+		time = 1.0f;
+		int stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& node = nodes[stack[--stackSize]];
+			if (!collisionDetection::overlaps(node.bounds, bounds)) {
+				continue;
+			}
+
+			if (node.count > 0) {
+				for (int i = node.first; i < node.first + node.count; i++) {
+					float triangleTime;
+					if (sweepTriangle(triangles[i].a - centre, triangles[i].b - centre, triangles[i].c - centre, halfEdges, displacement, triangleTime) && triangleTime <= time) {
+						time = triangleTime;
+						hit = true;
+					}
+				}
+				continue;
+			}
+
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = static_cast<int>(&node - nodes.data()) + 1;
+		}
+		return hit;
+	}
+
+	glm::vec3 TriangleMesh::getTriangleNormal(int triangle) const {
+		const Triangle& t = triangles[slots[triangle]];
+		glm::vec3 normal = glm::cross(t.b - t.a, t.c - t.a);
+		float length = glm::length(normal);
+		return length > 0.0f ? normal / length : glm::vec3(0.0f);
+	}
+
+	const AABB& TriangleMesh::getBounds() const {
+		return nodes[0].bounds;
+	}
+
+	size_t TriangleMesh::getTriangleCount() const {
+		return triangles.size();
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "AABBTree.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace collisionDetection {
+	// static triangle soup with a bounding volume hierarchy over it, built once from a model's geometry and shared by every
+	// instance of the model, queries are given in model space and callers transform into it rather than moving the triangles
+	class TriangleMesh {
+	public:
+		// positions are read stride bytes apart, indices are three per triangle and have baseVertex taken off before use,
+		// so a model's range of the shared vertex and index arrays can be passed as it is
+		TriangleMesh(const glm::vec3* positions, size_t stride, const uint32_t* indices, size_t indexCount, uint32_t baseVertex = 0);
+
+		// nearest triangle along the ray within maxDistance, distance is measured in multiples of direction, both faces count,
+		// triangle is its position in the indices given to the constructor, the lower one when several are hit at the same distance
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, int& triangle) const;
+
+		// whether any triangle touches the box with this centre and half edges, the edges don't need to be perpendicular
+		// so a world space box transformed into model space can be tested as it is
+		bool overlaps(const glm::vec3& centre, const glm::vec3 halfEdges[3]) const;
+
+		// earliest fraction of displacement the same box can move before it touches a triangle, 0 when it starts touching one,
+		// false when it moves the whole way without touching any
+		bool sweep(const glm::vec3& centre, const glm::vec3 halfEdges[3], const glm::vec3& displacement, float& time) const;
+
+		// unit normal of the triangle's front face, counter clockwise winding, by its position in the constructor's indices
+		glm::vec3 getTriangleNormal(int triangle) const;
+
+		const AABB& getBounds() const;
+
+		size_t getTriangleCount() const;
+
+	private:
+		struct Node {
+			AABB bounds;
+			int first; // first triangle for a leaf, otherwise the right child, the left child always follows its parent
+			int count; // 0 for inner nodes
+		};
+
+		struct Triangle {
+			glm::vec3 a;
+			glm::vec3 b;
+			glm::vec3 c;
+			int index; // in the constructor's indices, build reorders the triangles
+		};
+
+		// splits triangles [first, first + count) at the median centroid on the longest axis until leaves are small
+		int build(int first, int count);
+
+		std::vector<Triangle> triangles;
+		std::vector<int> slots; // where each of the constructor's triangles ended up in triangles
+		std::vector<Node> nodes;
+	};
+}
@@ -0,0 +1,97 @@
+#include "VertexPacking.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace vertexPacking {
+	namespace {
+		const float SNORM16_MAX = 32767.0f;
+
+		float signNotZero(float value) {
+			return value >= 0.0f ? 1.0f : -1.0f;
+		}
+	}
+
+	uint16_t packHalf(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t exponent = (bits >> 23) & 0xff;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		// infinity stays infinity, a nan keeps a mantissa bit so it stays a nan
+		if (exponent == 0xff) {
+			return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+		}
+		int rebiased = static_cast<int>(exponent) - 127 + 15;
+		if (rebiased >= 31) {
+			return static_cast<uint16_t>(sign | 0x7c00);
+		}
+
+		uint32_t half;
+		uint32_t rest;
+		uint32_t halfway;
+		if (rebiased <= 0) {
+			// below the smallest normal half, the implicit bit becomes part of the denormal's mantissa
+			if (rebiased < -10) {
+				return static_cast<uint16_t>(sign);
+			}
+			mantissa |= 0x800000;
+			uint32_t shift = static_cast<uint32_t>(14 - rebiased);
+			half = mantissa >> shift;
+			rest = mantissa & ((1u << shift) - 1);
+			halfway = 1u << (shift - 1);
+		}
+		else {
+			half = (static_cast<uint32_t>(rebiased) << 10) | (mantissa >> 13);
+			rest = mantissa & 0x1fff;
+			halfway = 0x1000;
+		}
+		// a carry out of the mantissa moves to the next exponent, or to infinity, which is the correctly rounded result
+		if (rest > halfway || (rest == halfway && (half & 1) != 0)) {
+			half++;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	float unpackHalf(uint16_t value) {
+		uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+		uint32_t exponent = (value >> 10) & 0x1f;
+		uint32_t mantissa = value & 0x3ff;
+
+		if (exponent == 0) {
+			float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+			return sign != 0 ? -magnitude : magnitude;
+		}
+		uint32_t bits = exponent == 31 ? (sign | 0x7f800000 | (mantissa << 13)) : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	void packOctahedral(glm::vec3 normal, int16_t packed[2]) {
+		float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+		if (length == 0.0f) {
+			packed[0] = 0;
+			packed[1] = 0;
+			return;
+		}
+		// onto the octahedron |x| + |y| + |z| = 1, the lower half is folded out over the corners of the upper half's diamond
+		glm::vec2 folded(normal.x / length, normal.y / length);
+		if (normal.z < 0.0f) {
+			folded = glm::vec2((1.0f - std::fabs(folded.y)) * signNotZero(folded.x), (1.0f - std::fabs(folded.x)) * signNotZero(folded.y));
+		}
+		packed[0] = static_cast<int16_t>(std::lround(glm::clamp(folded.x, -1.0f, 1.0f) * SNORM16_MAX));
+		packed[1] = static_cast<int16_t>(std::lround(glm::clamp(folded.y, -1.0f, 1.0f) * SNORM16_MAX));
+	}
+
+	glm::vec3 unpackOctahedral(const int16_t packed[2]) {
+		// the same decode as the vertex shaders, which get the snorms already converted by the vertex fetch
+		glm::vec2 folded(glm::max(packed[0] / SNORM16_MAX, -1.0f), glm::max(packed[1] / SNORM16_MAX, -1.0f));
+		glm::vec3 normal(folded.x, folded.y, 1.0f - std::fabs(folded.x) - std::fabs(folded.y));
+		float under = glm::max(-normal.z, 0.0f);
+		normal.x += normal.x >= 0.0f ? -under : under;
+		normal.y += normal.y >= 0.0f ? -under : under;
+		return glm::normalize(normal);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// conversions between full floats and the compact forms vertices are stored in on the gpu,
+// the vertex shaders undo them, the hardware converts halves and snorms when fetching
+namespace vertexPacking {
+	// ieee half, rounded to nearest even, too large values become infinity
+	uint16_t packHalf(float value);
+
+	float unpackHalf(uint16_t value);
+
+	// unit vector folded onto an octahedron and flattened to two snorm16s, off by a few hundredths of a degree at worst,
+	// a zero vector comes back as +z
+	void packOctahedral(glm::vec3 normal, int16_t packed[2]);
+
+	glm::vec3 unpackOctahedral(const int16_t packed[2]);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// merges vertices that are identical bit for bit, in a flat open addressing table with linear probing
+// every 32 bit word of the vertex is hashed, and the hash is kept beside each slot so a probe only compares whole vertices
+// when the hashes match, nothing is allocated per vertex, only when the table doubles
+// bit for bit means 0.0 and -0.0 stay apart and a NaN welds with itself, unlike operator==
+template<typename Vertex>
+class VertexWelder {
+	static_assert(std::is_trivially_copyable<Vertex>::value, "vertices are compared and hashed as raw bytes");
+	static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "vertices are hashed a 32 bit word at a time");
+
+public:
+	// unique receives each new vertex, indices handed out are positions in it
+	explicit VertexWelder(std::vector<Vertex>& unique, size_t expectedVertices = 0) : unique(unique) {
+		size_t capacity = 64;
+		while (capacity < expectedVertices * 2) {
+			capacity *= 2;
+		}
+		slots.assign(capacity, Slot{ 0, EMPTY });
+	}
+
+	// index of the vertex in unique, appended if it wasn't there
+	uint32_t weld(const Vertex& vertex) {
+		uint32_t hash = hashVertex(vertex);
+		size_t mask = slots.size() - 1;
+		for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+			Slot& entry = slots[slot];
+			if (entry.index == EMPTY) {
+				uint32_t index = static_cast<uint32_t>(unique.size());
+				unique.push_back(vertex);
+				entry = { hash, index };
+				// kept at most half full so probe runs stay short
+				if (++count * 2 > slots.size()) {
+					grow();
+				}
+				return index;
+			}
+			if (entry.hash == hash && std::memcmp(&unique[entry.index], &vertex, sizeof(Vertex)) == 0) {
+				return entry.index;
+			}
+		}
+	}
+
+	static uint32_t hashVertex(const Vertex& vertex) {
+		uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+		std::memcpy(words, &vertex, sizeof(Vertex));
+		// murmur3's per word mixing and finaliser, every bit of every word reaches every bit of the result
+		uint32_t hash = 0x9747b28c;
+		for (uint32_t word : words) {
+			word *= 0xcc9e2d51;
+			word = (word << 15) | (word >> 17);
+			word *= 0x1b873593;
+			hash ^= word;
+			hash = (hash << 13) | (hash >> 19);
+			hash = hash * 5 + 0xe6546b64;
+		}
+		hash ^= static_cast<uint32_t>(sizeof(Vertex));
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6b;
+		hash ^= hash >> 13;
+		hash *= 0xc2b2ae35;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+private:
+	static const uint32_t EMPTY = 0xffffffff;
+
+	struct Slot {
+		uint32_t hash;
+		uint32_t index;
+	};
+
+	void grow() {
+		std::vector<Slot> old;
+		old.swap(slots);
+		slots.assign(old.size() * 2, Slot{ 0, EMPTY });
+		size_t mask = slots.size() - 1;
+		for (const Slot& entry : old) {
+			if (entry.index == EMPTY) {
+				continue;
+			}
+			size_t slot = entry.hash & mask;
+			while (slots[slot].index != EMPTY) {
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = entry;
+		}
+	}
+
+	std::vector<Vertex>& unique;
+	std::vector<Slot> slots;
+	size_t count = 0;
+};
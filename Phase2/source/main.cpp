@@ -1,6 +1,10 @@
 #include "Graphics.h"
 #include "Input.h"
 #include "CollisionDetection.h"
+#include "CollisionWorld.h"
+#include "RigidBodyWorld.h"
+#include "FrameTiming.h"
+
 Graphics gfx;
 Input input;
 
@@ -19,16 +23,44 @@ int main() {
 		bool last1;
 		bool last2;
 		bool last3;
-		std::vector<CollisionBox> boxes;
+		bool lastTab;
+		bool last5;
+		bool lastQ;
+		bool last7;
+		collisionDetection::CollisionWorld world;
 		CollisionBox test;
 		test.dimensions = glm::vec3(1, 1, 1);
 		test.velocity = glm::vec3(0, 0, 0);
 		test.position = glm::vec3(0, 0, 0);
-		boxes.push_back(test);
+		world.addBox(test);
+		// the floor dropped boxes land on, drawn with the texcube model, which spans -1 to 1
+		test.dimensions = glm::vec3(200, 1, 200);
+		test.position = glm::vec3(-100, -3, -100);
+		size_t floorInstance = gfx.getRenderInstanceCount(0);
+		gfx.addRenderInstance(0, 0, 0, 0);
+		if (gfx.getRenderInstanceCount(0) > floorInstance) {
+			gfx.setRenderInstanceTransform(0, floorInstance, glm::scale(glm::translate(glm::mat4(1.0f), test.position + test.dimensions * 0.5f), test.dimensions * 0.5f));
+			world.addBox(test);
+		}
+		// the test3 instances collide with their triangles rather than a box around them
+		const collisionDetection::TriangleMesh* test3Collider = gfx.getModelCollider(1);
+		std::vector<int> test3Meshes;
+		for (size_t i = 0; test3Collider && i < gfx.getRenderInstanceCount(1); i++) {
+			test3Meshes.push_back(world.addMesh(*test3Collider, gfx.getRenderInstanceTransform(1, i)));
+		}
+		// boxes dropped with f, each drawn by an instance of model 3, their boxes in world follow them so the camera and q hit them
+		collisionDetection::RigidBodyWorld bodies(world, gfx.getJobSystem());
+		std::vector<size_t> bodyInstances;
+		std::vector<bool> bodyMoving;
 		glm::vec3 inputVelocity = glm::vec3(0,0,0);
 		CollisionBox camera;
 		camera.dimensions = glm::vec3(0.01, 0.01, 0.01);
 		camera.velocity = glm::vec3(0, 0, 0);
+		camera.position = gfx.getCameraPos();
+		glm::vec3 previousCameraPosition = camera.position;
+		// movement and collision run at a fixed rate, frames draw between the last two steps
+		FixedTimestep timestep(1.0 / 120.0);
+		FrameLimiter frameLimiter;
 		bool lastSpace;
 		//TODO: add fps std::cout printing
 		double lastTime = glfwGetTime();
@@ -37,7 +69,13 @@ int main() {
 			double currentTime = glfwGetTime();
 			frameCount++;
 			if (currentTime - lastTime >= 1.0) {
-				std::cout << "FPS: " << frameCount << std::endl;
+				frustumCulling::CullStats cullStats = gfx.getCullStats();
+				meshletCulling::CullStats meshletStats = gfx.getMeshletCullStats();
+				const collisionDetection::RigidBodyStats& bodyStats = bodies.getStats();
+				std::cout << "FPS: " << frameCount << " drawn: " << cullStats.drawn << " culled: " << cullStats.culled
+					<< " meshlets tested: " << meshletStats.tested << " off screen: " << meshletStats.frustumCulled << " back facing: " << meshletStats.backfaceCulled
+					<< " bodies: " << bodyStats.awakeBodies << "/" << bodyStats.bodies << " awake, step " << bodyStats.stepMilliseconds << "ms"
+					<< " pairs tested: " << bodyStats.pairsTested << std::endl;
 				frameCount = 0;
 				lastTime = currentTime;
 			}
@@ -45,59 +83,129 @@ int main() {
 
 			gfx.setCameraAngle(input.cameraAngle);
 			input.run();
-			gfx.run();
 
-			inputVelocity = glm::vec3(0, 0, 0);
-			float speed = 0.03f;
+			// per second, what the old per frame speeds gave at 120 frames a second
+			float speed = 3.6f;
 			if (input.keys.ctrl) {
-				speed = 0.1f;
+				speed = 12.0f;
 			}
-			if (input.keys.w) {
-				inputVelocity.z = speed;
-			}
-			if (input.keys.a) {
-				inputVelocity.x = -speed;
-			}
-			if (input.keys.s) {
-				inputVelocity.z = -speed;
-			}
-			if (input.keys.d) {
-				inputVelocity.x = speed;
+			uint32_t steps = timestep.advance(currentTime);
+			for (uint32_t step = 0; step < steps; step++) {
+				inputVelocity = glm::vec3(0, 0, 0);
+				float stepSpeed = speed * static_cast<float>(timestep.getStepSeconds());
+				if (input.keys.w) {
+					inputVelocity.z = stepSpeed;
+				}
+				if (input.keys.a) {
+					inputVelocity.x = -stepSpeed;
+				}
+				if (input.keys.s) {
+					inputVelocity.z = -stepSpeed;
+				}
+				if (input.keys.d) {
+					inputVelocity.x = stepSpeed;
+				}
+				if (input.keys.space) {
+					inputVelocity.y = stepSpeed;
+				}
+				if (input.keys.leftShift) {
+					inputVelocity.y = -stepSpeed;
+				}
+
+				previousCameraPosition = camera.position;
+				camera.velocity = gfx.getProperCameraVelocity(inputVelocity);
+				world.moveAndSlide(camera);
+				camera.position = camera.position + camera.velocity;
+
+				bodies.step(static_cast<float>(timestep.getStepSeconds()));
 			}
-			if (input.keys.space) {
-				inputVelocity.y = speed;
+			if (steps > 0) {
+				for (size_t i = 0; i < bodyInstances.size(); i++) {
+					const collisionDetection::RigidBody& body = bodies.getBody(static_cast<int>(i));
+					bool moving = body.previousPosition != body.box.position;
+					if (moving) {
+						gfx.setRenderInstanceTransform(3, bodyInstances[i], glm::translate(glm::mat4(1.0f), body.previousPosition), glm::translate(glm::mat4(1.0f), body.box.position));
+					}
+					else if (bodyMoving[i]) {
+						// settled, stop blending it every frame
+						gfx.setRenderInstanceTransform(3, bodyInstances[i], glm::translate(glm::mat4(1.0f), body.box.position));
+					}
+					bodyMoving[i] = moving;
+				}
 			}
-			if (input.keys.leftShift) {
-				inputVelocity.y = -speed;
+			gfx.setCameraPos(previousCameraPosition, camera.position);
+			gfx.setInterpolationAlpha(timestep.getAlpha());
+			gfx.run();
+			// a hot reload of test3 swaps its collider, the old one is only kept for a frame or so
+			const collisionDetection::TriangleMesh* collider = gfx.getModelCollider(1);
+			if (collider != test3Collider && collider) {
+				for (int mesh : test3Meshes) {
+					world.setMesh(mesh, *collider);
+				}
+				test3Collider = collider;
 			}
+			frameLimiter.wait();
 
-			camera.velocity = gfx.getProperCameraVelocity(inputVelocity);
-			for (int i = 0; i < boxes.size(); i++) {
-				collisionDetection::correctCollisionBoxes(&camera, &boxes[i]);
-			}
-			gfx.setCameraPos(camera.position);
-			gfx.setCameraPos(gfx.getCameraPos()+camera.velocity);
 			if (input.keys.f && !lastF) {
-				gfx.addRenderInstance(gfx.getCameraPos().x, gfx.getCameraPos().y, gfx.getCameraPos().z, 3);
-				test.dimensions = glm::vec3(1, 1, 1);
-				test.velocity = glm::vec3(0, 0, 0);
-				test.position = glm::vec3(gfx.getCameraPos().x, gfx.getCameraPos().y, gfx.getCameraPos().z);
-				boxes.push_back(test);
+				size_t instance = gfx.getRenderInstanceCount(3);
+				gfx.addRenderInstance(camera.position.x, camera.position.y, camera.position.z, 3);
+				if (gfx.getRenderInstanceCount(3) > instance) {
+					test.dimensions = glm::vec3(1, 1, 1);
+					test.velocity = glm::vec3(0, 0, 0);
+					test.position = camera.position;
+					bodies.addBody(test);
+					bodyInstances.push_back(instance);
+					bodyMoving.push_back(false);
+				}
+			}
+			if (input.keys.tab && !lastTab) {
+				collisionDetection::Broadphase next = static_cast<collisionDetection::Broadphase>((static_cast<int>(world.getBroadphase()) + 1) % 3);
+				world.setBroadphase(next);
+				std::cout << "broadphase: " << collisionDetection::getBroadphaseName(next) << std::endl;
 			}
 			if (input.keys.n1 && !last1) {
-				gfx.addLight(gfx.getCameraPos(), glm::vec3(2.0, 0.0,0.0), 1);
+				gfx.addLight(camera.position, glm::vec3(2.0, 0.0,0.0), 1);
 			}
 			if (input.keys.n2 && !last2) {
-				gfx.addLight(gfx.getCameraPos(), glm::vec3(0.0, 2.0,0.0), 1);
+				gfx.addLight(camera.position, glm::vec3(0.0, 2.0,0.0), 1);
 			}
 			if (input.keys.n3 && !last3) {
-				gfx.addLight(gfx.getCameraPos(), glm::vec3(0.0, 0.0, 2.0), 1);
+				gfx.addLight(camera.position, glm::vec3(0.0, 0.0, 2.0), 1);
 			}
 			lastF = input.keys.f;
 			last1 = input.keys.n1;
 			last2 = input.keys.n2;
 			last3 = input.keys.n3;
-			camera.position = gfx.getCameraPos();
+			if (input.keys.n5 && !last5) {
+				frameLimiter.setMaxFramesPerSecond(frameLimiter.getMaxFramesPerSecond() > 0.0 ? 0.0 : 60.0);
+				std::cout << "frame cap: " << frameLimiter.getMaxFramesPerSecond() << std::endl;
+			}
+			if (input.keys.q && !lastQ) {
+				// what the camera is looking at
+				collisionDetection::RaycastHit hit;
+				if (world.raycast(camera.position, gfx.getCameraDirection(), 100.0f, hit)) {
+					if (hit.mesh >= 0) {
+						std::cout << "looking at mesh " << hit.mesh << " triangle " << hit.triangle;
+					}
+					else {
+						std::cout << "looking at box " << hit.box;
+					}
+					std::cout << " " << hit.distance << " away, face normal " << hit.normal.x << " " << hit.normal.y << " " << hit.normal.z << std::endl;
+				}
+				else {
+					std::cout << "looking at nothing" << std::endl;
+				}
+			}
+			if (input.keys.n7 && !last7) {
+				// loaded in the background, the instance shows up once the model has arrived
+				int streamed = gfx.streamModel({ "resources/models/nextUC.obj", glm::vec4(0.8, 0.8, 0.8, 1), 1 });
+				gfx.addRenderInstance(camera.position.x, camera.position.y, camera.position.z, streamed);
+				std::cout << "streaming model " << streamed << ", " << gfx.getPendingStreamCount() << " pending" << std::endl;
+			}
+			last5 = input.keys.n5;
+			last7 = input.keys.n7;
+			lastQ = input.keys.q;
+			lastTab = input.keys.tab;
 
 		}
 	}
@@ -0,0 +1,103 @@
+#include "CollisionBoxArray.h"
+#include "CollisionDetection.h"
+#include "SimdLanes.h"
+#include "TestRandom.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// runs random movers through the scalar correctCollisionBoxes, one box at a time, and through the simd CollisionBoxArray overload,
+// the two have to leave the mover bit for bit the same
+namespace {
+	using namespace testRandom;
+
+	// half the coordinates land on a half unit grid, so faces line up exactly the way level geometry does
+	float coordinate(float low, float high) {
+		float value = uniform(low, high);
+		return uniformInt(0, 1) == 0 ? std::floor(value * 2.0f) * 0.5f : value;
+	}
+
+	CollisionBox randomBox() {
+		CollisionBox box;
+		box.position = glm::vec3(coordinate(-6.0f, 6.0f), coordinate(-6.0f, 6.0f), coordinate(-6.0f, 6.0f));
+		box.dimensions = glm::vec3(coordinate(0.5f, 4.0f), coordinate(0.5f, 4.0f), coordinate(0.5f, 4.0f));
+		box.velocity = glm::vec3(0.0f);
+		return box;
+	}
+
+	// movers often start flush against a box face, which is where the rounding of the two routines could differ
+	CollisionBox randomMover(const std::vector<CollisionBox>& boxes) {
+		CollisionBox mover = randomBox();
+		mover.dimensions = glm::vec3(uniform(0.2f, 1.5f), uniform(0.5f, 2.0f), uniform(0.2f, 1.5f));
+		if (!boxes.empty() && uniformInt(0, 1) == 0) {
+			const CollisionBox& box = boxes[uniformInt(0, static_cast<int>(boxes.size()) - 1)];
+			int axis = uniformInt(0, 2);
+			mover.position = box.position + glm::vec3(uniform(-0.5f, 0.5f), uniform(-0.5f, 0.5f), uniform(-0.5f, 0.5f)) * box.dimensions;
+			mover.position[axis] = uniformInt(0, 1) == 0 ? box.position[axis] + box.dimensions[axis] : box.position[axis] - mover.dimensions[axis];
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			int kind = uniformInt(0, 3);
+			mover.velocity[axis] = kind == 0 ? 0.0f : kind == 1 ? coordinate(-3.0f, 3.0f) : uniform(-0.3f, 0.3f);
+		}
+		return mover;
+	}
+
+	bool sameBits(const CollisionBox& a, const CollisionBox& b) {
+		return std::memcmp(&a, &b, sizeof(CollisionBox)) == 0;
+	}
+
+	void print(const char* label, const CollisionBox& box) {
+		std::printf("  %s position (%.9g %.9g %.9g) dimensions (%.9g %.9g %.9g) velocity (%.9g %.9g %.9g)\n", label,
+			box.position.x, box.position.y, box.position.z, box.dimensions.x, box.dimensions.y, box.dimensions.z,
+			box.velocity.x, box.velocity.y, box.velocity.z);
+	}
+}
+
+int main() {
+	const int SCENES = 2000;
+	const int MOVERS_PER_SCENE = 50;
+	int failures = 0;
+	int corrected = 0;
+
+	for (int scene = 0; scene < SCENES && failures < 10; scene++) {
+		// box counts that aren't whole simd blocks exercise the padding
+		std::vector<CollisionBox> boxes(uniformInt(0, 4 * simd::LANES + 3));
+		collisionDetection::CollisionBoxArray array;
+		for (CollisionBox& box : boxes) {
+			box = randomBox();
+			array.add(box);
+		}
+
+		for (int i = 0; i < MOVERS_PER_SCENE; i++) {
+			CollisionBox start = randomMover(boxes);
+
+			CollisionBox scalar = start;
+			for (CollisionBox box : boxes) {
+				collisionDetection::correctCollisionBoxes(&scalar, &box);
+			}
+			CollisionBox lanes = start;
+			collisionDetection::correctCollisionBoxes(&lanes, array);
+
+			if (!sameBits(scalar, start)) {
+				corrected++;
+			}
+			if (!sameBits(scalar, lanes)) {
+				std::printf("scene %d mover %d differs with %zu boxes\n", scene, i, boxes.size());
+				print("start ", start);
+				print("scalar", scalar);
+				print("simd  ", lanes);
+				failures++;
+			}
+		}
+	}
+
+	std::printf("%d movers, %d corrected, %d differing, %u lanes\n", SCENES * MOVERS_PER_SCENE, corrected, failures, simd::LANES);
+	// a run where nothing collides would pass without testing anything
+	if (corrected < SCENES) {
+		std::printf("too few movers were corrected to trust the comparison\n");
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
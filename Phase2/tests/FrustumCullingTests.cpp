@@ -0,0 +1,78 @@
+#include "FrustumCulling.h"
+#include "TestRandom.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// compares the simd cullInstances with cullInstancesScalar over random transforms and frustums,
+// both have to return the same visible list, for instance counts that are and aren't whole simd blocks
+namespace {
+	using namespace testRandom;
+
+	// six random inward facing planes around the origin, so a fair share of the instances land on each side of them
+	frustumCulling::Frustum randomFrustum() {
+		frustumCulling::Frustum frustum;
+		for (int i = 0; i < 6; i++) {
+			frustum.planes[i] = glm::vec4(randomDirection(), uniform(5.0f, 40.0f));
+		}
+		return frustum;
+	}
+
+	frustumCulling::BoundingVolume randomBounds() {
+		std::vector<glm::vec3> positions(8);
+		glm::vec3 offset(uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f));
+		for (glm::vec3& position : positions) {
+			position = offset + glm::vec3(uniform(-3.0f, 3.0f), uniform(-1.0f, 1.0f), uniform(-0.5f, 0.5f));
+		}
+		return frustumCulling::computeBoundingVolume(positions.data(), positions.size());
+	}
+}
+
+int main() {
+	const uint32_t SENTINEL = 0xffffffffu;
+	int failures = 0;
+	uint64_t tested = 0;
+	uint64_t culled = 0;
+
+	for (int trial = 0; trial < 3000 && failures < 10; trial++) {
+		frustumCulling::Frustum frustum = randomFrustum();
+		frustumCulling::BoundingVolume bounds = randomBounds();
+		// every count up to a few simd blocks, so each remainder is covered
+		uint32_t count = static_cast<uint32_t>(trial % (4 * frustumCulling::LANE_COUNT + 5));
+		uint32_t firstIndex = static_cast<uint32_t>(trial * 7);
+
+		std::vector<glm::mat4> transforms(count);
+		for (glm::mat4& transform : transforms) {
+			// a tenth of them mirrored
+			transform = randomTransform(0.1f, 3.0f, 0.1f, 40.0f);
+		}
+
+		// one slot past the end catches writes beyond the visible count
+		std::vector<uint32_t> lanes(count + 1, SENTINEL);
+		std::vector<uint32_t> scalar(count + 1, SENTINEL);
+		uint32_t lanesCount = frustumCulling::cullInstances(frustum, bounds, transforms.data(), count, firstIndex, lanes.data());
+		uint32_t scalarCount = frustumCulling::cullInstancesScalar(frustum, bounds, transforms.data(), count, firstIndex, scalar.data());
+
+		tested += count;
+		culled += count - scalarCount;
+		if (lanesCount != scalarCount || lanes != scalar) {
+			std::printf("trial %d with %u instances: simd kept %u, scalar kept %u\n", trial, count, lanesCount, scalarCount);
+			for (uint32_t i = 0; i <= count; i++) {
+				if (lanes[i] != scalar[i]) {
+					std::printf("  slot %u simd %u scalar %u\n", i, lanes[i], scalar[i]);
+				}
+			}
+			failures++;
+		}
+	}
+
+	std::printf("%llu instances, %llu culled, %d differing trials, %u lanes\n",
+		static_cast<unsigned long long>(tested), static_cast<unsigned long long>(culled), failures, frustumCulling::LANE_COUNT);
+	// both sides of the planes have to show up for the comparison to mean anything
+	if (culled < tested / 10 || culled > tested - tested / 10) {
+		std::printf("the random frustums culled too much or too little\n");
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+#include "MeshletCulling.h"
+#include "TestRandom.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// builds meshlets for generated meshes and checks the limits, that the triangles are only reordered, and that the bounds hold them,
+// then brute forces the culling against every triangle, a meshlet with a triangle facing the camera inside the frustum must never be rejected
+namespace {
+	using namespace testRandom;
+
+	// padded like a model's vertices so the stride is exercised
+	struct TestVertex {
+		glm::vec3 position;
+		glm::vec2 texCoord;
+	};
+
+	struct TestMesh {
+		const char* name;
+		std::vector<TestVertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// a closed bumpy sphere, counter clockwise from outside
+	TestMesh sphere(int rings, int segments) {
+		TestMesh mesh = { "sphere", {}, {} };
+		for (int r = 0; r <= rings; r++) {
+			float polar = 3.14159265f * r / rings;
+			for (int s = 0; s < segments; s++) {
+				float azimuth = 6.2831853f * s / segments;
+				float radius = 4.0f + uniform(-0.3f, 0.3f);
+				glm::vec3 position(std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth));
+				mesh.vertices.push_back({ position * radius, glm::vec2(0.0f) });
+			}
+		}
+		for (int r = 0; r < rings; r++) {
+			for (int s = 0; s < segments; s++) {
+				uint32_t a = r * segments + s;
+				uint32_t b = r * segments + (s + 1) % segments;
+				uint32_t c = a + segments;
+				uint32_t d = b + segments;
+				mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+			}
+		}
+		return mesh;
+	}
+
+	// a rough height field with a few triangles collapsed to no area
+	TestMesh terrain(int size) {
+		TestMesh mesh = { "terrain", {}, {} };
+		for (int z = 0; z <= size; z++) {
+			for (int x = 0; x <= size; x++) {
+				mesh.vertices.push_back({ glm::vec3(x * 0.5f, uniform(-0.4f, 0.4f), z * 0.5f), glm::vec2(0.0f) });
+			}
+		}
+		for (int z = 0; z < size; z++) {
+			for (int x = 0; x < size; x++) {
+				uint32_t a = z * (size + 1) + x;
+				uint32_t b = a + 1;
+				uint32_t c = a + size + 1;
+				uint32_t d = c + 1;
+				if (uniformInt(0, 40) == 0) {
+					b = a;
+				}
+				mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+			}
+		}
+		return mesh;
+	}
+
+	// unrelated triangles sharing vertices at random, the worst case for growing meshlets
+	TestMesh soup(int vertexCount, int triangleCount) {
+		TestMesh mesh = { "soup", {}, {} };
+		for (int i = 0; i < vertexCount; i++) {
+			mesh.vertices.push_back({ glm::vec3(uniform(-5.0f, 5.0f), uniform(-5.0f, 5.0f), uniform(-5.0f, 5.0f)), glm::vec2(0.0f) });
+		}
+		for (int i = 0; i < triangleCount * 3; i++) {
+			mesh.indices.push_back(static_cast<uint32_t>(uniformInt(0, vertexCount - 1)));
+		}
+		return mesh;
+	}
+
+	// inward facing planes that cut through the mesh, or ones so far out that only the facing test can reject anything
+	frustumCulling::Frustum randomFrustum(glm::vec3 centre, bool everything) {
+		frustumCulling::Frustum frustum;
+		for (int i = 0; i < 6; i++) {
+			glm::vec3 normal = randomDirection();
+			float distance = everything ? 1e6f : uniform(0.0f, 12.0f);
+			frustum.planes[i] = glm::vec4(normal, distance - glm::dot(normal, centre));
+		}
+		return frustum;
+	}
+
+	bool insideFrustum(const frustumCulling::Frustum& frustum, glm::vec3 position) {
+		for (int p = 0; p < 6; p++) {
+			if (glm::dot(glm::vec3(frustum.planes[p]), position) + frustum.planes[p].w < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// counter clockwise towards the camera by more than rounding, a triangle seen edge on is never rasterized either way
+	bool facesCamera(glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 camera) {
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		glm::vec3 toCamera = camera - a;
+		return glm::dot(normal, toCamera) > 1e-4f * glm::length(normal) * glm::length(toCamera);
+	}
+
+	int checkLayout(const TestMesh& mesh, const std::vector<uint32_t>& original, const std::vector<meshletCulling::Meshlet>& meshlets) {
+		int failures = 0;
+		uint32_t next = 0;
+		for (size_t m = 0; m < meshlets.size(); m++) {
+			const meshletCulling::Meshlet& meshlet = meshlets[m];
+			std::vector<uint32_t> unique(mesh.indices.begin() + meshlet.firstIndex, mesh.indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+			std::sort(unique.begin(), unique.end());
+			unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+			if (meshlet.firstIndex != next || meshlet.indexCount % 3 != 0 || meshlet.indexCount == 0 ||
+				meshlet.indexCount / 3 > meshletCulling::MAX_TRIANGLES || meshlet.vertexCount > meshletCulling::MAX_VERTICES ||
+				meshlet.vertexCount != unique.size()) {
+				std::printf("%s meshlet %zu: first index %u, %u indices, %u vertices, %zu unique\n", mesh.name, m,
+					meshlet.firstIndex, meshlet.indexCount, meshlet.vertexCount, unique.size());
+				failures++;
+			}
+			next = meshlet.firstIndex + meshlet.indexCount;
+
+			// every corner is inside the sphere, up to the rounding of the radius
+			glm::vec3 centre(meshlet.sphere);
+			for (uint32_t vertex : unique) {
+				float distance = glm::length(mesh.vertices[vertex].position - centre);
+				if (distance > meshlet.sphere.w * 1.0001f + 1e-5f) {
+					std::printf("%s meshlet %zu: vertex %u is %g from the centre, radius %g\n", mesh.name, m, vertex, distance, meshlet.sphere.w);
+					failures++;
+				}
+			}
+		}
+		if (next != mesh.indices.size()) {
+			std::printf("%s: the meshlets cover %u of %zu indices\n", mesh.name, next, mesh.indices.size());
+			failures++;
+		}
+
+		// the same triangles with the same winding, so the same indices
+		std::vector<std::array<uint32_t, 3>> before;
+		std::vector<std::array<uint32_t, 3>> after;
+		for (size_t i = 0; i + 2 < original.size(); i += 3) {
+			before.push_back({ original[i], original[i + 1], original[i + 2] });
+			after.push_back({ mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] });
+		}
+		std::sort(before.begin(), before.end());
+		std::sort(after.begin(), after.end());
+		if (mesh.indices.size() != original.size() || before != after) {
+			std::printf("%s: the triangles changed\n", mesh.name);
+			failures++;
+		}
+		return failures;
+	}
+}
+
+int main() {
+	const int VIEWS = 300;
+	int failures = 0;
+	uint64_t tested = 0;
+	uint64_t backfaceCulled = 0;
+	uint64_t frustumCulled = 0;
+
+	std::vector<TestMesh> meshes;
+	meshes.push_back(sphere(40, 60));
+	meshes.push_back(terrain(48));
+	meshes.push_back(soup(600, 2000));
+
+	for (TestMesh& mesh : meshes) {
+		std::vector<uint32_t> original = mesh.indices;
+		std::vector<meshletCulling::Meshlet> meshlets = meshletCulling::buildMeshlets(mesh.indices.data(), mesh.indices.size(),
+			&mesh.vertices[0].position, sizeof(TestVertex), mesh.vertices.size());
+		failures += checkLayout(mesh, original, meshlets);
+
+		glm::vec3 low(1e9f);
+		glm::vec3 high(-1e9f);
+		for (const TestVertex& vertex : mesh.vertices) {
+			low = glm::min(low, vertex.position);
+			high = glm::max(high, vertex.position);
+		}
+		glm::vec3 middle = (low + high) * 0.5f;
+		float extent = glm::length(high - low);
+
+		std::vector<uint32_t> visible(meshlets.size());
+		for (int view = 0; view < VIEWS && failures < 20; view++) {
+			// cameras inside, near and far from the mesh, in model space for isBackFacing and through a transform for cullMeshlets
+			glm::vec3 localCamera = middle + randomDirection() * extent * uniform(0.0f, 3.0f);
+			// positive scale only, a mirrored transform would flip which side the rasterizer culls
+			glm::mat4 transform = randomTransform(0.5f, 2.0f, 0.0f, 10.0f);
+			glm::vec3 camera = glm::vec3(transform * glm::vec4(localCamera, 1.0f));
+			frustumCulling::Frustum frustum = randomFrustum(glm::vec3(transform * glm::vec4(middle, 1.0f)), view % 2 == 0);
+
+			meshletCulling::CullStats stats;
+			uint32_t visibleCount = meshletCulling::cullMeshlets(frustum, camera, transform, meshlets.data(),
+				static_cast<uint32_t>(meshlets.size()), visible.data(), &stats);
+			tested += stats.tested;
+			backfaceCulled += stats.backfaceCulled;
+			frustumCulled += stats.frustumCulled;
+
+			uint32_t next = 0;
+			for (uint32_t m = 0; m < meshlets.size(); m++) {
+				bool kept = next < visibleCount && visible[next] == m;
+				if (kept) {
+					next++;
+				}
+
+				const meshletCulling::Meshlet& meshlet = meshlets[m];
+				bool localFacing = false;
+				bool needed = false;
+				for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+					glm::vec3 corners[3];
+					glm::vec3 world[3];
+					for (int k = 0; k < 3; k++) {
+						corners[k] = mesh.vertices[mesh.indices[i + k]].position;
+						world[k] = glm::vec3(transform * glm::vec4(corners[k], 1.0f));
+					}
+					localFacing = localFacing || facesCamera(corners[0], corners[1], corners[2], localCamera);
+					if (facesCamera(world[0], world[1], world[2], camera) &&
+						(insideFrustum(frustum, world[0]) || insideFrustum(frustum, world[1]) || insideFrustum(frustum, world[2]))) {
+						needed = true;
+					}
+				}
+
+				if (localFacing && meshletCulling::isBackFacing(meshlet, localCamera)) {
+					std::printf("%s view %d: isBackFacing rejected meshlet %u with a triangle facing the camera\n", mesh.name, view, m);
+					failures++;
+				}
+				if (needed && !kept) {
+					std::printf("%s view %d: cullMeshlets rejected meshlet %u with a triangle facing the camera in the frustum\n", mesh.name, view, m);
+					failures++;
+				}
+			}
+			if (next != visibleCount) {
+				std::printf("%s view %d: the visible list isn't in order\n", mesh.name, view);
+				failures++;
+			}
+		}
+		std::printf("%s: %zu triangles in %zu meshlets\n", mesh.name, mesh.indices.size() / 3, meshlets.size());
+	}
+
+	std::printf("%llu meshlets tested, %llu frustum culled, %llu back face culled, %d failures\n", static_cast<unsigned long long>(tested),
+		static_cast<unsigned long long>(frustumCulled), static_cast<unsigned long long>(backfaceCulled), failures);
+	// both rejections have to happen for the brute force check to mean anything
+	if (frustumCulled < tested / 20 || backfaceCulled < tested / 20) {
+		std::printf("too few meshlets were culled to trust the comparison\n");
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
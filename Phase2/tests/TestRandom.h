@@ -0,0 +1,50 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <random>
+
+// random values for the tests and benchmarks, each executable has its own generator seeded the same way so every run repeats
+namespace testRandom {
+	inline std::mt19937& generator() {
+		static std::mt19937 random(1);
+		return random;
+	}
+
+	inline float uniform(float low, float high) {
+		return std::uniform_real_distribution<float>(low, high)(generator());
+	}
+
+	inline int uniformInt(int low, int high) {
+		return std::uniform_int_distribution<int>(low, high)(generator());
+	}
+
+	inline glm::vec3 randomDirection() {
+		glm::vec3 direction;
+		do {
+			direction = glm::vec3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f));
+		} while (glm::dot(direction, direction) < 0.01f || glm::dot(direction, direction) > 1.0f);
+		return glm::normalize(direction);
+	}
+
+	// a rotation about a random axis, a scale per axis between minScale and maxScale, and a translation up to reach on each axis,
+	// the x scale is mirrored mirrorChance of the time
+	inline glm::mat4 randomTransform(float minScale, float maxScale, float mirrorChance, float reach) {
+		glm::vec3 axis = randomDirection();
+		float angle = uniform(0.0f, 6.2831853f);
+		float c = std::cos(angle);
+		float s = std::sin(angle);
+		float t = 1.0f - c;
+		glm::vec3 scale(uniform(minScale, maxScale), uniform(minScale, maxScale), uniform(minScale, maxScale));
+		if (mirrorChance > 0.0f && uniform(0.0f, 1.0f) < mirrorChance) {
+			scale.x = -scale.x;
+		}
+
+		glm::mat4 transform(1.0f);
+		transform[0] = glm::vec4(t * axis.x * axis.x + c, t * axis.x * axis.y + s * axis.z, t * axis.x * axis.z - s * axis.y, 0.0f) * scale.x;
+		transform[1] = glm::vec4(t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c, t * axis.y * axis.z + s * axis.x, 0.0f) * scale.y;
+		transform[2] = glm::vec4(t * axis.x * axis.z + s * axis.y, t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c, 0.0f) * scale.z;
+		transform[3] = glm::vec4(uniform(-reach, reach), uniform(-reach, reach), uniform(-reach, reach), 1.0f);
+		return transform;
+	}
+}
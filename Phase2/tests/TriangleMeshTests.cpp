@@ -0,0 +1,191 @@
+#include "TriangleMesh.h"
+#include "TestRandom.h"
+
+#include <cstdio>
+#include <vector>
+
+// casts random rays at random triangle soups and checks the tree's answer against testing every triangle in order,
+// the hit triangle is reported by its position in the indices the mesh was built from,
+// then sweeps random boxes through them, a box shrunk a little must touch nothing before the time the sweep gives,
+// and grown a little must touch something at it
+namespace {
+	using namespace testRandom;
+
+	glm::vec3 randomPoint(float reach) {
+		return glm::vec3(uniform(-reach, reach), uniform(-reach, reach), uniform(-reach, reach));
+	}
+
+	// small triangles scattered through a cube, with some repeated so rays hit several at the same distance
+	void randomSoup(int triangleCount, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+		positions.clear();
+		indices.clear();
+		for (int i = 0; i < triangleCount; i++) {
+			if (i > 0 && uniformInt(0, 9) == 0) {
+				int copy = uniformInt(0, i - 1);
+				indices.insert(indices.end(), { indices[copy * 3], indices[copy * 3 + 1], indices[copy * 3 + 2] });
+				continue;
+			}
+			glm::vec3 centre = randomPoint(8.0f);
+			for (int corner = 0; corner < 3; corner++) {
+				indices.push_back(static_cast<uint32_t>(positions.size()));
+				positions.push_back(centre + randomPoint(1.5f));
+			}
+		}
+	}
+
+	// Möller-Trumbore like the mesh, the lowest index wins at equal distances
+	bool bruteForceRaycast(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const glm::vec3& origin, const glm::vec3& direction,
+		float maxDistance, float& distance, int& triangle) {
+		triangle = -1;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			glm::vec3 a = positions[indices[i]];
+			glm::vec3 edge1 = positions[indices[i + 1]] - a;
+			glm::vec3 edge2 = positions[indices[i + 2]] - a;
+			glm::vec3 p = glm::cross(direction, edge2);
+			float determinant = glm::dot(edge1, p);
+			if (determinant == 0.0f) {
+				continue;
+			}
+			float inverse = 1.0f / determinant;
+			glm::vec3 s = origin - a;
+			float u = glm::dot(s, p) * inverse;
+			if (u < 0.0f || u > 1.0f) {
+				continue;
+			}
+			glm::vec3 q = glm::cross(s, edge1);
+			float v = glm::dot(direction, q) * inverse;
+			if (v < 0.0f || u + v > 1.0f) {
+				continue;
+			}
+			float t = glm::dot(edge2, q) * inverse;
+			if (t >= 0.0f && t <= maxDistance && (triangle < 0 || t < maxDistance)) {
+				maxDistance = t;
+				triangle = static_cast<int>(i / 3);
+			}
+		}
+		distance = maxDistance;
+		return triangle >= 0;
+	}
+
+	void scaledEdges(const glm::vec3 halfEdges[3], float scale, glm::vec3 scaled[3]) {
+		for (int i = 0; i < 3; i++) {
+			scaled[i] = halfEdges[i] * scale;
+		}
+	}
+}
+
+int main() {
+	int failures = 0;
+	int hits = 0;
+	int sharedHits = 0;
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	for (int trial = 0; trial < 200 && failures < 10; trial++) {
+		randomSoup(uniformInt(1, 300), positions, indices);
+		collisionDetection::TriangleMesh mesh(positions.data(), sizeof(glm::vec3), indices.data(), indices.size());
+
+		for (int ray = 0; ray < 50 && failures < 10; ray++) {
+			glm::vec3 origin = randomPoint(12.0f);
+			glm::vec3 direction = randomPoint(8.0f) - origin;
+			float maxDistance = uniform(0.5f, 2.0f);
+
+			float expectedDistance = 0.0f;
+			int expectedTriangle = -1;
+			bool expectedHit = bruteForceRaycast(positions, indices, origin, direction, maxDistance, expectedDistance, expectedTriangle);
+			float distance = 0.0f;
+			int triangle = -1;
+			bool hit = mesh.raycast(origin, direction, maxDistance, distance, triangle);
+
+			if (hit != expectedHit || (hit && (distance != expectedDistance || triangle != expectedTriangle))) {
+				std::printf("trial %d ray %d: tree %d triangle %d at %.9g, every triangle %d triangle %d at %.9g\n", trial, ray,
+					hit, triangle, distance, expectedHit, expectedTriangle, expectedDistance);
+				failures++;
+				continue;
+			}
+			if (hit) {
+				hits++;
+				// a repeated triangle is hit at exactly the same distance as the one it copies
+				for (size_t i = 0; i < indices.size(); i += 3) {
+					if (static_cast<int>(i / 3) != triangle && indices[i] == indices[triangle * 3] && indices[i + 1] == indices[triangle * 3 + 1] && indices[i + 2] == indices[triangle * 3 + 2]) {
+						sharedHits++;
+						break;
+					}
+				}
+
+				glm::vec3 a = positions[indices[triangle * 3]];
+				glm::vec3 expectedNormal = glm::normalize(glm::cross(positions[indices[triangle * 3 + 1]] - a, positions[indices[triangle * 3 + 2]] - a));
+				if (glm::length(mesh.getTriangleNormal(triangle) - expectedNormal) > 1e-5f) {
+					std::printf("trial %d ray %d: triangle %d has the wrong normal\n", trial, ray, triangle);
+					failures++;
+				}
+			}
+		}
+	}
+
+	// without enough hits, and hits on repeated triangles, the comparison says little
+	if (hits < 500 || sharedHits < 20) {
+		std::printf("only %d hits, %d on repeated triangles\n", hits, sharedHits);
+		failures++;
+	}
+
+	const int SAMPLES = 200;
+	int sweepHits = 0;
+	int sweepMisses = 0;
+	int startsTouching = 0;
+	for (int trial = 0; trial < 100 && failures < 10; trial++) {
+		randomSoup(uniformInt(1, 100), positions, indices);
+		collisionDetection::TriangleMesh mesh(positions.data(), sizeof(glm::vec3), indices.data(), indices.size());
+
+		for (int box = 0; box < 20 && failures < 10; box++) {
+			// a box from a world space box moved into a mesh's space, so its edges are skewed
+			glm::mat4 transform = randomTransform(0.2f, 1.0f, 0.1f, 0.0f);
+			glm::vec3 halfEdges[3];
+			for (int axis = 0; axis < 3; axis++) {
+				halfEdges[axis] = glm::vec3(transform[axis]) * uniform(0.1f, 1.0f);
+			}
+			glm::vec3 centre = randomPoint(12.0f);
+			glm::vec3 displacement = randomPoint(8.0f) - centre;
+
+			float time = 0.0f;
+			bool hit = mesh.sweep(centre, halfEdges, displacement, time);
+			glm::vec3 shrunk[3];
+			glm::vec3 grown[3];
+			scaledEdges(halfEdges, 0.999f, shrunk);
+			scaledEdges(halfEdges, 1.001f, grown);
+
+			float end = hit ? time : 1.0f;
+			for (int sample = 0; sample <= SAMPLES; sample++) {
+				float t = end * sample / SAMPLES;
+				if ((!hit || t < time) && mesh.overlaps(centre + displacement * t, shrunk)) {
+					std::printf("sweep trial %d box %d: touches at %.9g, before the sweep's %s %.9g\n", trial, box, t, hit ? "hit at" : "miss", time);
+					failures++;
+					break;
+				}
+			}
+			if (hit && !mesh.overlaps(centre + displacement * time, grown)) {
+				std::printf("sweep trial %d box %d: nothing touched at the sweep's hit at %.9g\n", trial, box, time);
+				failures++;
+			}
+
+			if (!hit) {
+				sweepMisses++;
+			}
+			else if (time == 0.0f) {
+				startsTouching++;
+			}
+			else {
+				sweepHits++;
+			}
+		}
+	}
+
+	if (sweepHits < 200 || sweepMisses < 100 || startsTouching < 10) {
+		std::printf("only %d sweeps hit, %d missed and %d started touching\n", sweepHits, sweepMisses, startsTouching);
+		failures++;
+	}
+
+	std::printf("%d hits, %d on repeated triangles, sweeps %d hit %d missed %d started touching, %d failures\n", hits, sharedHits,
+		sweepHits, sweepMisses, startsTouching, failures);
+	return failures == 0 ? 0 : 1;
+}